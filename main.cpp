@@ -2,6 +2,7 @@
 
 #include "src/whitespace/interpreter.h"
 #include "src/utils/ErrorHandler/ErrorHandler.h"
+#include "src/utils/SourceFilter/SourceFilter.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -20,33 +21,30 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // 一次读入整个文件
+    std::vector<char> code(static_cast<size_t>(file.seekg(0, std::ios::end).tellg()));
+    file.seekg(0).read(code.data(), static_cast<std::streamsize>(code.size()));
+    file.close();
+
     std::cout << "Now original file start ===========" << std::endl;
-    std::vector<char> t_code; char xc;
-    while (file.get(xc)) {
-        switch (xc) {
+    std::vector<char> tokens(code.size() + Rikkyu::utils::SourceFilter::kSlack);
+    tokens.resize(Rikkyu::utils::SourceFilter::compact(code.data(), code.size(), Rikkyu::utils::SourceFilter::Alphabet::Whitespace,
+                                                       tokens.data(), nullptr));
+    for (const char c : tokens) {
+        switch (c) {
         case ' ':
             std::cout << "[Space]";
             break;
         case '\t':
             std::cout << "[Tab]";
             break;
-        case '\n':
+        default:
             std::cout << "[Line Feed]" << std::endl;
             break;
-        default:
-            continue;
         }
     }
     std::cout << "\nOriginal file end =================" << std::endl;
 
-    // 读取文件内容
-    std::vector<char> code;
-    char c;
-    while (file.get(c)) {
-        code.push_back(c);
-    }
-    file.close();
-
     try {
         // 解析并执行Whitespace代码
         auto expressions = Parser().parse(code);
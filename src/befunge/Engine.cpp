@@ -0,0 +1,170 @@
+#include "Engine.h"
+
+#include <string>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::Befunge {
+    bool Engine::fail(const char *code, const char *message, uint16_t position) {
+        output_->flush();
+        utils::ErrorHandler::getInstance().makeError(
+            utils::StringBuilder::concatenate("[", code, "]: ", message, " at (", std::to_string(position % Playfield::kWidth), ", ",
+                                              std::to_string(position / Playfield::kWidth), ")"),
+            position);
+        return false;
+    }
+
+    bool Engine::execute(const CompiledTrace &trace, const Playfield &field) {
+        for (const TraceOp &op : trace.ops) {
+            switch (op.kind) {
+            case TraceOp::Kind::Push:
+                stack_.push_back(op.value);
+                break;
+            case TraceOp::Kind::Add:
+            case TraceOp::Kind::Sub:
+            case TraceOp::Kind::Mul:
+            case TraceOp::Kind::Div:
+            case TraceOp::Kind::Mod:
+            case TraceOp::Kind::Greater: {
+                const int64_t a = pop();
+                const int64_t b = pop();
+                const auto    ua = static_cast<uint64_t>(a);
+                const auto    ub = static_cast<uint64_t>(b);
+                int64_t       result = 0;
+                switch (op.kind) {
+                case TraceOp::Kind::Add:
+                    result = static_cast<int64_t>(ub + ua);
+                    break;
+                case TraceOp::Kind::Sub:
+                    result = static_cast<int64_t>(ub - ua);
+                    break;
+                case TraceOp::Kind::Mul:
+                    result = static_cast<int64_t>(ub * ua);
+                    break;
+                case TraceOp::Kind::Greater:
+                    result = b > a ? 1 : 0;
+                    break;
+                default:
+                    if (a == 0) {
+                        return fail(op.kind == TraceOp::Kind::Div ? "BGE02" : "BGE03", op.kind == TraceOp::Kind::Div ? "Division by zero" : "Modulo by zero",
+                                    op.position);
+                    }
+                    if (a == -1) {
+                        result = op.kind == TraceOp::Kind::Div ? static_cast<int64_t>(0 - ub) : 0;
+                    } else {
+                        result = op.kind == TraceOp::Kind::Div ? b / a : b % a;
+                    }
+                    break;
+                }
+                stack_.push_back(result);
+                break;
+            }
+            case TraceOp::Kind::Not:
+                stack_.push_back(pop() == 0 ? 1 : 0);
+                break;
+            case TraceOp::Kind::Dup: {
+                const int64_t value = pop();
+                stack_.push_back(value);
+                stack_.push_back(value);
+                break;
+            }
+            case TraceOp::Kind::Swap: {
+                const int64_t a = pop();
+                const int64_t b = pop();
+                stack_.push_back(a);
+                stack_.push_back(b);
+                break;
+            }
+            case TraceOp::Kind::Pop:
+                pop();
+                break;
+            case TraceOp::Kind::OutNum:
+                output_->writeInteger(pop());
+                output_->put(' ');
+                break;
+            case TraceOp::Kind::OutChar:
+                output_->put(static_cast<char>(pop()));
+                break;
+            case TraceOp::Kind::InNum: {
+                std::string text;
+                int64_t     value = 0;
+                if (input_->readInteger(value, text) != utils::BufferedInput::NumberStatus::Ok) {
+                    value = -1;
+                }
+                stack_.push_back(value);
+                break;
+            }
+            case TraceOp::Kind::InChar:
+                stack_.push_back(input_->get());
+                break;
+            case TraceOp::Kind::Get: {
+                const int64_t y = pop();
+                const int64_t x = pop();
+                stack_.push_back(Playfield::inBounds(x, y) ? field.at(Playfield::position(x, y)) : 0);
+                break;
+            }
+            }
+        }
+        return true;
+    }
+
+    bool Engine::run(const Playfield &program) {
+        Playfield  field = program;
+        TraceCache cache(field);
+        stack_.clear();
+
+        uint16_t key = TraceCache::key(0, Direction::Right);
+        bool     ok = true;
+        for (bool running = true; running;) {
+            if (interrupt_ && interrupt_->load(std::memory_order_relaxed)) {
+                ok = false;
+                break;
+            }
+            const CompiledTrace &trace = cache.get(key);
+            if (!execute(trace, field)) {
+                ok = false;
+                break;
+            }
+
+            switch (trace.exit) {
+            case CompiledTrace::Exit::Continue:
+                key = trace.next;
+                break;
+            case CompiledTrace::Exit::Horizontal:
+            case CompiledTrace::Exit::Vertical:
+                key = trace.branch[pop() == 0 ? 0 : 1];
+                break;
+            case CompiledTrace::Exit::Random:
+                key = trace.branch[random_() & 3];
+                break;
+            case CompiledTrace::Exit::Halt:
+                running = false;
+                break;
+            case CompiledTrace::Exit::Put: {
+                // write() 可能作废当前轨迹，先把后继取出来
+                const uint16_t next = trace.next;
+                const int64_t  y = pop();
+                const int64_t  x = pop();
+                const int64_t  value = pop();
+                cache.write(x, y, value);
+                key = next;
+                break;
+            }
+            case CompiledTrace::Exit::Unknown: {
+                const int64_t cell = field.at(trace.position);
+                const char    text[] = {static_cast<char>(cell), '\0'};
+                ok = fail("BGE01", cell > 32 && cell < 127 ? utils::StringBuilder::concatenate("Unknown instruction '", text, "'").c_str()
+                                                           : "Unknown instruction",
+                          trace.position);
+                running = false;
+                break;
+            }
+            }
+        }
+
+        statistics_ = cache.statistics();
+        output_->flush();
+        return ok;
+    }
+} // namespace Rikkyu::Befunge
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef RIK_BEFUNGE_ENGINE
+#define RIK_BEFUNGE_ENGINE
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Playfield.h"
+#include "TraceCache.h"
+#include "../utils/BufferedIO/BufferedIO.h"
+
+namespace Rikkyu::Befunge {
+    // Befunge-93 执行引擎。指令指针不逐格解码，而是按 (位置, 方向) 取出缓存的直线轨迹，
+    // 一次执行完整段栈指令后再按轨迹的出口决定下一段。
+    //   - 栈为空时弹出得到 0；
+    //   - g / p 越界时分别得到 0 / 被忽略；
+    //   - ~ 和 & 在输入结束时得到 -1。
+    class Engine {
+    public:
+        Engine() = default;
+        ~Engine() = default;
+
+        // 替换输入输出，默认为进程共享的标准输入输出
+        void setIO(utils::BufferedInput &input, utils::BufferedOutput &output) {
+            input_ = &input;
+            output_ = &output;
+        }
+
+        // '?' 使用的随机数种子
+        void setSeed(uint32_t seed) {
+            random_.seed(seed);
+        }
+
+        // 另一个线程把 flag 置为 true 后，执行在下一段轨迹开始前停止；nullptr 表示不可中断
+        void setInterrupt(const std::atomic<bool> *flag) {
+            interrupt_ = flag;
+        }
+
+        // 供 utils::RunnerPool 复用。run() 本身也会清空栈，这里只是提前释放上一次的内容
+        void reset() {
+            stack_.clear();
+        }
+
+        // 在 field 的副本上执行，程序可以修改自己；出错时报告错误并返回 false（被中断时不报告错误），结束时刷新输出
+        bool run(const Playfield &field);
+
+        [[nodiscard]] const TraceCache::Statistics &statistics() const {
+            return statistics_;
+        }
+
+    private:
+        RIK_INLINE int64_t pop() {
+            if (stack_.empty()) {
+                return 0;
+            }
+            const int64_t value = stack_.back();
+            stack_.pop_back();
+            return value;
+        }
+
+        bool execute(const CompiledTrace &trace, const Playfield &field);
+        bool fail(const char *code, const char *message, uint16_t position);
+
+        std::vector<int64_t>   stack_;
+        std::mt19937           random_{std::random_device{}()};
+        TraceCache::Statistics statistics_;
+        const std::atomic<bool> *interrupt_ = nullptr;
+        utils::BufferedInput  *input_ = &utils::BufferedInput::standardInput();
+        utils::BufferedOutput *output_ = &utils::BufferedOutput::standardOutput();
+    };
+} // namespace Rikkyu::Befunge
+
+#endif // RIK_BEFUNGE_ENGINE
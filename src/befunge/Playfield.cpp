@@ -0,0 +1,34 @@
+#include "Playfield.h"
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::Befunge {
+    Playfield Playfield::load(const char *data, size_t size) {
+        Playfield field;
+        int       x = 0;
+        int       y = 0;
+        bool      truncated = false;
+        for (size_t i = 0; i < size; ++i) {
+            const char c = data[i];
+            if (c == '\r' && i + 1 < size && data[i + 1] == '\n') {
+                continue;
+            }
+            if (c == '\n' || c == '\r') {
+                x = 0;
+                ++y;
+                continue;
+            }
+            if (x < kWidth && y < kHeight) {
+                field.set(position(x, y), static_cast<unsigned char>(c));
+            } else {
+                truncated = true;
+            }
+            ++x;
+        }
+
+        if (truncated) {
+            utils::ErrorHandler::getInstance().makeWarning("[BGW01]: Source exceeds the 80x25 playfield and was truncated", 0);
+        }
+        return field;
+    }
+} // namespace Rikkyu::Befunge
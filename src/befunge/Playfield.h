@@ -0,0 +1,73 @@
+#pragma once
+#ifndef RIK_BEFUNGE_PLAYFIELD
+#define RIK_BEFUNGE_PLAYFIELD
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::Befunge {
+    // 指令指针的四个方向，顺序与 '?' 的随机选择和方向表一致
+    enum class Direction : uint8_t {
+        Right,
+        Down,
+        Left,
+        Up
+    };
+
+    // Befunge-93 的 80×25 环面网格，按行优先存放在一个扁平数组里，位置用 y * 80 + x 表示。
+    // 单元格可以被 p 写入任意整数，只有 0..255 的值才是可执行的指令。
+    class Playfield {
+    public:
+        static constexpr int    kWidth = 80;
+        static constexpr int    kHeight = 25;
+        static constexpr size_t kCells = static_cast<size_t>(kWidth) * kHeight;
+
+        Playfield() {
+            cells_.fill(' ');
+        }
+        ~Playfield() = default;
+
+        // 按行载入源码（兼容 \r\n），超出 80×25 的部分截断并给出警告
+        static Playfield load(const char *data, size_t size);
+
+        [[nodiscard]] static bool inBounds(int64_t x, int64_t y) {
+            return x >= 0 && x < kWidth && y >= 0 && y < kHeight;
+        }
+
+        [[nodiscard]] static uint16_t position(int64_t x, int64_t y) {
+            return static_cast<uint16_t>(y * kWidth + x);
+        }
+
+        // 沿 direction 前进一格，越过边界时绕回另一侧
+        [[nodiscard]] RIK_INLINE static uint16_t step(uint16_t position, Direction direction) {
+            const int x = position % kWidth;
+            const int y = position / kWidth;
+            switch (direction) {
+            case Direction::Right:
+                return static_cast<uint16_t>(x == kWidth - 1 ? position - (kWidth - 1) : position + 1);
+            case Direction::Left:
+                return static_cast<uint16_t>(x == 0 ? position + (kWidth - 1) : position - 1);
+            case Direction::Down:
+                return static_cast<uint16_t>(y == kHeight - 1 ? x : position + kWidth);
+            default:
+                return static_cast<uint16_t>(y == 0 ? (kHeight - 1) * kWidth + x : position - kWidth);
+            }
+        }
+
+        [[nodiscard]] RIK_INLINE int64_t at(uint16_t position) const {
+            return cells_[position];
+        }
+
+        RIK_INLINE void set(uint16_t position, int64_t value) {
+            cells_[position] = value;
+        }
+
+    private:
+        std::array<int64_t, kCells> cells_;
+    };
+} // namespace Rikkyu::Befunge
+
+#endif // RIK_BEFUNGE_PLAYFIELD
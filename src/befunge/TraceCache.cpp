@@ -0,0 +1,284 @@
+#include "TraceCache.h"
+
+#include <algorithm>
+
+namespace Rikkyu::Befunge {
+    namespace {
+        bool isBinary(TraceOp::Kind kind) {
+            switch (kind) {
+            case TraceOp::Kind::Add:
+            case TraceOp::Kind::Sub:
+            case TraceOp::Kind::Mul:
+            case TraceOp::Kind::Div:
+            case TraceOp::Kind::Mod:
+            case TraceOp::Kind::Greater:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // 编译期折叠两个常量的运算，b 是次栈顶，a 是栈顶；会出错的情况留到运行时
+        bool fold(TraceOp::Kind kind, int64_t b, int64_t a, int64_t &result) {
+            const auto ub = static_cast<uint64_t>(b);
+            const auto ua = static_cast<uint64_t>(a);
+            switch (kind) {
+            case TraceOp::Kind::Add:
+                result = static_cast<int64_t>(ub + ua);
+                return true;
+            case TraceOp::Kind::Sub:
+                result = static_cast<int64_t>(ub - ua);
+                return true;
+            case TraceOp::Kind::Mul:
+                result = static_cast<int64_t>(ub * ua);
+                return true;
+            case TraceOp::Kind::Div:
+            case TraceOp::Kind::Mod:
+                if (a == 0 || a == -1) {
+                    return false;
+                }
+                result = kind == TraceOp::Kind::Div ? b / a : b % a;
+                return true;
+            case TraceOp::Kind::Greater:
+                result = b > a ? 1 : 0;
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        TraceOp::Kind kindOf(int64_t cell, bool &known) {
+            known = true;
+            switch (cell) {
+            case '+':
+                return TraceOp::Kind::Add;
+            case '-':
+                return TraceOp::Kind::Sub;
+            case '*':
+                return TraceOp::Kind::Mul;
+            case '/':
+                return TraceOp::Kind::Div;
+            case '%':
+                return TraceOp::Kind::Mod;
+            case '!':
+                return TraceOp::Kind::Not;
+            case '`':
+                return TraceOp::Kind::Greater;
+            case ':':
+                return TraceOp::Kind::Dup;
+            case '\\':
+                return TraceOp::Kind::Swap;
+            case '$':
+                return TraceOp::Kind::Pop;
+            case '.':
+                return TraceOp::Kind::OutNum;
+            case ',':
+                return TraceOp::Kind::OutChar;
+            case '&':
+                return TraceOp::Kind::InNum;
+            case '~':
+                return TraceOp::Kind::InChar;
+            case 'g':
+                return TraceOp::Kind::Get;
+            default:
+                known = false;
+                return TraceOp::Kind::Push;
+            }
+        }
+    } // namespace
+
+    TraceCache::TraceCache(Playfield &field)
+        : field_(field), visited_(kKeys, false) {}
+
+    void TraceCache::cover(uint16_t position, uint16_t key) {
+        auto &keys = covering_[position];
+        if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+            keys.push_back(key);
+        }
+    }
+
+    void TraceCache::append(CompiledTrace &trace, TraceOp op) {
+        auto        &ops = trace.ops;
+        const size_t n = ops.size();
+        const bool   top = n >= 1 && ops[n - 1].kind == TraceOp::Kind::Push;
+        const bool   second = n >= 2 && ops[n - 2].kind == TraceOp::Kind::Push;
+
+        // 作用在已知常量上的指令直接在编译时算掉
+        int64_t result = 0;
+        if (isBinary(op.kind) && top && second && fold(op.kind, ops[n - 2].value, ops[n - 1].value, result)) {
+            ops.pop_back();
+            ops.back().value = result;
+            return;
+        }
+        if (top) {
+            switch (op.kind) {
+            case TraceOp::Kind::Not:
+                ops.back().value = ops.back().value == 0 ? 1 : 0;
+                return;
+            case TraceOp::Kind::Pop:
+                ops.pop_back();
+                return;
+            case TraceOp::Kind::Dup:
+                ops.push_back(ops.back());
+                return;
+            case TraceOp::Kind::Swap:
+                if (second) {
+                    std::swap(ops[n - 1].value, ops[n - 2].value);
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        ops.push_back(op);
+    }
+
+    void TraceCache::compile(uint16_t key) {
+        auto trace = std::make_unique<CompiledTrace>();
+        ++statistics_.compiled;
+
+        uint16_t              position = static_cast<uint16_t>(key / 4);
+        auto                  direction = static_cast<Direction>(key % 4);
+        bool                  stringMode = false;
+        std::vector<uint16_t> visited;
+
+        auto successor = [&](Direction next) {
+            return TraceCache::key(Playfield::step(position, next), next);
+        };
+
+        for (;;) {
+            // 字符串模式最多绕一圈就会遇到同一个引号，所以只在普通模式下检查回环和长度
+            if (!stringMode) {
+                const uint16_t current = TraceCache::key(position, direction);
+                if (visited_[current] || trace->ops.size() >= kMaxTraceOps) {
+                    trace->exit = CompiledTrace::Exit::Continue;
+                    trace->next = current;
+                    break;
+                }
+                visited_[current] = true;
+                visited.push_back(current);
+            }
+
+            cover(position, key);
+            const int64_t cell = field_.at(position);
+            if (stringMode) {
+                if (cell == '"') {
+                    stringMode = false;
+                } else {
+                    append(*trace, {TraceOp::Kind::Push, position, cell});
+                }
+                position = Playfield::step(position, direction);
+                continue;
+            }
+
+            bool                known = false;
+            const TraceOp::Kind kind = kindOf(cell, known);
+            if (known) {
+                append(*trace, {kind, position, 0});
+                position = Playfield::step(position, direction);
+                continue;
+            }
+
+            bool exit = false;
+            switch (cell) {
+            case ' ':
+                break;
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                append(*trace, {TraceOp::Kind::Push, position, cell - '0'});
+                break;
+            case '"':
+                stringMode = true;
+                break;
+            case '>':
+                direction = Direction::Right;
+                break;
+            case 'v':
+                direction = Direction::Down;
+                break;
+            case '<':
+                direction = Direction::Left;
+                break;
+            case '^':
+                direction = Direction::Up;
+                break;
+            case '#':
+                // 跳过的单元格不会被解码，它的内容不影响这条轨迹
+                position = Playfield::step(position, direction);
+                break;
+            case '_':
+                trace->exit = CompiledTrace::Exit::Horizontal;
+                trace->branch[0] = successor(Direction::Right);
+                trace->branch[1] = successor(Direction::Left);
+                exit = true;
+                break;
+            case '|':
+                trace->exit = CompiledTrace::Exit::Vertical;
+                trace->branch[0] = successor(Direction::Down);
+                trace->branch[1] = successor(Direction::Up);
+                exit = true;
+                break;
+            case '?':
+                trace->exit = CompiledTrace::Exit::Random;
+                for (uint8_t d = 0; d < 4; ++d) {
+                    trace->branch[d] = successor(static_cast<Direction>(d));
+                }
+                exit = true;
+                break;
+            case '@':
+                trace->exit = CompiledTrace::Exit::Halt;
+                exit = true;
+                break;
+            case 'p':
+                trace->exit = CompiledTrace::Exit::Put;
+                trace->next = successor(direction);
+                trace->position = position;
+                exit = true;
+                break;
+            default:
+                trace->exit = CompiledTrace::Exit::Unknown;
+                trace->position = position;
+                exit = true;
+                break;
+            }
+            if (exit) {
+                break;
+            }
+            position = Playfield::step(position, direction);
+        }
+
+        for (const uint16_t current : visited) {
+            visited_[current] = false;
+        }
+        traces_[key] = std::move(trace);
+    }
+
+    void TraceCache::write(int64_t x, int64_t y, int64_t value) {
+        if (!Playfield::inBounds(x, y)) {
+            return;
+        }
+        const uint16_t position = Playfield::position(x, y);
+        if (field_.at(position) == value) {
+            return;
+        }
+        field_.set(position, value);
+
+        auto &keys = covering_[position];
+        for (const uint16_t key : keys) {
+            if (traces_[key]) {
+                traces_[key].reset();
+                ++statistics_.invalidated;
+            }
+        }
+        keys.clear();
+    }
+} // namespace Rikkyu::Befunge
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef RIK_BEFUNGE_TRACE_CACHE
+#define RIK_BEFUNGE_TRACE_CACHE
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Playfield.h"
+
+namespace Rikkyu::Befunge {
+    // 轨迹内的一条栈指令。position 是它在网格上的位置，用于报错
+    struct TraceOp {
+        enum class Kind : uint8_t {
+            Push,
+            Add,
+            Sub,
+            Mul,
+            Div,
+            Mod,
+            Not,
+            Greater,
+            Dup,
+            Swap,
+            Pop,
+            OutNum,
+            OutChar,
+            InNum,
+            InChar,
+            Get
+        };
+
+        Kind     kind;
+        uint16_t position;
+        int64_t  value; // Push 的立即数
+    };
+
+    // 从某个 (位置, 方向) 出发的一段直线执行路径，已经解码成栈指令。
+    // 方向改变、'#' 跳板和字符串模式都在编译时走完，只有需要运行时数据才能决定去向的指令才结束轨迹。
+    struct CompiledTrace {
+        enum class Exit : uint8_t {
+            Continue,   // 到达长度上限或绕回已经走过的位置，从 next 继续
+            Horizontal, // '_'：弹出值为 0 走 branch[0]，否则 branch[1]
+            Vertical,   // '|'：同上
+            Random,     // '?'：随机选择 branch[0..3]
+            Halt,       // '@'
+            Put,        // 'p'：写入网格后从 next 继续
+            Unknown     // 无法执行的单元格，位置在 position
+        };
+
+        std::vector<TraceOp>    ops;
+        Exit                    exit = Exit::Continue;
+        uint16_t                next = 0;
+        std::array<uint16_t, 4> branch{};
+        uint16_t                position = 0;
+    };
+
+    // 轨迹缓存：以 (位置, 方向) 为键的扁平数组。
+    // 每个单元格记录经过它的轨迹，p 改变某个单元格的内容时只作废这些轨迹。
+    class TraceCache {
+    public:
+        static constexpr size_t kKeys = Playfield::kCells * 4;
+        static constexpr size_t kMaxTraceOps = 1024;
+
+        struct Statistics {
+            size_t compiled = 0;
+            size_t invalidated = 0;
+        };
+
+        explicit TraceCache(Playfield &field);
+        ~TraceCache() = default;
+
+        TraceCache(const TraceCache &) = delete;
+        TraceCache &operator=(const TraceCache &) = delete;
+
+        [[nodiscard]] static uint16_t key(uint16_t position, Direction direction) {
+            return static_cast<uint16_t>(position * 4 + static_cast<uint16_t>(direction));
+        }
+
+        // 返回的引用在下一次 write() 之前有效
+        RIK_INLINE const CompiledTrace &get(uint16_t key) {
+            if (!traces_[key]) {
+                compile(key);
+            }
+            return *traces_[key];
+        }
+
+        // 执行 p：越界的写入被忽略，内容确实改变时作废经过该单元格的轨迹
+        void write(int64_t x, int64_t y, int64_t value);
+
+        [[nodiscard]] const Statistics &statistics() const {
+            return statistics_;
+        }
+
+    private:
+        void compile(uint16_t key);
+        void append(CompiledTrace &trace, TraceOp op);
+        void cover(uint16_t position, uint16_t key);
+
+        Playfield                                          &field_;
+        std::array<std::unique_ptr<CompiledTrace>, kKeys>   traces_;
+        std::array<std::vector<uint16_t>, Playfield::kCells> covering_;
+        std::vector<bool>                                   visited_;
+        Statistics                                          statistics_;
+    };
+} // namespace Rikkyu::Befunge
+
+#endif // RIK_BEFUNGE_TRACE_CACHE
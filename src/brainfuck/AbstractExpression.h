@@ -2,6 +2,8 @@
 #ifndef RIK_BF_ABSTRACT_EXP
 #define RIK_BF_ABSTRACT_EXP
 
+#include <cstddef>
+
 namespace Rikkyu::Brainfuck {
     class IncrementExpression;
     class DecrementExpression;
@@ -32,6 +34,15 @@ namespace Rikkyu::Brainfuck {
         virtual void               accept(ExpressionVisitor &visitor) const = 0;
         [[nodiscard]] virtual bool repeatable() const { return false; }
         virtual void               repeat() {}
+        // 对应的源码字符，循环为 '['
+        [[nodiscard]] virtual char symbol() const = 0;
+
+        // 源码中的位置，用作跟踪事件的 pc
+        [[nodiscard]] size_t position() const { return position_; }
+        void                 setPosition(size_t position) { position_ = position; }
+
+    private:
+        size_t position_ = 0;
     };
 }
 
@@ -0,0 +1,292 @@
+#include "HotLoop.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#include "LoopCache.h"
+
+namespace Rikkyu::Brainfuck {
+    LoopExpression::~LoopExpression() {
+        delete hot_.load(std::memory_order_relaxed);
+    }
+
+    void LoopExpression::run(Runner &runner) const {
+        if (memoizable_ && runner.loopCache() && runner.loopCache()->run(*this, runner)) {
+            return;
+        }
+        iterate(runner);
+    }
+
+    void LoopExpression::iterate(Runner &runner) const {
+        if (const HotLoop *hot = hot_.load(std::memory_order_acquire)) {
+            hot->run(runner);
+            return;
+        }
+        uint32_t heat = heat_.load(std::memory_order_relaxed);
+        while (runner.memory().memory_pointerByteReadData() > 0) {
+            runner.runBlock(children_);
+            if (++heat >= kHotIterations) {
+                // 下一次迭代改由字节码执行
+                promote()->run(runner);
+                return;
+            }
+        }
+        heat_.store(heat, std::memory_order_relaxed);
+    }
+
+    const HotLoop *LoopExpression::promote() const {
+        auto    *compiled = new HotLoop(*this);
+        HotLoop *expected = nullptr;
+        if (!hot_.compare_exchange_strong(expected, compiled, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            delete compiled;
+            return expected;
+        }
+        return compiled;
+    }
+
+    HotLoop::HotLoop(const LoopExpression &loop) {
+        Segment segment;
+        compile(loop, segment);
+        flush(segment);
+        code_.push_back({Kind::End});
+
+        // 慢路径接在后面：其中的循环跳转是 slow_ 内的下标，跳回快路径的 Jump 已经是 code_ 的下标
+        const auto base = static_cast<uint32_t>(code_.size());
+        for (Op op : slow_) {
+            if (op.kind == Kind::LoopBegin || op.kind == Kind::LoopEnd) {
+                op.target += base;
+            }
+            code_.push_back(op);
+        }
+        for (const size_t guard : guards_) {
+            code_[guard].target += base;
+        }
+        slow_ = {};
+        guards_ = {};
+    }
+
+    void HotLoop::compile(const Expression &expression, Segment &segment) {
+        auto add = [&segment](uint32_t value) {
+            // 与紧挨着的同一单元的加减或赋值合并
+            if (!segment.fast.empty()) {
+                Op &last = segment.fast.back();
+                if ((last.kind == Kind::Add || last.kind == Kind::Set) && last.offset == segment.offset) {
+                    last.value += value;
+                    return;
+                }
+            }
+            segment.fast.push_back({Kind::Add, segment.offset, 0, 0, value});
+        };
+
+        switch (expression.symbol()) {
+        case '+':
+            add(static_cast<uint32_t>(static_cast<const IncrementExpression &>(expression).offset()));
+            break;
+        case '-':
+            add(-static_cast<uint32_t>(static_cast<const DecrementExpression &>(expression).offset()));
+            break;
+        case '>':
+            segment.offset += static_cast<const PointerForwardExpression &>(expression).offset();
+            break;
+        case '<':
+            segment.offset -= static_cast<const PointerBackwardExpression &>(expression).offset();
+            break;
+        case ',':
+            segment.fast.push_back({Kind::Input, segment.offset});
+            break;
+        case '.':
+            segment.fast.push_back({Kind::Output, segment.offset});
+            break;
+        case '[': {
+            const auto &loop = static_cast<const LoopExpression &>(expression);
+            if (compileSimpleLoop(loop, segment)) {
+                break;
+            }
+            // 一般的循环：先结束当前段，循环体里再各自分段
+            flush(segment);
+            const size_t begin = code_.size();
+            code_.push_back({Kind::LoopBegin});
+            Segment body;
+            for (const auto &child : loop.children()) {
+                compile(*child, body);
+            }
+            flush(body);
+            code_.push_back({Kind::LoopEnd, 0, 0, static_cast<uint32_t>(begin + 1)});
+            code_[begin].target = static_cast<uint32_t>(code_.size());
+            return;
+        }
+        default:
+            return;
+        }
+        segment.literal.push_back(&expression);
+        segment.low = std::min(segment.low, segment.offset);
+        segment.high = std::max(segment.high, segment.offset);
+    }
+
+    bool HotLoop::compileSimpleLoop(const LoopExpression &loop, Segment &segment) {
+        std::map<int64_t, uint32_t> deltas;
+        int64_t                     offset = 0, low = 0, high = 0;
+        for (const auto &child : loop.children()) {
+            switch (child->symbol()) {
+            case '+':
+                deltas[offset] += static_cast<uint32_t>(static_cast<const IncrementExpression &>(*child).offset());
+                break;
+            case '-':
+                deltas[offset] -= static_cast<uint32_t>(static_cast<const DecrementExpression &>(*child).offset());
+                break;
+            case '>':
+                offset += static_cast<const PointerForwardExpression &>(*child).offset();
+                break;
+            case '<':
+                offset -= static_cast<const PointerBackwardExpression &>(*child).offset();
+                break;
+            default:
+                return false;
+            }
+            low = std::min(low, offset);
+            high = std::max(high, offset);
+        }
+        const uint32_t step = deltas[0];
+        if (offset != 0 || (step != 1 && step != UINT32_MAX)) {
+            return false;
+        }
+
+        // 每轮减 1 时执行 cell 轮，加 1 时执行 -cell 轮（回绕到 0），其余单元按轮数乘上各自的增量
+        const int64_t base = segment.offset;
+        for (const auto &[at, delta] : deltas) {
+            if (at != 0 && delta != 0) {
+                segment.fast.push_back({Kind::MulAdd, base + at, base, 0, step == 1 ? -delta : delta});
+            }
+        }
+        segment.fast.push_back({Kind::Set, base, 0, 0, 0});
+        segment.literal.push_back(&loop);
+        segment.low = std::min(segment.low, base + low);
+        segment.high = std::max(segment.high, base + high);
+        return true;
+    }
+
+    void HotLoop::flush(Segment &segment) {
+        if (!segment.literal.empty()) {
+            guards_.push_back(code_.size());
+            code_.push_back({Kind::Guard, segment.low, segment.high, static_cast<uint32_t>(slow_.size())});
+            code_.insert(code_.end(), segment.fast.begin(), segment.fast.end());
+            if (segment.offset != 0) {
+                code_.push_back({Kind::Move, segment.offset});
+            }
+            for (const Expression *expression : segment.literal) {
+                compileLiteral(*expression, slow_);
+            }
+            slow_.push_back({Kind::Jump, 0, 0, static_cast<uint32_t>(code_.size())});
+        }
+        segment = Segment();
+    }
+
+    void HotLoop::compileLiteral(const Expression &expression, std::vector<Op> &out) {
+        switch (expression.symbol()) {
+        case '+':
+            out.push_back({Kind::Add, 0, 0, 0, static_cast<uint32_t>(static_cast<const IncrementExpression &>(expression).offset())});
+            break;
+        case '-':
+            out.push_back({Kind::Add, 0, 0, 0, -static_cast<uint32_t>(static_cast<const DecrementExpression &>(expression).offset())});
+            break;
+        case '>':
+            out.push_back({Kind::MoveChecked, static_cast<const PointerForwardExpression &>(expression).offset()});
+            break;
+        case '<':
+            out.push_back({Kind::MoveChecked, -static_cast<int64_t>(static_cast<const PointerBackwardExpression &>(expression).offset())});
+            break;
+        case ',':
+            out.push_back({Kind::Input});
+            break;
+        case '.':
+            out.push_back({Kind::Output});
+            break;
+        case '[': {
+            // 慢路径里只会出现简单循环，按原样逐条执行
+            const size_t begin = out.size();
+            out.push_back({Kind::LoopBegin});
+            for (const auto &child : static_cast<const LoopExpression &>(expression).children()) {
+                compileLiteral(*child, out);
+            }
+            out.push_back({Kind::LoopEnd, 0, 0, static_cast<uint32_t>(begin + 1)});
+            out[begin].target = static_cast<uint32_t>(out.size());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void HotLoop::run(Runner &runner) const {
+        constexpr auto kCells = static_cast<int64_t>(Memory<>::kCells);
+
+        auto         &memory = runner.memory();
+        unsigned int *cells = memory.cells();
+        int64_t       p = static_cast<int64_t>(memory.pointer());
+        const Op     *code = code_.data();
+
+        for (size_t pc = 0;; ++pc) {
+            const Op &op = code[pc];
+            switch (op.kind) {
+            case Kind::Guard:
+                if (p + op.offset < 0 || p + op.source >= kCells) {
+                    pc = op.target - 1;
+                } else {
+                    memory.touchRange(static_cast<size_t>(p + op.offset), static_cast<size_t>(p + op.source + 1));
+                }
+                break;
+            case Kind::Add:
+                cells[p + op.offset] += op.value;
+                break;
+            case Kind::Set:
+                cells[p + op.offset] = op.value;
+                break;
+            case Kind::MulAdd:
+                cells[p + op.offset] += cells[p + op.source] * op.value;
+                break;
+            case Kind::Move:
+                p += op.offset;
+                break;
+            case Kind::MoveChecked:
+                if (op.offset > 0 && p + op.offset >= kCells) {
+                    utils::ErrorHandler::getInstance().makeError("[BFE01]: Memory pointer forward out of bounds", 0);
+                } else if (op.offset < 0 && p + op.offset < 0) {
+                    utils::ErrorHandler::getInstance().makeError("[BFE02]: Memory pointer backward out of bounds", 0);
+                } else {
+                    p += op.offset;
+                    memory.touchRange(static_cast<size_t>(p), static_cast<size_t>(p + 1));
+                }
+                break;
+            case Kind::Input: {
+                const int ch = runner.input().get();
+                if (ch == EOF) {
+                    utils::ErrorHandler::getInstance().makeWarning("[BFW01]: Input stream reached EOF.", 0);
+                } else {
+                    cells[p + op.offset] = static_cast<unsigned int>(ch);
+                }
+                break;
+            }
+            case Kind::Output:
+                runner.output().put(static_cast<char>(cells[p + op.offset]));
+                break;
+            case Kind::LoopBegin:
+                if (cells[p] == 0) {
+                    pc = op.target - 1;
+                }
+                break;
+            case Kind::LoopEnd:
+                if (cells[p] != 0) {
+                    pc = op.target - 1;
+                }
+                break;
+            case Kind::Jump:
+                pc = op.target - 1;
+                break;
+            case Kind::End:
+                memory.setPointer(static_cast<size_t>(p));
+                return;
+            }
+        }
+    }
+} // namespace Rikkyu::Brainfuck
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef RIK_BF_HOT_LOOP
+#define RIK_BF_HOT_LOOP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace Rikkyu::Brainfuck {
+    // 热循环的第二层：把一个 LoopExpression（连同嵌套的循环）编译成直接操作 Runner 纸带的线性字节码。
+    //   - 两个循环之间的直线代码合成一段：指针移动推迟到段尾，中间的读写改为相对偏移，同一单元的加减合并；
+    //   - 只含加减和移动、净移动为 0、起点单元每轮 ±1 的循环（[-]、[->+<] 一类）变成乘加和清零，放进所在的段；
+    //   - 每段开头检查一次这段会碰到的单元是否都在纸带内。检查不通过时改走逐条执行的慢路径，
+    //     越界报错和指针不动的行为与树解释器完全相同。
+    class HotLoop {
+    public:
+        explicit HotLoop(const LoopExpression &loop);
+        ~HotLoop() = default;
+
+        // 从循环开头（条件判断）执行到循环结束
+        void run(Runner &runner) const;
+
+    private:
+        enum class Kind : uint8_t {
+            Guard,       // p + offset .. p + source 不在纸带内时跳到 target（慢路径）
+            Add,         // cell[p + offset] += value
+            Set,         // cell[p + offset] = value
+            MulAdd,      // cell[p + offset] += cell[p + source] * value
+            Move,        // p += offset，已经由 Guard 检查过
+            MoveChecked, // 与 PointerForward / PointerBackwardExpression 相同：越界时报错，指针不动
+            Input,       // cell[p + offset] = getchar()，EOF 时警告并保持不变
+            Output,      // putchar(cell[p + offset])
+            LoopBegin,   // cell[p] == 0 时跳到 target
+            LoopEnd,     // cell[p] != 0 时跳到 target
+            Jump,
+            End
+        };
+
+        struct Op {
+            Kind     kind;
+            int64_t  offset = 0;
+            int64_t  source = 0;
+            uint32_t target = 0;
+            uint32_t value = 0;
+        };
+
+        // 正在合并的一段直线代码
+        struct Segment {
+            std::vector<Op>                 fast;    // 快路径，偏移相对于段开头的指针
+            std::vector<const Expression *> literal; // 原始表达式，慢路径逐条执行
+            int64_t                         offset = 0; // 推迟的指针移动
+            int64_t                         low = 0;    // 碰到的偏移范围 [low, high]
+            int64_t                         high = 0;
+        };
+
+        void compile(const Expression &expression, Segment &segment);
+        void flush(Segment &segment);
+        static bool compileSimpleLoop(const LoopExpression &loop, Segment &segment);
+        static void compileLiteral(const Expression &expression, std::vector<Op> &out);
+
+        std::vector<Op>     code_;
+        std::vector<Op>     slow_;   // 各段的慢路径，编译完接在 code_ 后面
+        std::vector<size_t> guards_; // code_ 里目标指向 slow_ 的 Guard
+    };
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_HOT_LOOP
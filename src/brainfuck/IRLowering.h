@@ -0,0 +1,99 @@
+#pragma once
+#ifndef RIK_BF_IR_LOWERING
+#define RIK_BF_IR_LOWERING
+
+#include <cstdint>
+
+#include "../ir/IR.h"
+#include "interpreter.h"
+
+namespace Rikkyu::Brainfuck {
+    // 把表达式树降低为共用 IR，之后的优化和执行（IR::VM / IR::CBackend）与 Whitespace 共用。
+    // 单元格与 Memory<> 一致：30000 个 32 位无符号整数，越界移动指针报 BFE01 / BFE02 并忽略这次移动，与 Runner 相同。
+    class IRLowering : public ExpressionVisitor {
+    public:
+        IRLowering() = default;
+        ~IRLowering() = default;
+
+        IR::Module lower(const ExpressionVector &expressions) {
+            return lower(expressions.begin(), expressions.end());
+        }
+
+        // 只降低顶层的一段表达式，仍以 Halt 结尾；用 IR::Module::append 拼接
+        IR::Module lower(ExpressionVector::const_iterator begin, ExpressionVector::const_iterator end) {
+            module_ = IR::Module();
+            module_.tapeCells = 30000;
+            module_.cellBits = 32;
+            module_.setTrap(IR::Trap::PointerForward, "[BFE01]: Memory pointer forward out of bounds");
+            module_.setTrap(IR::Trap::PointerBackward, "[BFE02]: Memory pointer backward out of bounds");
+            module_.setTrap(IR::Trap::EndOfInput, "[BFW01]: Input stream reached EOF.");
+
+            for (auto it = begin; it != end; ++it) {
+                (*it)->accept(*this);
+            }
+            module_.emit(IR::Instruction::of(IR::Op::Halt));
+            return std::move(module_);
+        }
+
+        void visit(const IncrementExpression &expression) override {
+            add(IR::Op::Add, expression.offset());
+        }
+
+        void visit(const DecrementExpression &expression) override {
+            add(IR::Op::Sub, expression.offset());
+        }
+
+        void visit(const PointerForwardExpression &expression) override {
+            module_.emit(IR::Instruction::unary(IR::Op::MovePointer, -1, IR::Operand::i(expression.offset())));
+        }
+
+        void visit(const PointerBackwardExpression &expression) override {
+            module_.emit(IR::Instruction::unary(IR::Op::MovePointer, -1, IR::Operand::i(-static_cast<int64_t>(expression.offset()))));
+        }
+
+        void visit(const InputExpression &) override {
+            // 输入结束时 ReadChar 报 BFW01，单元格保持不变
+            const int32_t value = module_.newRegister();
+            module_.emit(IR::Instruction::of(IR::Op::ReadChar, value));
+            const size_t skip = module_.emit(IR::Instruction::branch(IR::Op::JumpNegative, 0, IR::Operand::r(value)));
+            module_.emit(IR::Instruction::unary(IR::Op::StoreTape, -1, IR::Operand::r(value)));
+            module_.code[skip].target = static_cast<int32_t>(module_.code.size());
+        }
+
+        void visit(const OutputExpression &) override {
+            module_.emit(IR::Instruction::unary(IR::Op::WriteChar, -1, IR::Operand::r(load())));
+        }
+
+        void visit(const LoopExpression &expression) override {
+            // 入口先判断一次，循环体末尾再判断是否回到开头
+            const size_t exit = module_.emit(IR::Instruction::branch(IR::Op::JumpZero, 0, IR::Operand::r(load())));
+            const size_t body = module_.code.size();
+            lowerAll(expression.children());
+            module_.emit(IR::Instruction::branch(IR::Op::JumpNonZero, static_cast<int32_t>(body), IR::Operand::r(load())));
+            module_.code[exit].target = static_cast<int32_t>(module_.code.size());
+        }
+
+    private:
+        void lowerAll(const ExpressionVector &expressions) {
+            for (const auto &expression : expressions) {
+                expression->accept(*this);
+            }
+        }
+
+        int32_t load() {
+            const int32_t value = module_.newRegister();
+            module_.emit(IR::Instruction::of(IR::Op::LoadTape, value));
+            return value;
+        }
+
+        void add(IR::Op op, int64_t amount) {
+            const int32_t value = module_.newRegister();
+            module_.emit(IR::Instruction::binary(op, value, IR::Operand::r(load()), IR::Operand::i(amount)));
+            module_.emit(IR::Instruction::unary(IR::Op::StoreTape, -1, IR::Operand::r(value)));
+        }
+
+        IR::Module module_;
+    };
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_IR_LOWERING
@@ -0,0 +1,96 @@
+#include "LoopCache.h"
+
+#include <algorithm>
+
+namespace Rikkyu::Brainfuck {
+    void LoopExpression::measure() {
+        int64_t offset = 0;
+        bool    pure = true, nested = false;
+        for (const auto &child : children_) {
+            switch (child->symbol()) {
+            case '>':
+                offset += static_cast<const PointerForwardExpression &>(*child).offset();
+                break;
+            case '<':
+                offset -= static_cast<const PointerBackwardExpression &>(*child).offset();
+                break;
+            case ',':
+            case '.':
+                pure = false;
+                break;
+            case '[': {
+                const auto &loop = static_cast<const LoopExpression &>(*child);
+                pure = pure && loop.pure_;
+                nested = true;
+                low_ = std::min(low_, offset + loop.low_);
+                high_ = std::max(high_, offset + loop.high_);
+                break;
+            }
+            default:
+                break;
+            }
+            low_ = std::min(low_, offset);
+            high_ = std::max(high_, offset);
+        }
+        pure_ = pure && offset == 0;
+        memoizable_ = pure_ && nested;
+    }
+
+    bool LoopCache::run(const LoopExpression &loop, Runner &runner) {
+        constexpr auto kCells = static_cast<int64_t>(Memory<>::kCells);
+
+        auto         &memory = runner.memory();
+        const auto    p = static_cast<int64_t>(memory.pointer());
+        const int64_t low = loop.windowLow(), high = loop.windowHigh();
+        const auto    width = static_cast<size_t>(high - low + 1);
+        // 整个窗口都在纸带内时循环不会越界报错，结果才只取决于窗口
+        if (width > limits_.maxWindow || p + low < 0 || p + high >= kCells) {
+            ++stats_.bypassed;
+            return false;
+        }
+
+        unsigned int  *window = memory.cells() + p + low;
+        const uint64_t key = hash(loop, window, width);
+        const auto     found = index_.find(key);
+        if (found != index_.end()) {
+            const Entry &entry = entries_[found->second];
+            const auto  *saved = cells_.data() + entry.offset;
+            if (entry.loop == &loop && std::equal(window, window + width, saved)) {
+                std::copy(saved + width, saved + 2 * width, window);
+                memory.touchRange(static_cast<size_t>(p + low), static_cast<size_t>(p + high + 1));
+                ++stats_.hits;
+                return true;
+            }
+        }
+        ++stats_.misses;
+
+        // 循环里嵌套的循环也会查表、写表，入口窗口先复制出来
+        const std::vector<unsigned int> entry(window, window + width);
+        loop.iterate(runner);
+
+        if (cells_.size() + 2 * width > limits_.maxCells) {
+            clear();
+            ++stats_.flushes;
+        }
+        index_[key] = entries_.size();
+        entries_.push_back({&loop, cells_.size()});
+        cells_.insert(cells_.end(), entry.begin(), entry.end());
+        cells_.insert(cells_.end(), window, window + width);
+        return true;
+    }
+
+    void LoopCache::clear() {
+        index_.clear();
+        entries_.clear();
+        cells_.clear();
+    }
+
+    uint64_t LoopCache::hash(const LoopExpression &loop, const unsigned int *window, size_t width) {
+        // FNV-1a，以循环的地址作为初值的一部分
+        uint64_t h = 0xCBF29CE484222325ULL ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&loop));
+        for (size_t i = 0; i < width; ++i) {
+            h = (h ^ window[i]) * 0x100000001B3ULL;
+        }
+        return h;
+    }
+} // namespace Rikkyu::Brainfuck
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef RIK_BF_LOOP_CACHE
+#define RIK_BF_LOOP_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace Rikkyu::Brainfuck {
+    // 纯循环的结果记忆，通过 Runner::setLoopCache 开启。
+    // LoopExpression::memoizable() 的循环只读写入口指针附近一段固定的窗口，出口时指针回到入口，
+    // 执行结果完全由入口时窗口的内容决定：以（循环，入口窗口）为键记下出口窗口，
+    // 再次以相同的内容进入同一个循环时直接写回，跳过整个循环。
+    // 只记忆含有嵌套循环的循环，单层的已经由 HotLoop 变成常数时间的乘加，查表反而更慢。
+    class LoopCache {
+    public:
+        struct Limits {
+            size_t maxWindow = 64;                // 窗口超过这么多单元的循环不记忆
+            size_t maxCells = size_t(1) << 22;    // 所有条目保存的单元总数，再存就先整个清空
+        };
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;   // 没有记录（或哈希冲突），执行后记下
+            uint64_t bypassed = 0; // 窗口太宽或超出纸带，直接执行
+            uint64_t flushes = 0;  // 因为超过 maxCells 清空的次数
+        };
+
+        LoopCache() = default;
+        explicit LoopCache(Limits limits) : limits_(limits) {}
+        ~LoopCache() = default;
+
+        // 由 LoopExpression::run 调用：命中时写回窗口，未命中时执行循环并记下结果，都返回 true；
+        // 不适合记忆时返回 false，由调用者照常执行
+        bool run(const LoopExpression &loop, Runner &runner);
+
+        [[nodiscard]] const Stats &stats() const {
+            return stats_;
+        }
+
+        [[nodiscard]] size_t entries() const {
+            return entries_.size();
+        }
+
+        // 丢弃所有条目，统计保留
+        void clear();
+
+    private:
+        struct Entry {
+            const LoopExpression *loop;
+            size_t                offset; // cells_ 中先是入口窗口，紧接着是出口窗口
+        };
+
+        static uint64_t hash(const LoopExpression &loop, const unsigned int *window, size_t width);
+
+        Limits                               limits_;
+        Stats                                stats_;
+        std::unordered_map<uint64_t, size_t> index_; // 哈希 -> entries_ 下标，冲突时新条目覆盖旧的
+        std::vector<Entry>                   entries_;
+        std::vector<unsigned int>            cells_;
+    };
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_LOOP_CACHE
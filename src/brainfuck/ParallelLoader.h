@@ -0,0 +1,202 @@
+#pragma once
+#ifndef RIK_BF_PARALLEL_LOADER
+#define RIK_BF_PARALLEL_LOADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "../ir/PassManager.h"
+#include "../utils/SourceFilter/SourceFilter.h"
+#include "IRLowering.h"
+#include "interpreter.h"
+
+namespace Rikkyu::Brainfuck {
+    // 多线程解析和优化很大的 Brainfuck 源码，结果与 Parser + IRLowering + PassManager::standard() 相同。
+    //
+    // 解析：先把源码等分成若干片，并行统计每片的括号深度净变化和最低前缀深度，串行累加得到每片开头的深度
+    // 并检查括号匹配；再在每片里找第一个顶层 ']' 之后的位置作为切分点。切分点前一项总是循环，不会与后面的
+    // 指令合并，所以各段可以独立解析后直接拼接。括号不匹配时按全局位置报告与 Parser 相同的 BFE03。
+    //
+    // 优化：顶层表达式按源码位置均分成若干段，只在循环之后切开（循环出口本来就是基本块的开头），
+    // 每段独立降低和优化，再用 IR::Module::append 拼接。
+    //
+    // 源码小于 kMinChunk 时直接串行处理。
+    class ParallelLoader {
+    public:
+        static constexpr size_t kMinChunk = size_t(1) << 20;
+
+        explicit ParallelLoader(size_t threads = 0)
+            : threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+        ~ParallelLoader() = default;
+
+        ExpressionVector parse(const TokenVector &tokens) const {
+            const size_t size = tokens.size();
+            const size_t slices = std::min(size / kMinChunk, threads_ * 4);
+            if (threads_ == 1 || slices < 2) {
+                return Parser().parse(tokens.data(), size);
+            }
+            const char *data = tokens.data();
+            auto        sliceBegin = [size, slices](size_t slice) {
+                return slice == slices ? size : size / slices * slice;
+            };
+
+            // 每片的深度净变化和片内最低前缀深度
+            std::vector<int64_t> net(slices), lowest(slices);
+            forEach(slices, [&](size_t slice) {
+                int64_t depth = 0, low = 0;
+                forEachBracket(data, sliceBegin(slice), sliceBegin(slice + 1), [&](size_t i) {
+                    depth += data[i] == '[' ? 1 : -1;
+                    low = std::min(low, depth);
+                    return true;
+                });
+                net[slice] = depth;
+                lowest[slice] = low;
+            });
+
+            std::vector<int64_t> start(slices + 1, 0);
+            for (size_t slice = 0; slice < slices; ++slice) {
+                if (start[slice] + lowest[slice] < 0) {
+                    // 这一片里有多余的 ']'，重新扫一遍找到第一个
+                    int64_t depth = start[slice];
+                    size_t  position = 0;
+                    forEachBracket(data, sliceBegin(slice), sliceBegin(slice + 1), [&](size_t i) {
+                        depth += data[i] == '[' ? 1 : -1;
+                        position = i + 1;
+                        return depth >= 0;
+                    });
+                    utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched ']'", position);
+                    return {};
+                }
+                start[slice + 1] = start[slice] + net[slice];
+            }
+            if (start[slices] != 0) {
+                utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched '['", size);
+                return {};
+            }
+
+            // cuts[slice]：该片内第一个顶层 ']' 之后的位置，没有则为 0
+            std::vector<size_t> cuts(slices, 0);
+            forEach(slices - 1, [&](size_t index) {
+                const size_t slice = index + 1;
+                int64_t      depth = start[slice];
+                forEachBracket(data, sliceBegin(slice), sliceBegin(slice + 1), [&](size_t i) {
+                    if (data[i] == '[') {
+                        ++depth;
+                    } else if (--depth == 0) {
+                        cuts[slice] = i + 1;
+                        return false;
+                    }
+                    return true;
+                });
+            });
+            std::vector<size_t> bounds{0};
+            for (const size_t cut : cuts) {
+                if (cut > bounds.back() && cut < size) {
+                    bounds.push_back(cut);
+                }
+            }
+            bounds.push_back(size);
+
+            std::vector<ExpressionVector> parts(bounds.size() - 1);
+            forEach(parts.size(), [&](size_t part) {
+                parts[part] = Parser().parse(data + bounds[part], bounds[part + 1] - bounds[part], bounds[part]);
+            });
+
+            size_t total = 0;
+            for (const auto &part : parts) {
+                total += part.size();
+            }
+            ExpressionVector expressions;
+            expressions.reserve(total);
+            for (auto &part : parts) {
+                std::move(part.begin(), part.end(), std::back_inserter(expressions));
+            }
+            return expressions;
+        }
+
+        // 降低并运行 PassManager::standard()
+        IR::Module lower(const ExpressionVector &expressions) const {
+            // 切分点：紧跟在循环之后的下标，每个按源码位置均分的点之后取第一个
+            const size_t span = expressions.empty() ? 0 : expressions.back()->position() - expressions.front()->position();
+            const size_t parts = std::min(span / kMinChunk, threads_ * 4);
+            std::vector<size_t> bounds{0};
+            if (threads_ > 1 && parts >= 2) {
+                const size_t first = expressions.front()->position();
+                for (size_t i = 1; i < expressions.size(); ++i) {
+                    const size_t target = first + span / parts * bounds.size();
+                    if (bounds.size() < parts && expressions[i - 1]->symbol() == '[' && expressions[i]->position() >= target) {
+                        bounds.push_back(i);
+                    }
+                }
+            }
+            bounds.push_back(expressions.size());
+
+            std::vector<IR::Module> modules(bounds.size() - 1);
+            forEach(modules.size(), [&](size_t part) {
+                modules[part] = IRLowering().lower(expressions.begin() + static_cast<ptrdiff_t>(bounds[part]),
+                                                   expressions.begin() + static_cast<ptrdiff_t>(bounds[part + 1]));
+                IR::PassManager::standard().run(modules[part]);
+            });
+
+            IR::Module module = std::move(modules.front());
+            for (size_t part = 1; part < modules.size(); ++part) {
+                module.append(std::move(modules[part]));
+            }
+            return module;
+        }
+
+    private:
+        // 按顺序对 [begin, end) 中每个括号的下标调用 visit，visit 返回 false 时停止。
+        // 括号位置由 SourceFilter 分块找出，中间的其他字符整块跳过
+        template <typename Visit>
+        static void forEachBracket(const char *data, size_t begin, size_t end, Visit &&visit) {
+            constexpr size_t      kBlock = size_t(1) << 16;
+            std::vector<uint32_t> positions;
+            for (size_t block = begin; block < end; block += kBlock) {
+                positions.clear();
+                utils::SourceFilter::brackets(data + block, std::min(kBlock, end - block), positions);
+                for (const uint32_t offset : positions) {
+                    if (!visit(block + offset)) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        // 在最多 threads_ 个线程上对 [0, count) 逐个调用 body
+        template <typename Body>
+        void forEach(size_t count, Body &&body) const {
+            const size_t workers = std::min(threads_, count);
+            if (workers <= 1) {
+                for (size_t i = 0; i < count; ++i) {
+                    body(i);
+                }
+                return;
+            }
+            std::atomic<size_t>      next{0};
+            std::vector<std::thread> threads;
+            threads.reserve(workers - 1);
+            auto work = [&] {
+                for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+                    body(i);
+                }
+            };
+            for (size_t i = 1; i < workers; ++i) {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+
+        size_t threads_;
+    };
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_PARALLEL_LOADER
@@ -0,0 +1,276 @@
+#pragma once
+#ifndef RIK_BF_STATIC_PROGRAM
+#define RIK_BF_STATIC_PROGRAM
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "defs/defs.hpp"
+
+namespace Rikkyu::Brainfuck {
+    // 编译期 Brainfuck：源码是编译期常量，解析和优化都在 constexpr 中完成，
+    // 每条指令实例化成一段内联代码，整个程序展开成一个普通的 C++ 函数，交给 C++ 编译器端到端优化，
+    // 运行时既没有解析也没有解释的开销。
+    //
+    //     static constexpr char kDouble[] = ",[->++<]>.";
+    //     using Double = Rikkyu::Brainfuck::StaticProgram<kDouble>;
+    //     Double::run(); // 读写标准输入输出
+    //
+    // 语义与 Parser + Runner 一致：30000 个 32 位无符号单元格，指针越界报 BFE01 / BFE02 并忽略这次移动，
+    // 输入结束时报 BFW01 并保持单元格不变。括号不匹配在编译期以 static_assert 报出 BFE03。
+    namespace StaticCompiler {
+        enum class OpKind : uint8_t {
+            Add,       // 单元格加上 value（模 2^32），连续的 + 和 - 合并成一条
+            Move,      // 指针移动 value，同方向的连续移动合并成一条，与 Parser 一样整段只检查一次越界
+            Input,
+            Output,
+            Clear,     // [-] 或 [+]
+            LoopBegin, // match 是对应 LoopEnd 的下标
+            LoopEnd
+        };
+
+        struct Op {
+            OpKind  kind = OpKind::Add;
+            int64_t value = 0;
+            size_t  match = 0;
+        };
+
+        // 源码的每个字符最多产生一条指令，所以 Capacity 取源码长度
+        template <size_t Capacity>
+        struct Parsed {
+            std::array<Op, Capacity> ops{};
+            size_t                   size = 0;
+            size_t                   unmatchedClose = 0; // 第一个多余的 ']' 的位置（从 1 开始），0 表示没有
+            size_t                   unmatchedOpen = 0;  // 最后一个没有闭合的 '[' 的位置（从 1 开始）
+        };
+
+        template <size_t Capacity>
+        constexpr Parsed<Capacity> parse(const char *source, size_t length) {
+            Parsed<Capacity>             result;
+            std::array<size_t, Capacity> opens{};
+            size_t                       depth = 0;
+            auto                        &ops = result.ops;
+            size_t                      &size = result.size;
+
+            for (size_t position = 0; position < length; ++position) {
+                const char token = source[position];
+                switch (token) {
+                case '+':
+                case '-': {
+                    const int64_t delta = token == '+' ? 1 : -1;
+                    if (size && ops[size - 1].kind == OpKind::Add) {
+                        ops[size - 1].value += delta;
+                    } else {
+                        ops[size++] = {OpKind::Add, delta, 0};
+                    }
+                    break;
+                }
+                case '>':
+                case '<': {
+                    const int64_t delta = token == '>' ? 1 : -1;
+                    if (size && ops[size - 1].kind == OpKind::Move && (ops[size - 1].value > 0) == (delta > 0)) {
+                        ops[size - 1].value += delta;
+                    } else {
+                        ops[size++] = {OpKind::Move, delta, 0};
+                    }
+                    break;
+                }
+                case ',':
+                    ops[size++] = {OpKind::Input, 0, 0};
+                    break;
+                case '.':
+                    ops[size++] = {OpKind::Output, 0, 0};
+                    break;
+                case '[':
+                    opens[depth++] = size;
+                    ops[size++] = {OpKind::LoopBegin, 0, 0};
+                    break;
+                case ']': {
+                    if (depth == 0) {
+                        result.unmatchedClose = position + 1;
+                        return result;
+                    }
+                    const size_t begin = opens[--depth];
+                    // 奇数步长的 [-] / [+] 在 32 位回绕下一定把单元格清零
+                    if (size == begin + 2 && ops[begin + 1].kind == OpKind::Add && (ops[begin + 1].value & 1)) {
+                        size = begin;
+                        ops[size++] = {OpKind::Clear, 0, 0};
+                        break;
+                    }
+                    ops[begin].match = size;
+                    ops[size++] = {OpKind::LoopEnd, 0, begin};
+                    break;
+                }
+                default:
+                    break;
+                }
+                // 合并后净值为 0 的 + / - 没有作用
+                if (size && ops[size - 1].kind == OpKind::Add && static_cast<uint32_t>(ops[size - 1].value) == 0) {
+                    --size;
+                }
+            }
+            if (depth) {
+                result.unmatchedOpen = opens[depth - 1] + 1;
+            }
+            return result;
+        }
+
+        // 标准输入输出，与 Runner 一样逐字符读写
+        struct StandardIO {
+            RIK_INLINE int get() {
+                return std::getchar();
+            }
+            RIK_INLINE void put(char c) {
+                std::putchar(c);
+            }
+        };
+
+        // 从字符串读、向字符串写，便于在服务里直接调用
+        struct StringIO {
+            const std::string *input = nullptr;
+            size_t             position = 0;
+            std::string        output;
+
+            RIK_INLINE int get() {
+                return input && position < input->size() ? static_cast<unsigned char>((*input)[position++]) : EOF;
+            }
+            RIK_INLINE void put(char c) {
+                output.push_back(c);
+            }
+        };
+    } // namespace StaticCompiler
+
+    // Source 必须是具有静态存储期的以 '\0' 结尾的字符数组
+    template <const char *Source>
+    class StaticProgram {
+        static constexpr size_t kLength = std::char_traits<char>::length(Source);
+        static constexpr auto   kParsed = StaticCompiler::parse<kLength + 1>(Source, kLength);
+
+        static_assert(kParsed.unmatchedClose == 0, "[BFE03]: Unmatched ']'");
+        static_assert(kParsed.unmatchedOpen == 0, "[BFE03]: Unmatched '['");
+
+        static constexpr bool kValid = kParsed.unmatchedClose == 0 && kParsed.unmatchedOpen == 0;
+
+    public:
+        static constexpr size_t kCells = 30000;
+        using Tape = std::array<uint32_t, kCells>;
+
+        // 优化后的指令条数
+        static constexpr size_t size() {
+            return kValid ? kParsed.size : 0;
+        }
+
+        // 在调用者提供的纸带上执行，纸带不会被清零。Input 需要 int get()（结束时返回 EOF），Output 需要 put(char)
+        template <typename Input, typename Output>
+        static void run(Tape &tape, Input &input, Output &output) {
+            Context<Input, Output> context{tape.data(), 0, input, output};
+            Block<0, size()>::run(context);
+        }
+
+        template <typename Input, typename Output>
+        static void run(Input &input, Output &output) {
+            auto tape = std::make_unique<Tape>();
+            run(*tape, input, output);
+        }
+
+        static void run() {
+            StaticCompiler::StandardIO io;
+            run(io, io);
+        }
+
+        static std::string run(const std::string &input) {
+            StaticCompiler::StringIO io;
+            io.input = &input;
+            run(io, io);
+            return std::move(io.output);
+        }
+
+    private:
+        template <typename Input, typename Output>
+        struct Context {
+            uint32_t *tape;
+            size_t    pointer;
+            Input    &input;
+            Output   &output;
+        };
+
+        // [Begin, End) 中最外层的指令：普通指令一条，循环算一条
+        template <size_t Begin, size_t End>
+        struct Block {
+            static constexpr size_t count() {
+                size_t count = 0;
+                for (size_t i = Begin; i < End; i = kParsed.ops[i].kind == StaticCompiler::OpKind::LoopBegin ? kParsed.ops[i].match + 1 : i + 1) {
+                    ++count;
+                }
+                return count;
+            }
+
+            static constexpr std::array<size_t, count()> items() {
+                std::array<size_t, count()> items{};
+                size_t                      n = 0;
+                for (size_t i = Begin; i < End; i = kParsed.ops[i].kind == StaticCompiler::OpKind::LoopBegin ? kParsed.ops[i].match + 1 : i + 1) {
+                    items[n++] = i;
+                }
+                return items;
+            }
+
+            static constexpr auto kItems = items();
+
+            template <typename Ctx>
+            static RIK_INLINE void run(Ctx &context) {
+                run(context, std::make_index_sequence<kItems.size()>());
+            }
+
+            template <typename Ctx, size_t... Is>
+            static RIK_INLINE void run(Ctx &context, std::index_sequence<Is...>) {
+                (execute<kItems[Is]>(context), ...);
+            }
+        };
+
+        template <size_t Index, typename Ctx>
+        static RIK_INLINE void execute(Ctx &context) {
+            using StaticCompiler::OpKind;
+            constexpr StaticCompiler::Op op = kParsed.ops[Index];
+            uint32_t                    &cell = context.tape[context.pointer];
+
+            if constexpr (op.kind == OpKind::Add) {
+                cell += static_cast<uint32_t>(op.value);
+            } else if constexpr (op.kind == OpKind::Move && op.value > 0) {
+                if (context.pointer + static_cast<size_t>(op.value) >= kCells) {
+                    utils::ErrorHandler::getInstance().makeError("[BFE01]: Memory pointer forward out of bounds", 0);
+                } else {
+                    context.pointer += static_cast<size_t>(op.value);
+                }
+            } else if constexpr (op.kind == OpKind::Move) {
+                if (context.pointer < static_cast<size_t>(-op.value)) {
+                    utils::ErrorHandler::getInstance().makeError("[BFE02]: Memory pointer backward out of bounds", 0);
+                } else {
+                    context.pointer -= static_cast<size_t>(-op.value);
+                }
+            } else if constexpr (op.kind == OpKind::Input) {
+                const int ch = context.input.get();
+                if (ch == EOF) {
+                    utils::ErrorHandler::getInstance().makeWarning("[BFW01]: Input stream reached EOF.", 0);
+                } else {
+                    cell = static_cast<uint32_t>(ch);
+                }
+            } else if constexpr (op.kind == OpKind::Output) {
+                context.output.put(static_cast<char>(cell));
+            } else if constexpr (op.kind == OpKind::Clear) {
+                cell = 0;
+            } else if constexpr (op.kind == OpKind::LoopBegin) {
+                while (context.tape[context.pointer]) {
+                    Block<Index + 1, op.match>::run(context);
+                }
+            }
+        }
+    };
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_STATIC_PROGRAM
@@ -1,17 +1,34 @@
-#include <array>
+#pragma once
+#ifndef RIK_BF_INTERPRETER
+#define RIK_BF_INTERPRETER
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <exception>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "../utils/BufferedIO/BufferedIO.h"
 #include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/Pool/ResettableBuffer.h"
+#include "../utils/SourceFilter/SourceFilter.h"
+#include "../utils/Trace/Trace.h"
 #include "AbstractExpression.h"
 #include "defs/defs.hpp"
 
 namespace Rikkyu::Brainfuck {
+    // 纸带。底层是 utils::ResettableBuffer，指针向右走到过的最远位置就是脏区的上界，
+    // reset() 只清理这一段，池化的 Runner 复用时不需要重新清零整条纸带。
     template <typename Tp = unsigned int>
     class Memory {
     public:
-        Memory() : memory_(), ptr_(memory_.begin()) {}
+        static constexpr size_t kCells = 30000;
+
+        Memory() : memory_(kCells), ptr_(memory_.data()) {
+            memory_.touch(0);
+        }
         ~Memory() = default;
 
         RIK_INLINE void memory_byteIncrease(Tp offset) {
@@ -23,15 +40,16 @@ namespace Rikkyu::Brainfuck {
         }
 
         RIK_INLINE bool memory_pointerShiftForward(ssize_t offset) {
-            if (ptr_ + offset >= memory_.end()) {
+            if (ptr_ + offset >= memory_.data() + kCells) {
                 return false;
             }
             this->ptr_ += offset;
+            memory_.touch(static_cast<size_t>(ptr_ - memory_.data()));
             return true;
         }
 
         RIK_INLINE bool memory_pointerShiftBackward(ssize_t offset) {
-            if (ptr_ - offset < memory_.begin()) {
+            if (ptr_ - offset < memory_.data()) {
                 return false;
             }
             this->ptr_ -= offset;
@@ -46,14 +64,40 @@ namespace Rikkyu::Brainfuck {
             *this->ptr_ = c;
         }
 
+        // 供 HotLoop 直接读写：单元格首地址和指针下标。越过指针写入前要用 touchRange() 登记
+        [[nodiscard]] RIK_INLINE Tp *cells() {
+            return memory_.data();
+        }
+
+        [[nodiscard]] RIK_INLINE size_t pointer() const {
+            return static_cast<size_t>(ptr_ - memory_.data());
+        }
+
+        RIK_INLINE void setPointer(size_t index) {
+            ptr_ = memory_.data() + index;
+        }
+
+        RIK_INLINE void touchRange(size_t first, size_t last) {
+            memory_.touchRange(first, last);
+        }
+
+        // 清零走到过的单元并把指针移回起点
+        void reset() {
+            memory_.reset();
+            memory_.touch(0);
+            ptr_ = memory_.data();
+        }
+
     private:
-        std::array<Tp, 30000>                memory_;
-        typename decltype(memory_)::iterator ptr_;
+        utils::ResettableBuffer<Tp> memory_;
+        Tp                         *ptr_;
     };
 
     using ExpressionPtr = std::unique_ptr<Expression>;
     using ExpressionVector = std::vector<ExpressionPtr>;
 
+    class LoopCache;
+
     class Runner {
     public:
         Runner() : memory_() {}
@@ -63,14 +107,67 @@ namespace Rikkyu::Brainfuck {
             return memory_;
         };
 
+        void setIO(utils::BufferedInput &input, utils::BufferedOutput &output) {
+            input_ = &input;
+            output_ = &output;
+        }
+
+        [[nodiscard]] utils::BufferedInput &input() const {
+            return *input_;
+        }
+
+        [[nodiscard]] utils::BufferedOutput &output() const {
+            return *output_;
+        }
+
+        // 可选的循环结果记忆，nullptr 为关闭（默认）。cache 由调用者持有，同一时间只能给一个 Runner 使用
+        void setLoopCache(LoopCache *cache) {
+            loopCache_ = cache;
+        }
+
+        [[nodiscard]] LoopCache *loopCache() const {
+            return loopCache_;
+        }
+
+        // 供 utils::RunnerPool 复用：只清理上一次运行碰过的纸带
+        void reset() {
+            memory_.reset();
+        }
+
+        // 执行整个程序，结束时刷新输出
         void run(const ExpressionVector &expressions) {
+            runBlock(expressions);
+            output_->flush();
+        }
+
+        // 执行一段指令，循环体由 LoopExpression 通过这里执行
+        void runBlock(const ExpressionVector &expressions) {
             for (const auto &expression : expressions) {
                 expression->run(*this);
             }
         }
 
+        // 以编译期选择的跟踪策略执行；utils::NoTrace 与上面的 run 完全相同
+        template <typename Tracer>
+        void run(const ExpressionVector &expressions, Tracer &tracer) {
+            runBlock(expressions, tracer);
+            output_->flush();
+        }
+
+        // 把每一步执行记录到 trace 中，用 utils::decodeTrace 转换成文本
+        void run(const ExpressionVector &expressions, utils::TraceRing &trace) {
+            utils::RingTracer tracer(trace);
+            run(expressions, tracer);
+        }
+
     private:
-        Memory<> memory_;
+        template <typename Tracer>
+        void runBlock(const ExpressionVector &expressions, Tracer &tracer);
+
+        Memory<>               memory_;
+        utils::BufferedInput  *input_ = &utils::BufferedInput::standardInput();
+        utils::BufferedOutput *output_ = &utils::BufferedOutput::standardOutput();
+        LoopCache             *loopCache_ = nullptr;
     };
 
     class IncrementExpression : public Expression {
@@ -79,6 +176,9 @@ namespace Rikkyu::Brainfuck {
         void run(Runner &runner) const override {
             runner.memory().memory_byteIncrease(offset_);
         }
+        [[nodiscard]] char symbol() const override {
+            return '+';
+        }
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
@@ -102,6 +202,9 @@ namespace Rikkyu::Brainfuck {
         void run(Runner &runner) const override {
             runner.memory().memory_byteDecrease(offset_);
         }
+        [[nodiscard]] char symbol() const override {
+            return '-';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -127,6 +230,9 @@ namespace Rikkyu::Brainfuck {
                 utils::ErrorHandler::getInstance().makeError("[BFE01]: Memory pointer forward out of bounds", 0);
             }
         }
+        [[nodiscard]] char symbol() const override {
+            return '>';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -152,6 +258,9 @@ namespace Rikkyu::Brainfuck {
                 utils::ErrorHandler::getInstance().makeError("[BFE02]: Memory pointer backward out of bounds", 0);
             }
         }
+        [[nodiscard]] char symbol() const override {
+            return '<';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -172,13 +281,16 @@ namespace Rikkyu::Brainfuck {
     class InputExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            int ch = getchar();
+            int ch = runner.input().get();
             if (ch == EOF) {
                 utils::ErrorHandler::getInstance().makeWarning("[BFW01]: Input stream reached EOF.", 0);
                 return;
             }
             runner.memory().memory_pointerByteWriteData(static_cast<unsigned int>(ch));
         }
+        [[nodiscard]] char symbol() const override {
+            return ',';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -193,10 +305,12 @@ namespace Rikkyu::Brainfuck {
     class OutputExpression : public Expression {
     public:
         virtual void run(Runner &runner) const {
-            putchar(runner.memory().memory_pointerByteReadData());
-            fflush(stdout);
+            runner.output().put(static_cast<char>(runner.memory().memory_pointerByteReadData()));
         }
 
+        [[nodiscard]] char symbol() const override {
+            return '.';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -208,11 +322,23 @@ namespace Rikkyu::Brainfuck {
         virtual void repeat() {}
     };
 
+    class HotLoop;
+
+    // 分层执行：循环先在树解释器里运行并累计迭代次数，超过 kHotIterations 后在下一次迭代开始处
+    // 编译成 HotLoop 字节码接着执行（循环的全部状态就是纸带和指针，不需要额外的栈上替换），
+    // 之后每次进入这个循环都直接执行字节码。实现见 HotLoop.cpp
+    //
+    // 构造时顺便算出循环的读写范围（见 LoopCache.cpp），Runner 开启了 LoopCache 时，可记忆的循环先查表
     class LoopExpression : public Expression {
     public:
+        static constexpr uint32_t kHotIterations = 1024;
+
         explicit LoopExpression(ExpressionVector &&children)
             : Expression(),
-              children_(std::move(children)) {}
+              children_(std::move(children)) {
+            measure();
+        }
+        ~LoopExpression() override;
 
         LoopExpression(const LoopExpression &) = delete;
 
@@ -220,12 +346,25 @@ namespace Rikkyu::Brainfuck {
             return children_;
         }
 
-        void run(Runner &runner) const override {
-            while (runner.memory().memory_pointerByteReadData() > 0) {
-                runner.run(children_);
-            }
+        // 不做 I/O、自身和嵌套的循环每轮都不净移动指针，并且含有嵌套循环：执行结果只取决于窗口的内容
+        [[nodiscard]] bool memoizable() const {
+            return memoizable_;
+        }
+
+        // 循环读写的单元相对入口指针的范围 [windowLow(), windowHigh()]，只在 memoizable() 时有意义
+        [[nodiscard]] int64_t windowLow() const {
+            return low_;
         }
 
+        [[nodiscard]] int64_t windowHigh() const {
+            return high_;
+        }
+
+        void run(Runner &runner) const override;
+
+        [[nodiscard]] char symbol() const override {
+            return '[';
+        }
         virtual void accept(ExpressionVisitor &visitor) const {
             visitor.visit(*this);
         }
@@ -237,9 +376,57 @@ namespace Rikkyu::Brainfuck {
         void repeat() override {}
 
     private:
+        friend class LoopCache;
+
+        // 不经过 LoopCache 执行整个循环
+        void iterate(Runner &runner) const;
+
+        // 编译并发布 HotLoop，别的线程已经发布过时用它的
+        const HotLoop *promote() const;
+
+        // 由子表达式（嵌套循环用它们自己的结果）算出 pure_、memoizable_ 和窗口
+        void measure();
+
         ExpressionVector children_;
+        bool             pure_ = false; // 不做 I/O，所有层次都不净移动指针
+        bool             memoizable_ = false;
+        int64_t          low_ = 0;
+        int64_t          high_ = 0;
+        // 同一棵树可能被多个 Runner 同时执行：计数丢几次无所谓，编译结果用比较交换发布
+        mutable std::atomic<uint32_t>  heat_{0};
+        mutable std::atomic<HotLoop *> hot_{nullptr};
     };
 
+    // 跟踪事件的 op 是 symbol() 在 "+-><,.[" 中的下标
+    inline std::vector<std::string> traceOpcodeNames() {
+        return {"INC", "DEC", "RIGHT", "LEFT", "IN", "OUT", "LOOP"};
+    }
+
+    template <typename Tracer>
+    void Runner::runBlock(const ExpressionVector &expressions, Tracer &tracer) {
+        if constexpr (!Tracer::enabled) {
+            runBlock(expressions);
+        } else {
+            static constexpr char kSymbols[] = "+-><,.[";
+            for (const auto &expression : expressions) {
+                const char symbol = expression->symbol();
+                tracer.record(static_cast<uint32_t>(expression->position()),
+                              static_cast<uint16_t>(std::char_traits<char>::find(kSymbols, 7, symbol) - kSymbols),
+                              utils::TF_HasValue,
+                              static_cast<int64_t>(memory_.memory_pointerByteReadData()));
+                if (symbol == '[') {
+                    // 循环体也要带着跟踪策略执行，不能走 LoopExpression::run
+                    const auto &children = static_cast<const LoopExpression &>(*expression).children();
+                    while (memory_.memory_pointerByteReadData() > 0) {
+                        runBlock(children, tracer);
+                    }
+                } else {
+                    expression->run(*this);
+                }
+            }
+        }
+    }
+
     using TokenVector = std::vector<char>;
 
     class Parser {
@@ -248,77 +435,149 @@ namespace Rikkyu::Brainfuck {
         ~Parser() = default;
 
         ExpressionVector parse(TokenVector &);
+        // 解析 [tokens, tokens + size)，位置（包括错误位置）从 base 开始计数，供分段并行解析使用
+        ExpressionVector parse(const char *tokens, size_t size, size_t base = 0);
+
+        // 增量解析（REPL）：接着之前 feed 过的源码解析新的一段，返回到这段末尾为止已经完整的顶层表达式。
+        // 未闭合的 '[' 连同其中已解析的内容留在栈上，等之后的源码闭合；位置按整个会话累计。
+        // 多余的 ']' 报 BFE03，并丢弃还没有返回的内容
+        ExpressionVector feed(const char *tokens, size_t size);
+
+        // 尚未闭合的 '[' 个数
+        [[nodiscard]] size_t openLoops() const {
+            return stack_.size();
+        }
 
     private:
+        using ExpressionVectorPtr = std::unique_ptr<ExpressionVector>;
+
+        // 把 [tokens, tokens + size) 解析进当前状态；遇到多余的 ']' 时报错并返回 false
+        bool consume(const char *tokens, size_t size);
+
+        // 丢弃未完成的内容，位置计数不变
+        void clear() {
+            stack_.clear();
+            loopPositions_.clear();
+            expressions_ = std::make_unique<ExpressionVector>();
+        }
+
 //        utils::ErrorHandler handler;
+        std::vector<ExpressionVectorPtr> stack_;
+        std::vector<size_t>              loopPositions_;
+        ExpressionVectorPtr              expressions_ = std::make_unique<ExpressionVector>();
+        size_t                           position_ = 0;
     };
 
-    ExpressionVector Parser::parse(TokenVector &tokens) {
-        using ExpressionVectorPtr = std::unique_ptr<ExpressionVector>;
-
-        std::vector<ExpressionVectorPtr> stack;
-        ExpressionVectorPtr              expressions(new ExpressionVector());
-        size_t                           position = 0;
-
-        for (auto token : tokens) {
-            ExpressionPtr next;
-            position++;
-
-            switch (token) {
-            case '+':
-                next = ExpressionPtr(new IncrementExpression(1));
-                break;
-            case '-':
-                next = ExpressionPtr(new DecrementExpression(1));
-                break;
-            case '>':
-                next = ExpressionPtr(new PointerForwardExpression(1));
-                break;
-            case '<':
-                next = ExpressionPtr(new PointerBackwardExpression(1));
-                break;
-            case ',':
-                next = ExpressionPtr(new InputExpression());
-                break;
-            case '.':
-                next = ExpressionPtr(new OutputExpression());
-                break;
-            case '[':
-                stack.push_back(std::move(expressions));
-                expressions = std::make_unique<ExpressionVector>();
-                break;
-            case ']':
-                if (stack.empty()) {
-                    utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched ']'", position);
-                    return {};
-                }
-                next = ExpressionPtr(new LoopExpression(std::move(*expressions)));
-                expressions = std::move(stack.back());
-                stack.pop_back();
-                break;
-            default:
-                continue;
-            }
+    inline ExpressionVector Parser::parse(TokenVector &tokens) {
+        return parse(tokens.data(), tokens.size());
+    }
 
-            if (!next) {
-                continue;
-            } else if (expressions->empty() ||
-                       typeid(*expressions->back()) != typeid(*next) ||
-                       !expressions->back()->repeatable()) {
-                expressions->push_back(std::move(next));
-            } else {
-                expressions->back()->repeat();
-            }
+    inline ExpressionVector Parser::parse(const char *tokens, size_t size, size_t base) {
+        clear();
+        position_ = base;
+        if (!consume(tokens, size)) {
+            return {};
         }
 
-        if (!stack.empty()) {
-            utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched '['", position);
+        if (!stack_.empty()) {
+            utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched '['", position_);
         }
 
+        ExpressionVector expressions = std::move(*expressions_);
+        clear();
         if (utils::ErrorHandler::getInstance().hasErrors()) {
             return {};
         } else {
-            return std::move(*expressions);
+            return expressions;
         }
     }
-} // namespace Rikkyu::Brainfuck
\ No newline at end of file
+
+    inline ExpressionVector Parser::feed(const char *tokens, size_t size) {
+        if (!consume(tokens, size)) {
+            clear();
+            return {};
+        }
+        // 有未闭合的循环时，完整的只有最外层循环之前的部分
+        ExpressionVector &complete = stack_.empty() ? *expressions_ : *stack_.front();
+        ExpressionVector  expressions = std::move(complete);
+        complete.clear();
+        return expressions;
+    }
+
+    inline bool Parser::consume(const char *tokens, size_t size) {
+        const size_t base = position_;
+        size_t       position = base;
+
+        // 按块预过滤掉注释，只对剩下的指令字符逐个处理，position 仍按原文计数
+        constexpr size_t            kBlock = size_t(1) << 16;
+        std::unique_ptr<char[]>     dense(new char[kBlock + utils::SourceFilter::kSlack]);
+        std::unique_ptr<uint32_t[]> offsets(new uint32_t[kBlock + utils::SourceFilter::kSlack]);
+
+        for (size_t block = 0; block < size; block += kBlock) {
+            const size_t count = utils::SourceFilter::compact(tokens + block, std::min(kBlock, size - block),
+                                                              utils::SourceFilter::Alphabet::Brainfuck, dense.get(), offsets.get());
+            for (size_t index = 0; index < count; ++index) {
+                const char    token = dense[index];
+                ExpressionPtr next;
+                position = base + block + offsets[index] + 1;
+
+                switch (token) {
+                case '+':
+                    next = ExpressionPtr(new IncrementExpression(1));
+                    break;
+                case '-':
+                    next = ExpressionPtr(new DecrementExpression(1));
+                    break;
+                case '>':
+                    next = ExpressionPtr(new PointerForwardExpression(1));
+                    break;
+                case '<':
+                    next = ExpressionPtr(new PointerBackwardExpression(1));
+                    break;
+                case ',':
+                    next = ExpressionPtr(new InputExpression());
+                    break;
+                case '.':
+                    next = ExpressionPtr(new OutputExpression());
+                    break;
+                case '[':
+                    loopPositions_.push_back(position - 1);
+                    stack_.push_back(std::move(expressions_));
+                    expressions_ = std::make_unique<ExpressionVector>();
+                    break;
+                case ']':
+                    if (stack_.empty()) {
+                        utils::ErrorHandler::getInstance().makeError("[BFE03]: Unmatched ']'", position);
+                        return false;
+                    }
+                    next = ExpressionPtr(new LoopExpression(std::move(*expressions_)));
+                    next->setPosition(loopPositions_.back());
+                    loopPositions_.pop_back();
+                    expressions_ = std::move(stack_.back());
+                    stack_.pop_back();
+                    break;
+                default:
+                    continue;
+                }
+
+                if (!next) {
+                    continue;
+                }
+                if (next->symbol() != '[') {
+                    next->setPosition(position - 1);
+                }
+                if (expressions_->empty() ||
+                    typeid(*expressions_->back()) != typeid(*next) ||
+                    !expressions_->back()->repeatable()) {
+                    expressions_->push_back(std::move(next));
+                } else {
+                    expressions_->back()->repeat();
+                }
+            }
+        }
+        position_ = base + size;
+        return true;
+    }
+} // namespace Rikkyu::Brainfuck
+
+#endif // RIK_BF_INTERPRETER
@@ -0,0 +1,129 @@
+#include "rikkyu.h"
+
+#include <exception>
+#include <optional>
+#include <string>
+
+#include "Embed.h"
+#include "../server/Protocol.h"
+
+using namespace Rikkyu;
+
+struct rikkyu_program {
+    Embed::Program program;
+};
+
+struct rikkyu_interpreter {
+    Embed::Interpreter interpreter;
+};
+
+namespace {
+    const char *diagnosticAt(const std::vector<utils::ErrorObj> &diagnostics, size_t index, rikkyu_diagnostic_kind *kind) {
+        if (index >= diagnostics.size()) {
+            return nullptr;
+        }
+        if (kind) {
+            *kind = static_cast<rikkyu_diagnostic_kind>(Server::diagnosticKind(diagnostics[index].type));
+        }
+        return diagnostics[index].text.c_str();
+    }
+
+    void discard(void *, const char *, size_t) {}
+} // namespace
+
+// 异常不能穿过 C 接口，内存不足等情况一律折算成错误返回值
+
+rikkyu_program *rikkyu_compile(rikkyu_language language, const char *source, size_t size) {
+    if ((!source && size) || language < RIKKYU_BRAINFUCK || language > RIKKYU_BEFUNGE) {
+        return nullptr;
+    }
+    try {
+        auto *program = new rikkyu_program;
+        program->program = Embed::Program::compile(static_cast<Embed::Language>(language), std::string(source ? source : "", size));
+        return program;
+    } catch (const std::exception &) {
+        return nullptr;
+    }
+}
+
+void rikkyu_program_free(rikkyu_program *program) {
+    delete program;
+}
+
+int rikkyu_program_ok(const rikkyu_program *program) {
+    return program && program->program.ok();
+}
+
+size_t rikkyu_program_diagnostic_count(const rikkyu_program *program) {
+    return program ? program->program.diagnostics().size() : 0;
+}
+
+const char *rikkyu_program_diagnostic(const rikkyu_program *program, size_t index, rikkyu_diagnostic_kind *kind) {
+    return program ? diagnosticAt(program->program.diagnostics(), index, kind) : nullptr;
+}
+
+rikkyu_interpreter *rikkyu_interpreter_new(void) {
+    try {
+        return new rikkyu_interpreter;
+    } catch (const std::exception &) {
+        return nullptr;
+    }
+}
+
+void rikkyu_interpreter_free(rikkyu_interpreter *interpreter) {
+    delete interpreter;
+}
+
+rikkyu_status rikkyu_run(rikkyu_interpreter *interpreter, const rikkyu_program *program, const rikkyu_input *input, rikkyu_output *output) {
+    if (!interpreter || !program || (input && !input->read && !input->data && input->size) ||
+        (output && !output->write && !output->data && output->capacity)) {
+        return RIKKYU_INVALID_ARGUMENT;
+    }
+    try {
+        std::optional<utils::BufferedInput> in;
+        if (input && input->read) {
+            in.emplace(input->read, input->context);
+        } else {
+            in.emplace(input ? input->data : nullptr, input ? input->size : 0);
+        }
+        std::optional<utils::BufferedOutput> out;
+        if (!output) {
+            out.emplace(discard, nullptr);
+        } else if (output->write) {
+            out.emplace(output->write, output->context);
+        } else {
+            out.emplace(output->data, output->capacity);
+        }
+
+        const Embed::Status status = interpreter->interpreter.run(program->program, *in, *out);
+        out->flush();
+        if (output) {
+            output->size = output->write ? 0 : out->written();
+            output->truncated = out->truncated();
+        }
+        switch (status) {
+        case Embed::Status::Ok:
+            return RIKKYU_OK;
+        case Embed::Status::Interrupted:
+            return RIKKYU_INTERRUPTED;
+        default:
+            return RIKKYU_ERROR;
+        }
+    } catch (const std::exception &) {
+        return RIKKYU_ERROR;
+    }
+}
+
+void rikkyu_interrupt(rikkyu_interpreter *interpreter) {
+    if (interpreter) {
+        interpreter->interpreter.interrupt();
+    }
+}
+
+size_t rikkyu_diagnostic_count(const rikkyu_interpreter *interpreter) {
+    return interpreter ? interpreter->interpreter.diagnostics().size() : 0;
+}
+
+const char *rikkyu_diagnostic(const rikkyu_interpreter *interpreter, size_t index, rikkyu_diagnostic_kind *kind) {
+    return interpreter ? diagnosticAt(interpreter->interpreter.diagnostics(), index, kind) : nullptr;
+}
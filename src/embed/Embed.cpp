@@ -0,0 +1,58 @@
+#include "Embed.h"
+
+namespace Rikkyu::Embed {
+    Program Program::compile(Language language, const std::string &source) {
+        Program program;
+        program.compiled_ = Server::ProgramCache::compile(language, source);
+        return program;
+    }
+
+    const std::vector<utils::ErrorObj> &Program::diagnostics() const {
+        static const std::vector<utils::ErrorObj> kEmpty;
+        return compiled_ ? compiled_->diagnostics : kEmpty;
+    }
+
+    Status Interpreter::run(const Program &program, utils::BufferedInput &input, utils::BufferedOutput &output) {
+        diagnostics_.clear();
+        const Server::CompiledProgram *compiled = program.compiled();
+        if (!compiled || !compiled->ok) {
+            return Status::Error;
+        }
+
+        auto &handler = utils::ErrorHandler::getInstance();
+        handler.clearErrors();
+        interrupt_.store(false, std::memory_order_relaxed);
+        switch (compiled->language) {
+        case Language::Brainfuck:
+            vm_.setIO(input, output);
+            vm_.setInterrupt(&interrupt_);
+            vm_.run(*compiled->brainfuck);
+            vm_.reset();
+            break;
+        case Language::Whitespace:
+            whitespace_.setIO(input, output);
+            whitespace_.setInterrupt(&interrupt_);
+            whitespace_.run(*compiled->whitespace);
+            whitespace_.reset();
+            break;
+        case Language::Befunge:
+            befunge_.setIO(input, output);
+            befunge_.setInterrupt(&interrupt_);
+            befunge_.run(*compiled->befunge);
+            befunge_.reset();
+            break;
+        }
+
+        diagnostics_ = handler.getErrors();
+        handler.clearErrors();
+        if (interrupt_.load(std::memory_order_relaxed)) {
+            return Status::Interrupted;
+        }
+        for (const auto &diagnostic : diagnostics_) {
+            if (diagnostic.type == utils::ErrorType::ET_CriticalError) {
+                return Status::Error;
+            }
+        }
+        return Status::Ok;
+    }
+} // namespace Rikkyu::Embed
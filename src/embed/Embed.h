@@ -0,0 +1,85 @@
+#pragma once
+#ifndef RIK_EMBED_EMBED
+#define RIK_EMBED_EMBED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../befunge/Engine.h"
+#include "../ir/VM.h"
+#include "../server/ProgramCache.h"
+#include "../utils/BufferedIO/BufferedIO.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../whitespace/Engine.h"
+
+namespace Rikkyu::Embed {
+    // 供宿主程序直接嵌入的 C++ 接口（C 接口见 rikkyu.h）。
+    // 输入输出由宿主通过 utils::BufferedInput / BufferedOutput 提供：可以直接读写宿主的一段内存，
+    // 也可以是成批交付数据的回调，程序的 I/O 不经过文件描述符，也不复制请求数据。
+    using Language = Server::Language;
+
+    // 编译好的程序，只读，可以在多个线程的 Interpreter 之间共享
+    class Program {
+    public:
+        Program() = default;
+        ~Program() = default;
+
+        // 在当前线程上编译。编译失败时 ok() 为 false，原因在 diagnostics() 里
+        static Program compile(Language language, const std::string &source);
+
+        [[nodiscard]] bool ok() const {
+            return compiled_ && compiled_->ok;
+        }
+
+        [[nodiscard]] const std::vector<utils::ErrorObj> &diagnostics() const;
+
+        [[nodiscard]] const Server::CompiledProgram *compiled() const {
+            return compiled_.get();
+        }
+
+    private:
+        std::shared_ptr<const Server::CompiledProgram> compiled_;
+    };
+
+    enum class Status : uint8_t {
+        Ok,
+        Error,      // 编译或运行时错误，详情在 diagnostics() 里
+        Interrupted // interrupt() 被调用
+    };
+
+    // 可复用的执行器，持有三种语言的引擎，每次运行后只清理碰过的状态。
+    // 一个 Interpreter 同一时间只能在一个线程上运行；interrupt() 可以从任意线程调用。
+    class Interpreter {
+    public:
+        Interpreter() = default;
+        ~Interpreter() = default;
+
+        Interpreter(const Interpreter &) = delete;
+        Interpreter &operator=(const Interpreter &) = delete;
+
+        Status run(const Program &program, utils::BufferedInput &input, utils::BufferedOutput &output);
+
+        // 让正在进行的 run() 尽快停止，返回 Interrupted。只影响已经开始的那一次运行
+        void interrupt() {
+            interrupt_.store(true, std::memory_order_relaxed);
+        }
+
+        // 上一次 run() 的运行时诊断信息
+        [[nodiscard]] const std::vector<utils::ErrorObj> &diagnostics() const {
+            return diagnostics_;
+        }
+
+    private:
+        IR::VM                       vm_;
+        Whitespace::Engine           whitespace_;
+        Befunge::Engine              befunge_;
+        std::atomic<bool>            interrupt_{false};
+        std::vector<utils::ErrorObj> diagnostics_;
+    };
+} // namespace Rikkyu::Embed
+
+#endif // RIK_EMBED_EMBED
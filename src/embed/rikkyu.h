@@ -0,0 +1,103 @@
+/* Rikkyu 的 C 接口。C++ 宿主也可以直接使用 Embed.h。
+ *
+ *     rikkyu_program     *program = rikkyu_compile(RIKKYU_BRAINFUCK, source, source_size);
+ *     rikkyu_interpreter *interpreter = rikkyu_interpreter_new();
+ *     rikkyu_input        input = {request, request_size, NULL, NULL};
+ *     rikkyu_output       output = {response, sizeof(response), NULL, NULL, 0, 0};
+ *     if (rikkyu_program_ok(program)) {
+ *         rikkyu_run(interpreter, program, &input, &output);  // 输出直接写进 response，output.size 是长度
+ *     }
+ *     rikkyu_interpreter_free(interpreter);
+ *     rikkyu_program_free(program);
+ *
+ * 输入和输出都有两种形式：宿主的一段内存（不复制），或者成批交付数据的回调。
+ * 诊断信息的文本指针在对应对象释放或下一次 rikkyu_run 之前有效。
+ */
+#ifndef RIKKYU_H
+#define RIKKYU_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define RIKKYU_API __declspec(dllexport)
+#else
+#define RIKKYU_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum rikkyu_language {
+    RIKKYU_BRAINFUCK = 1,
+    RIKKYU_WHITESPACE = 2,
+    RIKKYU_BEFUNGE = 3
+} rikkyu_language;
+
+typedef enum rikkyu_status {
+    RIKKYU_OK = 0,
+    RIKKYU_ERROR = 1,       /* 编译或运行时错误，详情见诊断信息 */
+    RIKKYU_INTERRUPTED = 2, /* rikkyu_interrupt 被调用 */
+    RIKKYU_INVALID_ARGUMENT = 3
+} rikkyu_status;
+
+/* 诊断信息的种类，与守护进程协议里的编号相同 */
+typedef enum rikkyu_diagnostic_kind {
+    RIKKYU_NOTE = 0,
+    RIKKYU_DIAGNOSTIC_ERROR = 1,
+    RIKKYU_WARNING = 2
+} rikkyu_diagnostic_kind;
+
+/* 把 *chunk 指向下一段输入并返回长度，返回 0 表示输入结束。这段数据在下一次回调前必须有效 */
+typedef size_t (*rikkyu_read_fn)(void *context, const char **chunk);
+/* 一批输出，data 只在回调期间有效 */
+typedef void (*rikkyu_write_fn)(void *context, const char *data, size_t size);
+
+/* read 非空时从回调读取，否则读取 [data, data + size) */
+typedef struct rikkyu_input {
+    const char    *data;
+    size_t         size;
+    rikkyu_read_fn read;
+    void          *context;
+} rikkyu_input;
+
+/* write 非空时交给回调，否则直接写进 [data, data + capacity)，写不下的部分被丢弃。
+ * 运行结束后 size 是写进 data 的字节数，truncated 表示是否有输出被丢弃 */
+typedef struct rikkyu_output {
+    char           *data;
+    size_t          capacity;
+    rikkyu_write_fn write;
+    void           *context;
+    size_t          size;
+    int             truncated;
+} rikkyu_output;
+
+typedef struct rikkyu_program     rikkyu_program;
+typedef struct rikkyu_interpreter rikkyu_interpreter;
+
+/* 编译失败也返回程序对象，rikkyu_program_ok 为 0；只有内存不足或参数错误时返回 NULL */
+RIKKYU_API rikkyu_program *rikkyu_compile(rikkyu_language language, const char *source, size_t size);
+RIKKYU_API void            rikkyu_program_free(rikkyu_program *program);
+RIKKYU_API int             rikkyu_program_ok(const rikkyu_program *program);
+RIKKYU_API size_t          rikkyu_program_diagnostic_count(const rikkyu_program *program);
+RIKKYU_API const char     *rikkyu_program_diagnostic(const rikkyu_program *program, size_t index, rikkyu_diagnostic_kind *kind);
+
+/* 一个解释器同一时间只能在一个线程上运行，程序对象可以被多个解释器共享 */
+RIKKYU_API rikkyu_interpreter *rikkyu_interpreter_new(void);
+RIKKYU_API void                rikkyu_interpreter_free(rikkyu_interpreter *interpreter);
+
+/* input 为 NULL 表示没有输入，output 为 NULL 表示丢弃输出 */
+RIKKYU_API rikkyu_status rikkyu_run(rikkyu_interpreter *interpreter, const rikkyu_program *program, const rikkyu_input *input,
+                                    rikkyu_output *output);
+/* 可以从其他线程调用，让正在进行的 rikkyu_run 尽快返回 RIKKYU_INTERRUPTED */
+RIKKYU_API void          rikkyu_interrupt(rikkyu_interpreter *interpreter);
+
+/* 上一次 rikkyu_run 的运行时诊断信息 */
+RIKKYU_API size_t      rikkyu_diagnostic_count(const rikkyu_interpreter *interpreter);
+RIKKYU_API const char *rikkyu_diagnostic(const rikkyu_interpreter *interpreter, size_t index, rikkyu_diagnostic_kind *kind);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RIKKYU_H */
@@ -0,0 +1,85 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "VM.h"
+
+namespace Rikkyu::IR {
+    namespace {
+        // 可恢复执行到结束或第一次需要输入，output 收集途中的全部输出
+        VM::Status advance(VM &vm, std::string &output) {
+            for (;;) {
+                const VM::Status status = vm.resume();
+                output += vm.output();
+                vm.clearOutput();
+                if (status != VM::Status::OutputFull && status != VM::Status::Yielded) {
+                    return status;
+                }
+            }
+        }
+    } // namespace
+
+    BatchRunner::BatchRunner(size_t threads)
+        : threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    std::vector<BatchRunner::Result> BatchRunner::run(const Module &module, const std::vector<std::string> &inputs) {
+        auto &handler = utils::ErrorHandler::getInstance();
+        handler.clearErrors();
+
+        const auto  started = std::chrono::steady_clock::now();
+        VM          prefix;
+        std::string prefixOutput;
+        prefix.setOutputLimit(SIZE_MAX);
+        prefix.start(module);
+        const VM::Status status = advance(prefix, prefixOutput);
+        prefixSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        prefixReachedInput_ = status == VM::Status::NeedInput;
+        // 前缀里不停止执行的诊断（例如指针越界）属于每一份输入的结果
+        const std::vector<utils::ErrorObj> prefixDiagnostics = handler.getErrors();
+        handler.clearErrors();
+
+        std::vector<Result> results(inputs.size());
+        if (!prefixReachedInput_) {
+            Result shared;
+            shared.output = std::move(prefixOutput);
+            shared.ok = status == VM::Status::Finished;
+            shared.diagnostics = prefixDiagnostics;
+            std::fill(results.begin(), results.end(), shared);
+            return results;
+        }
+
+        // 每个线程一台 VM，重复使用它的纸带和堆
+        std::atomic<size_t> next{0};
+        auto                work = [&] {
+            auto &errors = utils::ErrorHandler::getInstance();
+            VM    vm;
+            vm.setOutputLimit(SIZE_MAX);
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < inputs.size();) {
+                Result &result = results[i];
+                errors.clearErrors();
+                vm.restore(prefix);
+                vm.feedInput(inputs[i].data(), inputs[i].size());
+                vm.closeInput();
+                result.output = prefixOutput;
+                result.ok = advance(vm, result.output) == VM::Status::Finished;
+                result.diagnostics = prefixDiagnostics;
+                result.diagnostics.insert(result.diagnostics.end(), errors.getErrors().begin(), errors.getErrors().end());
+                errors.clearErrors();
+            }
+        };
+
+        const size_t             workers = std::min(threads_, inputs.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workers; ++i) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        return results;
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef RIK_IR_BATCH_RUNNER
+#define RIK_IR_BATCH_RUNNER
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "IR.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::IR {
+    // 用同一个模块处理许多份输入。程序第一次读输入之前的部分与输入无关（例如初始化查找表），
+    // 只执行一次：VM 以可恢复方式跑到第一次需要输入时挂起，之后每份输入在工作线程上用 VM::restore()
+    // 从这个快照复制出状态继续执行。纸带和稠密堆只复制脏区。
+    class BatchRunner {
+    public:
+        struct Result {
+            std::string                  output; // 包括共享前缀的输出
+            bool                         ok = false;
+            std::vector<utils::ErrorObj> diagnostics;
+        };
+
+        // threads 为 0 时使用 CPU 核数
+        explicit BatchRunner(size_t threads = 0);
+        ~BatchRunner() = default;
+
+        // 结果与输入一一对应，与对每份输入单独 VM::run() 相同
+        std::vector<Result> run(const Module &module, const std::vector<std::string> &inputs);
+
+        // 上一次 run() 的共享前缀耗时；前缀没有读输入就结束时所有结果都直接复制前缀的结果
+        [[nodiscard]] double prefixSeconds() const {
+            return prefixSeconds_;
+        }
+        [[nodiscard]] bool prefixReachedInput() const {
+            return prefixReachedInput_;
+        }
+
+    private:
+        size_t threads_;
+        double prefixSeconds_ = 0;
+        bool   prefixReachedInput_ = false;
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR_BATCH_RUNNER
@@ -0,0 +1,463 @@
+#include "CBackend.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::IR {
+    namespace {
+        // 错误信息宏的名字，与 Trap 的顺序一致
+        const char *const kTrapMacros[] = {
+            "RK_TRAP_STACK_UNDERFLOW",
+            "RK_TRAP_DIVISION_BY_ZERO",
+            "RK_TRAP_MODULO_BY_ZERO",
+            "RK_TRAP_POINTER_FORWARD",
+            "RK_TRAP_POINTER_BACKWARD",
+            "RK_TRAP_CALL_OVERFLOW",
+            "RK_TRAP_RETURN_OUTSIDE_CALL",
+            "RK_TRAP_OVERFLOW",
+            "RK_TRAP_INVALID_NUMBER",
+            "RK_TRAP_END_OF_INPUT",
+        };
+        static_assert(sizeof(kTrapMacros) / sizeof(kTrapMacros[0]) == static_cast<size_t>(Trap::Count));
+
+        // 生成代码共用的运行时：可增长的值栈、稠密 + 哈希的堆、带溢出检查的算术
+        const char *const kPrelude = R"(
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int64_t rk_int;
+
+#ifndef RK_CALL_DEPTH
+#define RK_CALL_DEPTH (1 << 20)
+#endif
+#define RK_DENSE (1 << 20)
+
+static void rk_report(const char *message) {
+    fflush(stdout);
+    fprintf(stderr, "%s\n", message);
+}
+
+static void rk_fail(const char *message) {
+    rk_report(message);
+    exit(1);
+}
+
+static rk_int *rk_base, *rk_limit;
+
+static rk_int *rk_grow(rk_int *sp, size_t need) {
+    size_t used = (size_t)(sp - rk_base);
+    size_t capacity = (size_t)(rk_limit - rk_base);
+    while (capacity - used < need) {
+        capacity = capacity ? capacity * 2 : 1024;
+    }
+    rk_base = (rk_int *)realloc(rk_base, capacity * sizeof(rk_int));
+    if (!rk_base) {
+        rk_fail("Out of memory");
+    }
+    rk_limit = rk_base + capacity;
+    return rk_base + used;
+}
+
+#define RK_RESERVE(n) if ((size_t)(rk_limit - sp) < (size_t)(n)) sp = rk_grow(sp, (n))
+#define RK_GUARD(n) if ((size_t)(sp - rk_base) < (size_t)(n)) rk_fail(RK_TRAP_STACK_UNDERFLOW)
+
+static rk_int rk_dense[RK_DENSE];
+struct rk_slot {
+    rk_int key, value;
+    int used;
+};
+
+static struct rk_slot *rk_slots;
+static size_t rk_slot_count, rk_slot_used;
+
+static size_t rk_hash(rk_int key) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32));
+}
+
+static void rk_sparse_store(rk_int key, rk_int value);
+
+static void rk_rehash(size_t capacity) {
+    size_t old_count = rk_slot_count, i;
+    struct rk_slot *old = rk_slots;
+    rk_slots = (struct rk_slot *)calloc(capacity, sizeof(struct rk_slot));
+    if (!rk_slots) {
+        rk_fail("Out of memory");
+    }
+    rk_slot_count = capacity;
+    rk_slot_used = 0;
+    for (i = 0; i < old_count; ++i) {
+        if (old[i].used) {
+            rk_sparse_store(old[i].key, old[i].value);
+        }
+    }
+    free(old);
+}
+
+static void rk_sparse_store(rk_int key, rk_int value) {
+    size_t i;
+    if ((rk_slot_used + 1) * 2 > rk_slot_count) {
+        rk_rehash(rk_slot_count ? rk_slot_count * 2 : 16);
+    }
+    for (i = rk_hash(key) & (rk_slot_count - 1);; i = (i + 1) & (rk_slot_count - 1)) {
+        if (!rk_slots[i].used) {
+            rk_slots[i].key = key;
+            rk_slots[i].value = value;
+            rk_slots[i].used = 1;
+            ++rk_slot_used;
+            return;
+        }
+        if (rk_slots[i].key == key) {
+            rk_slots[i].value = value;
+            return;
+        }
+    }
+}
+
+static void rk_store(rk_int address, rk_int value) {
+    if (address >= 0 && address < RK_DENSE) {
+        rk_dense[address] = value;
+    } else {
+        rk_sparse_store(address, value);
+    }
+}
+
+static rk_int rk_load(rk_int address) {
+    size_t i;
+    if (address >= 0 && address < RK_DENSE) {
+        return rk_dense[address];
+    }
+    if (!rk_slot_count) {
+        return 0;
+    }
+    for (i = rk_hash(address) & (rk_slot_count - 1);; i = (i + 1) & (rk_slot_count - 1)) {
+        if (!rk_slots[i].used) {
+            return 0;
+        }
+        if (rk_slots[i].key == address) {
+            return rk_slots[i].value;
+        }
+    }
+}
+
+static rk_int rk_add(rk_int a, rk_int b) {
+    rk_int r;
+    if (__builtin_add_overflow(a, b, &r)) rk_fail(RK_TRAP_OVERFLOW);
+    return r;
+}
+
+static rk_int rk_sub(rk_int a, rk_int b) {
+    rk_int r;
+    if (__builtin_sub_overflow(a, b, &r)) rk_fail(RK_TRAP_OVERFLOW);
+    return r;
+}
+
+static rk_int rk_mul(rk_int a, rk_int b) {
+    rk_int r;
+    if (__builtin_mul_overflow(a, b, &r)) rk_fail(RK_TRAP_OVERFLOW);
+    return r;
+}
+
+static rk_int rk_div(rk_int a, rk_int b) {
+    if (b == 0) rk_fail(RK_TRAP_DIVISION_BY_ZERO);
+    if (b == -1) return rk_sub(0, a);
+    return a / b;
+}
+
+static rk_int rk_mod(rk_int a, rk_int b) {
+    if (b == 0) rk_fail(RK_TRAP_MODULO_BY_ZERO);
+    if (b == -1) return 0;
+    return a % b;
+}
+
+static rk_int rk_read_char(void) {
+    int c = getchar();
+    if (c == EOF) {
+        if (RK_TRAP_END_OF_INPUT[0]) rk_report(RK_TRAP_END_OF_INPUT);
+        return -1;
+    }
+    return c;
+}
+
+static int rk_is_space(int c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* 与 BufferedInput::readInteger 相同：读一个空白分隔的记号并吃掉其后的一个分隔符，整个记号必须是十进制整数 */
+static rk_int rk_read_num(void) {
+    static char *token;
+    static size_t capacity;
+    size_t length = 0;
+    int c = getchar();
+    while (c != EOF && rk_is_space(c)) c = getchar();
+    for (; c != EOF && !rk_is_space(c); c = getchar()) {
+        if (length + 1 >= capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            token = (char *)realloc(token, capacity);
+            if (!token) rk_fail("Out of memory");
+        }
+        token[length++] = (char)c;
+    }
+    if (length == 0) rk_fail(RK_TRAP_INVALID_NUMBER);
+    token[length] = '\0';
+    const char *begin = token + (token[0] == '+');
+    if (*begin == '+' || *begin == '\0') rk_fail(RK_TRAP_INVALID_NUMBER);
+    char *end;
+    errno = 0;
+    long long n = strtoll(begin, &end, 10);
+    if (*end != '\0') rk_fail(RK_TRAP_INVALID_NUMBER);
+    if (errno == ERANGE) rk_fail(RK_TRAP_OVERFLOW);
+    return (rk_int)n;
+}
+
+static int rk_calls[RK_CALL_DEPTH];
+)";
+    } // namespace
+
+    void CBackend::line(const std::string &text) {
+        body_ << "    " << text << "\n";
+    }
+
+    std::string CBackend::operand(const Operand &operand) {
+        if (operand.isRegister()) {
+            return "r" + std::to_string(operand.reg);
+        }
+        // INT64_MIN 不能直接写成字面量
+        if (operand.imm == INT64_MIN) {
+            return "INT64_MIN";
+        }
+        return "INT64_C(" + std::to_string(operand.imm) + ")";
+    }
+
+    std::string CBackend::quote(const std::string &text) {
+        std::string quoted = "\"";
+        for (const char c : text) {
+            const auto byte = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                quoted.push_back('\\');
+                quoted.push_back(c);
+            } else if (byte < 0x20 || byte >= 0x7F) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\%03o", byte);
+                quoted += escaped;
+            } else {
+                quoted.push_back(c);
+            }
+        }
+        return quoted + "\"";
+    }
+
+    void CBackend::emitInstruction(const Module &module, const Instruction &instruction, size_t index) {
+        const std::string dst = "r" + std::to_string(instruction.dst) + " = ";
+        const std::string a = operand(instruction.a);
+        const std::string b = operand(instruction.b);
+        auto label = [](int32_t target) {
+            return "L" + std::to_string(target);
+        };
+        auto cell = [&](int32_t offset) {
+            return offset == 0 ? std::string("rk_tape[p]") : "rk_tape[p + " + std::to_string(offset) + "]";
+        };
+
+        switch (instruction.op) {
+        case Op::Nop:
+            break;
+        case Op::Mov:
+            line(dst + a + ";");
+            break;
+        case Op::Trunc:
+            line(dst + (module.cellBits >= 64 ? a : "(rk_int)((uint64_t)" + a + " & RK_CELL_MASK)") + ";");
+            break;
+        case Op::Add:
+        case Op::Sub:
+        case Op::Mul:
+        case Op::Div:
+        case Op::Mod: {
+            static const char *const names[] = {"rk_add", "rk_sub", "rk_mul", "rk_div", "rk_mod"};
+            const char *name = names[static_cast<int>(instruction.op) - static_cast<int>(Op::Add)];
+            line(dst + name + "(" + a + ", " + b + ");");
+            break;
+        }
+        case Op::LoadTape:
+        case Op::StoreTape: {
+            // 指针本身总在界内，只有带偏移的访问需要检查
+            if (instruction.offset != 0) {
+                line("if ((size_t)(p + " + std::to_string(instruction.offset) + ") >= RK_TAPE) rk_fail(" +
+                     (instruction.offset < 0 ? "RK_TRAP_POINTER_BACKWARD" : "RK_TRAP_POINTER_FORWARD") + ");");
+            }
+            if (instruction.op == Op::LoadTape) {
+                line(dst + "(rk_int)" + cell(instruction.offset) + ";");
+            } else {
+                line(cell(instruction.offset) + " = (rk_cell)" + a + ";");
+            }
+            break;
+        }
+        case Op::MovePointer:
+            // 越界只报错，指针保持不动
+            line("if ((size_t)(p + " + a + ") >= RK_TAPE) rk_report(" + a + " < 0 ? RK_TRAP_POINTER_BACKWARD : RK_TRAP_POINTER_FORWARD);");
+            line("else p += " + a + ";");
+            break;
+        case Op::LoadHeap:
+            line(dst + "rk_load(" + a + ");");
+            break;
+        case Op::StoreHeap:
+            line("rk_store(" + a + ", " + b + ");");
+            break;
+        case Op::Push:
+            line("RK_RESERVE(1);");
+            line("*sp++ = " + a + ";");
+            break;
+        case Op::Pop:
+            line("RK_GUARD(1);");
+            line(dst + "*--sp;");
+            break;
+        case Op::Peek:
+            line(dst + "sp[-" + std::to_string(instruction.a.imm + 1) + "];");
+            break;
+        case Op::Discard:
+            line("sp -= " + a + ";");
+            break;
+        case Op::Require:
+            line("RK_GUARD(" + a + ");");
+            break;
+        case Op::Jump:
+            line("goto " + label(instruction.target) + ";");
+            break;
+        case Op::JumpZero:
+            line("if (" + a + " == 0) goto " + label(instruction.target) + ";");
+            break;
+        case Op::JumpNonZero:
+            line("if (" + a + " != 0) goto " + label(instruction.target) + ";");
+            break;
+        case Op::JumpNegative:
+            line("if (" + a + " < 0) goto " + label(instruction.target) + ";");
+            break;
+        case Op::JumpOutside:
+            line("if ((size_t)(p + " + a + ") >= RK_TAPE || (size_t)(p + " + b + ") >= RK_TAPE) goto " + label(instruction.target) + ";");
+            break;
+        case Op::Call:
+            line("if (csp == RK_CALL_DEPTH) rk_fail(RK_TRAP_CALL_OVERFLOW);");
+            line("rk_calls[csp++] = " + std::to_string(index + 1) + ";");
+            line("goto " + label(instruction.target) + ";");
+            break;
+        case Op::Return:
+            line("goto rk_return;");
+            break;
+        case Op::Halt:
+            line("goto rk_exit;");
+            break;
+        case Op::Fail:
+            line("rk_fail(" + quote(module.messages[static_cast<size_t>(instruction.a.imm)]) + ");");
+            break;
+        case Op::ReadChar:
+            line(dst + "rk_read_char();");
+            break;
+        case Op::ReadNumber:
+            line(dst + "rk_read_num();");
+            break;
+        case Op::WriteChar:
+            line("putchar((int)" + a + ");");
+            break;
+        case Op::WriteNumber:
+            line("printf(\"%lld\", (long long)" + a + ");");
+            break;
+        }
+    }
+
+    std::string CBackend::emit(const Module &module) {
+        body_.str("");
+        const auto &code = module.code;
+
+        // 跳转目标和 CALL 的返回点都要成为 C 标签
+        std::vector<bool> target(code.size() + 1, false);
+        std::vector<int>  returnSites;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (Module::isBranch(code[i].op)) {
+                target[static_cast<size_t>(code[i].target)] = true;
+            }
+            if (code[i].op == Op::Call) {
+                target[i + 1] = true;
+                returnSites.push_back(static_cast<int>(i + 1));
+            }
+        }
+
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (target[i]) {
+                body_ << "L" << i << ":;\n";
+            }
+            emitInstruction(module, code[i], i);
+        }
+        if (target[code.size()]) {
+            body_ << "L" << code.size() << ":;\n";
+        }
+
+        std::ostringstream out;
+        out << "/* Generated by Rikkyu IR C backend. */\n";
+        for (size_t i = 0; i < static_cast<size_t>(Trap::Count); ++i) {
+            out << "#define " << kTrapMacros[i] << " " << quote(module.traps[i]) << "\n";
+        }
+        out << kPrelude << "\n";
+
+        // 纸带单元格用能放下 cellBits 的最小无符号类型
+        if (module.tapeCells) {
+            const char *cellType = module.cellBits <= 8 ? "uint8_t" : module.cellBits <= 16 ? "uint16_t" : module.cellBits <= 32 ? "uint32_t" : "int64_t";
+            out << "typedef " << cellType << " rk_cell;\n";
+            out << "#define RK_TAPE " << module.tapeCells << "u\n";
+            if (module.cellBits < 64) {
+                out << "#define RK_CELL_MASK UINT64_C(" << ((uint64_t(1) << module.cellBits) - 1) << ")\n";
+            }
+            out << "static rk_cell rk_tape[RK_TAPE];\n\n";
+        }
+
+        out << "int main(void) {\n";
+        out << "    rk_int *sp = rk_grow(0, 1024);\n";
+        out << "    int csp = 0;\n";
+        if (module.tapeCells) {
+            out << "    size_t p = 0;\n";
+        }
+        for (int32_t r = 0; r < module.registers; ++r) {
+            out << "    rk_int r" << r << " = 0;\n";
+        }
+        out << body_.str();
+        out << "    goto rk_exit;\n";
+        out << "rk_return:\n";
+        out << "    if (csp == 0) rk_fail(RK_TRAP_RETURN_OUTSIDE_CALL);\n";
+        out << "    switch (rk_calls[--csp]) {\n";
+        for (int site : returnSites) {
+            out << "    case " << site << ": goto L" << site << ";\n";
+        }
+        out << "    }\n";
+        out << "rk_exit:\n";
+        out << "    fflush(stdout);\n";
+        out << "    (void)sp;\n";
+        out << "    (void)csp;\n";
+        out << "    return 0;\n";
+        out << "}\n";
+        return out.str();
+    }
+
+    bool CBackend::compileNative(const std::string &source, const std::string &outputPath, const std::string &compiler) {
+        const std::string sourcePath = outputPath + ".c";
+        {
+            std::ofstream file(sourcePath, std::ios::binary);
+            if (!file.is_open()) {
+                utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[IRE01]: Cannot write C source: ", sourcePath), 0);
+                return false;
+            }
+            file << source;
+        }
+
+        const std::string command = utils::StringBuilder::concatenate(compiler, " -O2 -o \"", outputPath, "\" \"", sourcePath, "\"");
+        if (std::system(command.c_str()) != 0) {
+            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[IRE02]: C compiler failed: ", command), 0);
+            return false;
+        }
+        return true;
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef RIK_IR_C_BACKEND
+#define RIK_IR_C_BACKEND
+
+#include <sstream>
+#include <string>
+
+#include "IR.h"
+
+namespace Rikkyu::IR {
+    // 把 IR 模块翻译成 C 源码（各前端共用的提前编译后端）。
+    //   - 虚拟寄存器变成 main 里的局部变量，跳转目标变成 goto 标签；
+    //   - CALL / RETURN 通过显式的返回地址栈加 switch 实现；
+    //   - 纸带指针始终保持在界内，偏移为 0 的访问不再检查；
+    //   - Peek / Discard 依赖之前的 Require 保证栈深度，不单独检查。
+    class CBackend {
+    public:
+        CBackend() = default;
+        ~CBackend() = default;
+
+        std::string emit(const Module &module);
+
+        // 把 C 源码写到 outputPath + ".c"，再调用系统 C 编译器生成可执行文件
+        static bool compileNative(const std::string &source, const std::string &outputPath, const std::string &compiler = "cc");
+
+    private:
+        void emitInstruction(const Module &module, const Instruction &instruction, size_t index);
+
+        static std::string operand(const Operand &operand);
+        static std::string quote(const std::string &text);
+
+        void line(const std::string &text);
+
+        std::ostringstream body_;
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR_C_BACKEND
@@ -0,0 +1,192 @@
+#include "IR.h"
+
+#include <sstream>
+
+namespace Rikkyu::IR {
+    const char *opName(Op op) {
+        static const char *const names[] = {
+#define RIK_IR_OPCODE_NAME(name, mnemonic) mnemonic,
+            RIK_IR_OPCODES(RIK_IR_OPCODE_NAME)
+#undef RIK_IR_OPCODE_NAME
+        };
+        return names[static_cast<size_t>(op)];
+    }
+
+    bool evaluate(Op op, int64_t a, int64_t b, int64_t &result) {
+        switch (op) {
+        case Op::Add:
+            return !__builtin_add_overflow(a, b, &result);
+        case Op::Sub:
+            return !__builtin_sub_overflow(a, b, &result);
+        case Op::Mul:
+            return !__builtin_mul_overflow(a, b, &result);
+        case Op::Div:
+            if (b == 0 || (b == -1 && a == INT64_MIN)) {
+                return false;
+            }
+            result = a / b;
+            return true;
+        case Op::Mod:
+            if (b == 0) {
+                return false;
+            }
+            result = b == -1 ? 0 : a % b;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::string Operand::toString() const {
+        switch (kind) {
+        case Kind::Register:
+            return "r" + std::to_string(reg);
+        case Kind::Immediate:
+            return std::to_string(imm);
+        default:
+            return "_";
+        }
+    }
+
+    std::string Instruction::toString() const {
+        std::ostringstream out;
+        if (Module::definesRegister(op)) {
+            out << "r" << dst << " = ";
+        }
+        out << opName(op);
+        if (op == Op::LoadTape || op == Op::StoreTape) {
+            out << " [p" << (offset < 0 ? "" : "+") << offset << "]";
+        }
+        if (a.kind != Operand::Kind::None) {
+            out << " " << a.toString();
+        }
+        if (b.kind != Operand::Kind::None) {
+            out << ", " << b.toString();
+        }
+        if (Module::isBranch(op)) {
+            out << " -> " << target;
+        }
+        return out.str();
+    }
+
+    bool Module::isBranch(Op op) {
+        return op == Op::Jump || op == Op::JumpZero || op == Op::JumpNonZero || op == Op::JumpNegative || op == Op::JumpOutside || op == Op::Call;
+    }
+
+    bool Module::isTerminator(Op op) {
+        return op == Op::Jump || op == Op::Return || op == Op::Halt || op == Op::Fail;
+    }
+
+    bool Module::definesRegister(Op op) {
+        switch (op) {
+        case Op::Mov:
+        case Op::Trunc:
+        case Op::Add:
+        case Op::Sub:
+        case Op::Mul:
+        case Op::Div:
+        case Op::Mod:
+        case Op::LoadTape:
+        case Op::LoadHeap:
+        case Op::Pop:
+        case Op::Peek:
+        case Op::ReadChar:
+        case Op::ReadNumber:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::vector<bool> Module::leaders() const {
+        std::vector<bool> leader(code.size() + 1, false);
+        leader[0] = true;
+        for (size_t i = 0; i < code.size(); ++i) {
+            const Op op = code[i].op;
+            if (isBranch(op)) {
+                leader[static_cast<size_t>(code[i].target)] = true;
+            }
+            if (isBranch(op) || isTerminator(op)) {
+                leader[i + 1] = true;
+            }
+        }
+        return leader;
+    }
+
+    void Module::compact() {
+        // remap[i]：原下标 i 在压缩后的位置；被删除的指令映射到其后第一条保留的指令
+        std::vector<int32_t> remap(code.size() + 1, 0);
+        int32_t              next = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            remap[i] = next;
+            if (code[i].op != Op::Nop) {
+                ++next;
+            }
+        }
+        remap[code.size()] = next;
+
+        size_t out = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (code[i].op == Op::Nop) {
+                continue;
+            }
+            Instruction instruction = code[i];
+            if (isBranch(instruction.op)) {
+                instruction.target = remap[static_cast<size_t>(instruction.target)];
+            }
+            code[out++] = instruction;
+        }
+        code.resize(out);
+    }
+
+    void Module::append(Module &&other) {
+        if (!code.empty() && code.back().op == Op::Halt) {
+            code.pop_back();
+        }
+        const auto base = static_cast<int32_t>(code.size());
+        // 优化后末尾可能还接着慢路径之类的代码，中间的 Halt 同样表示本模块执行完毕
+        for (Instruction &instruction : code) {
+            if (instruction.op == Op::Halt) {
+                instruction = Instruction::branch(Op::Jump, base);
+            }
+        }
+        const int32_t registerBase = registers;
+        const auto    messageBase = static_cast<int64_t>(messages.size());
+        auto shift = [registerBase](Operand &operand) {
+            if (operand.isRegister()) {
+                operand.reg += registerBase;
+            }
+        };
+
+        code.reserve(code.size() + other.code.size());
+        for (Instruction instruction : other.code) {
+            if (instruction.dst >= 0) {
+                instruction.dst += registerBase;
+            }
+            shift(instruction.a);
+            shift(instruction.b);
+            if (isBranch(instruction.op)) {
+                instruction.target += base;
+            }
+            if (instruction.op == Op::Fail) {
+                instruction.a.imm += messageBase;
+            }
+            code.push_back(instruction);
+        }
+        registers += other.registers;
+        messages.insert(messages.end(), other.messages.begin(), other.messages.end());
+        other = Module();
+    }
+
+    std::string Module::toString() const {
+        const std::vector<bool> leader = leaders();
+        std::ostringstream      out;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (leader[i]) {
+                out << i << ":\n";
+            }
+            out << "    " << code[i].toString() << "\n";
+        }
+        return out.str();
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,210 @@
+#pragma once
+#ifndef RIK_IR
+#define RIK_IR
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Rikkyu::IR {
+    // 各语言共用的低层 IR。机器模型：
+    //   - 无限多个 64 位虚拟寄存器；
+    //   - 一条带数据指针的纸带（Brainfuck 一类语言），单元格宽度由 Module::cellBits 决定，写入时截断；
+    //     指针移动越界时报告 PointerForward / PointerBackward，忽略这次移动后继续执行；
+    //   - 一个值栈和一个按整数寻址的堆（Whitespace 一类语言）；
+    //   - 返回地址栈，CALL 返回到紧随其后的指令。
+    // 所有算术都是带溢出检查的 64 位整数运算。
+#define RIK_IR_OPCODES(X)               \
+    X(Nop, "nop")                       \
+    X(Mov, "mov")                       \
+    X(Trunc, "trunc")                   \
+    X(Add, "add")                       \
+    X(Sub, "sub")                       \
+    X(Mul, "mul")                       \
+    X(Div, "div")                       \
+    X(Mod, "mod")                       \
+    X(LoadTape, "ldt")                  \
+    X(StoreTape, "stt")                 \
+    X(MovePointer, "mvp")               \
+    X(LoadHeap, "ldh")                  \
+    X(StoreHeap, "sth")                 \
+    X(Push, "push")                     \
+    X(Pop, "pop")                       \
+    X(Peek, "peek")                     \
+    X(Discard, "discard")               \
+    X(Require, "require")               \
+    X(Jump, "jmp")                      \
+    X(JumpZero, "jz")                   \
+    X(JumpNonZero, "jnz")               \
+    X(JumpNegative, "jneg")             \
+    X(JumpOutside, "jout")              \
+    X(Call, "call")                     \
+    X(Return, "ret")                    \
+    X(Halt, "halt")                     \
+    X(Fail, "fail")                     \
+    X(ReadChar, "getc")                 \
+    X(ReadNumber, "getn")               \
+    X(WriteChar, "putc")                \
+    X(WriteNumber, "putn")
+
+    enum class Op : uint8_t {
+#define RIK_IR_OPCODE_ENUM(name, mnemonic) name,
+        RIK_IR_OPCODES(RIK_IR_OPCODE_ENUM)
+#undef RIK_IR_OPCODE_ENUM
+    };
+
+    const char *opName(Op op);
+
+    // 带检查的 64 位算术（Add .. Mod），溢出或除数为 0 时返回 false。
+    // 除法向零取整，余数与被除数同号
+    bool evaluate(Op op, int64_t a, int64_t b, int64_t &result);
+
+    // 运行时错误的种类。错误信息由前端填写，保持各语言原有的错误码。
+    // 除 PointerForward / PointerBackward（报错后继续）和 EndOfInput（警告）之外都会停止执行。
+    // EndOfInput 的信息为空时 ReadChar 读到输入结尾不报告
+    enum class Trap : uint8_t {
+        StackUnderflow,
+        DivisionByZero,
+        ModuloByZero,
+        PointerForward,
+        PointerBackward,
+        CallOverflow,
+        ReturnOutsideCall,
+        Overflow,
+        InvalidNumber,
+        EndOfInput,
+        Count
+    };
+
+    struct Operand {
+        enum class Kind : uint8_t {
+            None,
+            Register,
+            Immediate
+        };
+
+        Kind    kind = Kind::None;
+        int32_t reg = 0;
+        int64_t imm = 0;
+
+        static Operand r(int32_t reg) { return {Kind::Register, reg, 0}; }
+        static Operand i(int64_t imm) { return {Kind::Immediate, 0, imm}; }
+
+        [[nodiscard]] bool isRegister() const { return kind == Kind::Register; }
+        [[nodiscard]] bool isImmediate() const { return kind == Kind::Immediate; }
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    // 一条 IR 指令：
+    //   Mov / Trunc           dst = a            （Trunc 截断到单元格宽度）
+    //   Add .. Mod            dst = a op b
+    //   LoadTape / StoreTape  dst = tape[p + offset] / tape[p + offset] = a
+    //   MovePointer           p += a，越界时报告并保持不动
+    //   LoadHeap / StoreHeap  dst = heap[a] / heap[a] = b
+    //   Push / Pop / Peek     push a / dst = pop / dst = 栈顶往下第 a 个
+    //   Discard / Require     弹掉 a 个 / 栈深度不足 a 时报错
+    //   Jump .. JumpNegative  按 a 的值跳到 target
+    //   JumpOutside           p + a 到 p + b 之间有单元不在纸带内时跳到 target（a、b 为立即数）
+    //   Call / Return / Halt
+    //   Fail                  报告 Module::messages[a] 并停止执行（a 为立即数）
+    //   ReadChar / ReadNumber dst = 输入；输入结束时 ReadChar 报告 EndOfInput 并得到 -1
+    //   WriteChar / WriteNumber 输出 a
+    struct Instruction {
+        Op      op = Op::Nop;
+        int32_t dst = -1;
+        int32_t offset = 0;
+        int32_t target = 0;
+        Operand a;
+        Operand b;
+
+        // 按用到的操作数构造指令，其余字段保持默认值。dst 为 -1 表示不写寄存器，跳转目标可以之后再回填
+        static Instruction of(Op op, int32_t dst = -1) {
+            Instruction instruction;
+            instruction.op = op;
+            instruction.dst = dst;
+            return instruction;
+        }
+
+        static Instruction unary(Op op, int32_t dst, const Operand &a) {
+            Instruction instruction = of(op, dst);
+            instruction.a = a;
+            return instruction;
+        }
+
+        static Instruction binary(Op op, int32_t dst, const Operand &a, const Operand &b) {
+            Instruction instruction = unary(op, dst, a);
+            instruction.b = b;
+            return instruction;
+        }
+
+        static Instruction branch(Op op, int32_t target, const Operand &a = Operand()) {
+            Instruction instruction = unary(op, -1, a);
+            instruction.target = target;
+            return instruction;
+        }
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    class Module {
+    public:
+        Module() = default;
+        ~Module() = default;
+
+        Module(Module &&) = default;
+        Module &operator=(Module &&) = default;
+
+        std::vector<Instruction> code;
+        int32_t                  registers = 0;
+        size_t                   tapeCells = 0; // 0 表示不使用纸带
+        uint32_t                 cellBits = 64;
+        std::array<std::string, static_cast<size_t>(Trap::Count)> traps;
+        std::vector<std::string>                                   messages; // Fail 报告的错误信息
+
+        int32_t newRegister() {
+            return registers++;
+        }
+
+        size_t emit(const Instruction &instruction) {
+            code.push_back(instruction);
+            return code.size() - 1;
+        }
+
+        [[nodiscard]] const std::string &trap(Trap kind) const {
+            return traps[static_cast<size_t>(kind)];
+        }
+
+        void setTrap(Trap kind, std::string message) {
+            traps[static_cast<size_t>(kind)] = std::move(message);
+        }
+
+        // 单元格写入时的截断
+        [[nodiscard]] int64_t truncate(int64_t value) const {
+            return cellBits >= 64 ? value : static_cast<int64_t>(static_cast<uint64_t>(value) & ((uint64_t(1) << cellBits) - 1));
+        }
+
+        [[nodiscard]] std::string toString() const;
+
+        // target 字段是跳转目标的指令
+        static bool isBranch(Op op);
+        // 执行后不会落到下一条的指令
+        static bool isTerminator(Op op);
+        // 有结果写入 dst 的指令
+        static bool definesRegister(Op op);
+
+        // 基本块的开头：入口、跳转目标、CALL 返回点和终结指令之后
+        [[nodiscard]] std::vector<bool> leaders() const;
+
+        // 删除所有 Nop 并重新映射跳转目标（指向被删指令的跳转改指向其后第一条保留的指令）
+        void compact();
+
+        // 把另一段独立降低的代码接在后面：本模块的 Halt 都改为转到 other 的开头（末尾的那条直接去掉），
+        // other 的寄存器编号、跳转目标和 Fail 的信息下标整体平移。纸带和陷阱设置以本模块为准
+        void append(Module &&other);
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR
@@ -0,0 +1,57 @@
+#include "PassManager.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "Passes.h"
+
+namespace Rikkyu::IR {
+    PassManager::PassManager(size_t maxRounds)
+        : maxRounds_(maxRounds) {}
+
+    PassManager PassManager::standard() {
+        PassManager manager;
+        manager.add(std::make_unique<Peephole>())
+            .add(std::make_unique<ConstantFolding>())
+            .add(std::make_unique<LoopIdiom>())
+            .add(std::make_unique<DeadCodeElimination>());
+        return manager;
+    }
+
+    PassManager &PassManager::add(std::unique_ptr<Pass> pass) {
+        Statistics statistics;
+        statistics.name = pass->name();
+        statistics_.push_back(statistics);
+        passes_.push_back(std::move(pass));
+        return *this;
+    }
+
+    void PassManager::run(Module &module) {
+        for (size_t round = 0; round < maxRounds_; ++round) {
+            size_t changes = 0;
+            for (size_t i = 0; i < passes_.size(); ++i) {
+                const auto   start = std::chrono::steady_clock::now();
+                const size_t changed = passes_[i]->run(module);
+                const auto   elapsed = std::chrono::steady_clock::now() - start;
+
+                auto &statistics = statistics_[i];
+                ++statistics.runs;
+                statistics.changes += changed;
+                statistics.milliseconds += std::chrono::duration<double, std::milli>(elapsed).count();
+                changes += changed;
+            }
+            if (changes == 0) {
+                break;
+            }
+        }
+    }
+
+    void PassManager::report(std::ostream &out) const {
+        char line[128];
+        for (const auto &statistics : statistics_) {
+            std::snprintf(line, sizeof(line), "%-24s runs %-3zu changes %-8zu %10.3f ms\n", statistics.name, statistics.runs,
+                          statistics.changes, statistics.milliseconds);
+            out << line;
+        }
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef RIK_IR_PASS_MANAGER
+#define RIK_IR_PASS_MANAGER
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "IR.h"
+
+namespace Rikkyu::IR {
+    class Pass {
+    public:
+        virtual ~Pass() = default;
+
+        [[nodiscard]] virtual const char *name() const = 0;
+
+        // 对模块做一遍变换，返回改动的指令数（0 表示没有变化）
+        virtual size_t run(Module &module) = 0;
+    };
+
+    // 按顺序运行一组 Pass，重复整组直到不再有改动或达到轮数上限，并统计每个 Pass 的耗时和改动数
+    class PassManager {
+    public:
+        struct Statistics {
+            const char *name = "";
+            size_t      runs = 0;
+            size_t      changes = 0;
+            double      milliseconds = 0;
+        };
+
+        explicit PassManager(size_t maxRounds = 4);
+        ~PassManager() = default;
+
+        PassManager(PassManager &&) = default;
+        PassManager &operator=(PassManager &&) = default;
+
+        // 窥孔优化、常量折叠、循环惯用法和死代码消除
+        static PassManager standard();
+
+        PassManager &add(std::unique_ptr<Pass> pass);
+
+        void run(Module &module);
+
+        [[nodiscard]] const std::vector<Statistics> &statistics() const {
+            return statistics_;
+        }
+
+        // 每个 Pass 一行：名称、运行次数、改动数、耗时
+        void report(std::ostream &out) const;
+
+    private:
+        size_t                             maxRounds_;
+        std::vector<std::unique_ptr<Pass>> passes_;
+        std::vector<Statistics>            statistics_;
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR_PASS_MANAGER
@@ -0,0 +1,719 @@
+#include "Passes.h"
+
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+namespace Rikkyu::IR {
+    namespace {
+        bool taken(Op op, int64_t value) {
+            switch (op) {
+            case Op::JumpZero:
+                return value == 0;
+            case Op::JumpNonZero:
+                return value != 0;
+            default:
+                return value < 0;
+            }
+        }
+
+        // 结果不被使用时可以整条删掉的指令。算术溢出只在结果被使用时才有意义，
+        // 除法和取模只有除数是非 0、非 -1 的立即数时才不会出错
+        bool removable(const Instruction &instruction) {
+            switch (instruction.op) {
+            case Op::Mov:
+            case Op::Trunc:
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::LoadTape:
+            case Op::LoadHeap:
+            case Op::Peek:
+                return true;
+            case Op::Div:
+            case Op::Mod:
+                return instruction.b.isImmediate() && instruction.b.imm != 0 && instruction.b.imm != -1;
+            default:
+                return false;
+            }
+        }
+
+        void makeNop(Instruction &instruction) {
+            instruction = Instruction();
+        }
+
+        // 循环体内一个值的符号形式：常数，或者块开头时 tape[p + offset] 的值加上常数 k（按单元格宽度取模）。
+        // truncated 表示寄存器里的实际值已经截断到单元格宽度，可以直接拿来判断是否为 0
+        struct Symbol {
+            enum class Kind : uint8_t {
+                Unknown,
+                Constant,
+                Cell
+            };
+
+            Kind    kind = Kind::Unknown;
+            int32_t offset = 0;
+            int64_t k = 0;
+            bool    truncated = false;
+        };
+
+        // 一个可以改写成乘加的循环体：stored 按第一次写入的顺序记录被改动的单元和每轮的增量，
+        // step 为计数单元 [p+0] 每轮的增量，low / high 为访问到的偏移范围
+        struct LoopSummary {
+            std::vector<std::pair<int32_t, int64_t>> stored;
+            int64_t                                  step = 0;
+            int32_t                                  low = 0;
+            int32_t                                  high = 0;
+        };
+
+        // 符号执行 [begin, end) 这个块，最后一条是跳回 begin 的 JumpNonZero。
+        // crosses 标记了在别的块里读到的寄存器，块内定义的寄存器被外面用到时不能改写
+        bool summarize(const Module &module, size_t begin, size_t end, const std::vector<bool> &crosses, LoopSummary &summary) {
+            const auto   &code = module.code;
+            const int64_t mask = (int64_t(1) << module.cellBits) - 1;
+
+            std::unordered_map<int32_t, Symbol> cells;
+            std::unordered_map<int32_t, Symbol> registers;
+            auto cell = [&](int32_t offset) {
+                auto it = cells.find(offset);
+                return it != cells.end() ? it->second : Symbol{Symbol::Kind::Cell, offset, 0, true};
+            };
+            auto value = [&](const Operand &operand) {
+                if (operand.isImmediate() && operand.imm >= -mask && operand.imm <= mask) {
+                    return Symbol{Symbol::Kind::Constant, 0, operand.imm, false};
+                }
+                if (operand.isRegister()) {
+                    auto it = registers.find(operand.reg);
+                    if (it != registers.end()) {
+                        return it->second;
+                    }
+                }
+                return Symbol();
+            };
+            auto touch = [&](int32_t offset) {
+                summary.low = std::min(summary.low, offset);
+                summary.high = std::max(summary.high, offset);
+            };
+
+            for (size_t i = begin; i + 1 < end; ++i) {
+                const Instruction &instruction = code[i];
+                Symbol             result;
+                switch (instruction.op) {
+                case Op::Nop:
+                    continue;
+                case Op::LoadTape:
+                    touch(instruction.offset);
+                    result = cell(instruction.offset);
+                    break;
+                case Op::StoreTape: {
+                    // 只接受“原值加常数”写回原处
+                    Symbol stored = value(instruction.a);
+                    if (stored.kind != Symbol::Kind::Cell || stored.offset != instruction.offset) {
+                        return false;
+                    }
+                    touch(instruction.offset);
+                    stored.k &= mask;
+                    stored.truncated = true;
+                    cells[instruction.offset] = stored;
+                    continue;
+                }
+                case Op::Mov:
+                    result = value(instruction.a);
+                    break;
+                case Op::Trunc:
+                    result = value(instruction.a);
+                    result.k &= mask;
+                    result.truncated = true;
+                    break;
+                case Op::Add:
+                case Op::Sub: {
+                    Symbol a = value(instruction.a);
+                    Symbol b = value(instruction.b);
+                    if (instruction.op == Op::Add && a.kind == Symbol::Kind::Constant) {
+                        std::swap(a, b);
+                    }
+                    if (a.kind != Symbol::Kind::Cell || b.kind != Symbol::Kind::Constant) {
+                        return false;
+                    }
+                    result = a;
+                    result.k = (a.k + (instruction.op == Op::Add ? b.k : -b.k)) & mask;
+                    result.truncated = false;
+                    break;
+                }
+                default:
+                    return false;
+                }
+                if (result.kind == Symbol::Kind::Unknown || crosses[static_cast<size_t>(instruction.dst)]) {
+                    return false;
+                }
+                registers[instruction.dst] = result;
+            }
+
+            // 回边的条件必须就是计数单元的新值
+            const Symbol counter = cell(0);
+            const Symbol condition = value(code[end - 1].a);
+            if (counter.k != 1 && counter.k != mask) {
+                return false;
+            }
+            if (condition.kind != Symbol::Kind::Cell || condition.offset != 0 || !condition.truncated || condition.k != counter.k) {
+                return false;
+            }
+            summary.step = counter.k;
+
+            // 按第一次写入的顺序排列（unordered_map 不保序，另外扫一遍）
+            for (size_t i = begin; i + 1 < end; ++i) {
+                const Instruction &instruction = code[i];
+                if (instruction.op != Op::StoreTape || instruction.offset == 0) {
+                    continue;
+                }
+                const bool seen = std::any_of(summary.stored.begin(), summary.stored.end(), [&](const auto &entry) { return entry.first == instruction.offset; });
+                const int64_t delta = cells[instruction.offset].k;
+                if (!seen && delta != 0) {
+                    summary.stored.emplace_back(instruction.offset, delta);
+                }
+            }
+            return true;
+        }
+    } // namespace
+
+    size_t ConstantFolding::run(Module &module) {
+        const std::vector<bool> leader = module.leaders();
+
+        // 常量表按块失效：stamp 不等于当前块编号的表项视为未知
+        std::vector<int64_t>  value(static_cast<size_t>(module.registers), 0);
+        std::vector<uint32_t> stamp(static_cast<size_t>(module.registers), 0);
+        uint32_t              block = 0;
+        size_t                changes = 0;
+
+        auto substitute = [&](Operand &operand) {
+            if (operand.isRegister() && stamp[static_cast<size_t>(operand.reg)] == block) {
+                operand = Operand::i(value[static_cast<size_t>(operand.reg)]);
+                ++changes;
+            }
+        };
+
+        for (size_t i = 0; i < module.code.size(); ++i) {
+            if (leader[i]) {
+                ++block;
+            }
+            Instruction &instruction = module.code[i];
+            substitute(instruction.a);
+            substitute(instruction.b);
+
+            const Operand &a = instruction.a;
+            const Operand &b = instruction.b;
+            switch (instruction.op) {
+            case Op::Trunc:
+                if (a.isImmediate()) {
+                    instruction.op = Op::Mov;
+                    instruction.a = Operand::i(module.truncate(a.imm));
+                    ++changes;
+                }
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Div:
+            case Op::Mod: {
+                int64_t result = 0;
+                if (a.isImmediate() && b.isImmediate()) {
+                    if (evaluate(instruction.op, a.imm, b.imm, result)) {
+                        instruction.op = Op::Mov;
+                        instruction.a = Operand::i(result);
+                        instruction.b = Operand();
+                        ++changes;
+                    }
+                    break;
+                }
+                // 恒等式：x + 0、x - 0、x * 1、x / 1 -> x，x * 0 -> 0
+                const bool identity = b.isImmediate() && ((b.imm == 0 && (instruction.op == Op::Add || instruction.op == Op::Sub)) ||
+                                                          (b.imm == 1 && (instruction.op == Op::Mul || instruction.op == Op::Div)));
+                const bool zero = instruction.op == Op::Mul && ((b.isImmediate() && b.imm == 0) || (a.isImmediate() && a.imm == 0));
+                if (zero) {
+                    instruction.op = Op::Mov;
+                    instruction.a = Operand::i(0);
+                    instruction.b = Operand();
+                    ++changes;
+                } else if (identity) {
+                    instruction.op = Op::Mov;
+                    instruction.b = Operand();
+                    ++changes;
+                }
+                break;
+            }
+            case Op::JumpZero:
+            case Op::JumpNonZero:
+            case Op::JumpNegative:
+                if (a.isImmediate()) {
+                    if (taken(instruction.op, a.imm)) {
+                        instruction.op = Op::Jump;
+                        instruction.a = Operand();
+                    } else {
+                        makeNop(instruction);
+                    }
+                    ++changes;
+                }
+                break;
+            default:
+                break;
+            }
+
+            if (Module::definesRegister(instruction.op)) {
+                const auto dst = static_cast<size_t>(instruction.dst);
+                if (instruction.op == Op::Mov && instruction.a.isImmediate()) {
+                    value[dst] = instruction.a.imm;
+                    stamp[dst] = block;
+                } else {
+                    stamp[dst] = 0;
+                }
+            }
+        }
+
+        if (changes) {
+            module.compact();
+        }
+        return changes;
+    }
+
+    size_t DeadCodeElimination::run(Module &module) {
+        auto        &code = module.code;
+        const size_t size = code.size();
+        size_t       changes = 0;
+
+        // 从入口出发的可达性。CALL 既到达被调用者，也到达返回点
+        std::vector<bool>   reachable(size + 1, false);
+        std::vector<size_t> worklist{0};
+        while (!worklist.empty()) {
+            const size_t i = worklist.back();
+            worklist.pop_back();
+            if (i >= size || reachable[i]) {
+                continue;
+            }
+            reachable[i] = true;
+            const Op op = code[i].op;
+            if (Module::isBranch(op)) {
+                worklist.push_back(static_cast<size_t>(code[i].target));
+            }
+            if (!Module::isTerminator(op)) {
+                worklist.push_back(i + 1);
+            }
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (!reachable[i] && code[i].op != Op::Nop) {
+                makeNop(code[i]);
+                ++changes;
+            }
+        }
+
+        // 结果没人使用的指令，删掉之后它的操作数可能也变得没人使用，用工作表一直做到不动点
+        std::vector<uint32_t> uses(static_cast<size_t>(module.registers), 0);
+        std::vector<int32_t>  definition(static_cast<size_t>(module.registers), -1);
+        for (size_t i = 0; i < size; ++i) {
+            const auto &instruction = code[i];
+            for (const Operand *operand : {&instruction.a, &instruction.b}) {
+                if (operand->isRegister()) {
+                    ++uses[static_cast<size_t>(operand->reg)];
+                }
+            }
+            if (Module::definesRegister(instruction.op)) {
+                // 被多次定义的寄存器不参与删除
+                auto &slot = definition[static_cast<size_t>(instruction.dst)];
+                slot = slot == -1 ? static_cast<int32_t>(i) : -2;
+            }
+        }
+
+        std::vector<int32_t> dead;
+        for (size_t r = 0; r < uses.size(); ++r) {
+            if (uses[r] == 0 && definition[r] >= 0) {
+                dead.push_back(static_cast<int32_t>(r));
+            }
+        }
+        while (!dead.empty()) {
+            const int32_t reg = dead.back();
+            dead.pop_back();
+            Instruction &instruction = code[static_cast<size_t>(definition[static_cast<size_t>(reg)])];
+            if (instruction.op == Op::Nop || !removable(instruction)) {
+                continue;
+            }
+            for (const Operand *operand : {&instruction.a, &instruction.b}) {
+                if (operand->isRegister() && --uses[static_cast<size_t>(operand->reg)] == 0 && definition[static_cast<size_t>(operand->reg)] >= 0) {
+                    dead.push_back(operand->reg);
+                }
+            }
+            makeNop(instruction);
+            ++changes;
+        }
+
+        if (changes) {
+            module.compact();
+        }
+        return changes;
+    }
+
+    size_t Peephole::run(Module &module) {
+        const size_t changes = threadJumps(module) + foldPointerMoves(module) + forwardStores(module);
+        if (changes) {
+            module.compact();
+        }
+        return changes;
+    }
+
+    size_t Peephole::threadJumps(Module &module) {
+        auto  &code = module.code;
+        size_t changes = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            Instruction &instruction = code[i];
+            if (!Module::isBranch(instruction.op)) {
+                continue;
+            }
+            // 目标是无条件跳转时直接跳到最终目标，限制跳数以免在死循环上打转
+            for (int hops = 0; hops < 16; ++hops) {
+                const auto target = static_cast<size_t>(instruction.target);
+                if (target >= code.size() || code[target].op != Op::Jump || code[target].target == instruction.target) {
+                    break;
+                }
+                instruction.target = code[target].target;
+                ++changes;
+            }
+            // 跳到紧随其后的指令等于什么都不做
+            if (instruction.op != Op::Call && static_cast<size_t>(instruction.target) == i + 1) {
+                makeNop(instruction);
+                ++changes;
+            }
+        }
+        return changes;
+    }
+
+    size_t Peephole::foldPointerMoves(Module &module) {
+        auto                   &code = module.code;
+        const std::vector<bool> leader = module.leaders();
+        const size_t            size = code.size();
+        size_t                  changes = 0;
+
+        // 逐条移动时中途越界只报错并忽略那一次移动，合并之后就不再等价。
+        // 所以合并了多次移动的块在开头加一条 JumpOutside：途经的单元有一个不在纸带内时，
+        // 跳到放在模块末尾的原样副本（慢路径）逐条执行。慢路径的块本身不再合并
+        std::vector<bool> slow(size + 1, false);
+        for (const auto &instruction : code) {
+            if (instruction.op == Op::JumpOutside) {
+                slow[static_cast<size_t>(instruction.target)] = true;
+            }
+        }
+        std::vector<Instruction>                copies;
+        std::vector<std::pair<size_t, int32_t>> guards; // JumpOutside 的下标 -> 慢路径在 copies 中的位置
+
+        // 每个块里最后一次指针移动的位置保留总位移，之前的移动全部删除，
+        // 它们之间的纸带访问按当时的累计位移改写偏移量
+        size_t begin = 0;
+        while (begin < size) {
+            size_t end = begin + 1;
+            while (end < size && !leader[end]) {
+                ++end;
+            }
+
+            size_t  moves = 0;
+            size_t  first = 0;
+            size_t  last = 0;
+            int64_t total = 0;
+            int64_t low = 0;  // 相对块开头指针途经的最小偏移
+            int64_t high = 0; // 最大偏移
+            bool    safe = !slow[begin];
+            for (size_t i = begin; safe && i < end; ++i) {
+                const Instruction &instruction = code[i];
+                if (instruction.op == Op::MovePointer) {
+                    if (!instruction.a.isImmediate()) {
+                        safe = false;
+                        break;
+                    }
+                    total += instruction.a.imm;
+                    first = moves ? first : i;
+                    last = i;
+                    ++moves;
+                    low = std::min(low, total);
+                    high = std::max(high, total);
+                } else if (instruction.op == Op::LoadTape || instruction.op == Op::StoreTape) {
+                    if (total + instruction.offset > INT32_MAX || total + instruction.offset < INT32_MIN) {
+                        safe = false;
+                        break;
+                    }
+                    low = std::min(low, total + instruction.offset);
+                    high = std::max(high, total + instruction.offset);
+                }
+            }
+
+            if (safe && (moves > 1 || (moves == 1 && total == 0))) {
+                if (moves > 1) {
+                    guards.emplace_back(begin, static_cast<int32_t>(copies.size()));
+                    copies.insert(copies.end(), code.begin() + static_cast<ptrdiff_t>(begin), code.begin() + static_cast<ptrdiff_t>(end));
+                    if (!Module::isTerminator(code[end - 1].op)) {
+                        copies.push_back(Instruction::branch(Op::Jump, static_cast<int32_t>(end)));
+                    }
+                }
+
+                int64_t delta = 0;
+                for (size_t i = begin; i < last; ++i) {
+                    Instruction &instruction = code[i];
+                    if (instruction.op == Op::MovePointer) {
+                        delta += instruction.a.imm;
+                        makeNop(instruction);
+                        ++changes;
+                    } else if (instruction.op == Op::LoadTape || instruction.op == Op::StoreTape) {
+                        instruction.offset += static_cast<int32_t>(delta);
+                    }
+                }
+                if (total == 0) {
+                    makeNop(code[last]);
+                    ++changes;
+                } else {
+                    code[last].a = Operand::i(total);
+                }
+
+                // 第一次移动之前的指令后移一格，腾出块开头放守卫（第一次移动已经删掉了）
+                if (moves > 1) {
+                    for (size_t i = first; i > begin; --i) {
+                        code[i] = code[i - 1];
+                    }
+                    code[begin] = Instruction::binary(Op::JumpOutside, -1, Operand::i(low), Operand::i(high));
+                    // 总位移为 0 的块跳回自己开头时指针不变，守卫的结果也不变，回边直接越过守卫
+                    Instruction &back = code[end - 1];
+                    if (total == 0 && Module::isBranch(back.op) && back.op != Op::Call && static_cast<size_t>(back.target) == begin) {
+                        back.target = static_cast<int32_t>(begin + 1);
+                    }
+                }
+            }
+            begin = end;
+        }
+
+        if (!copies.empty()) {
+            // 慢路径接在最后，原来从末尾落出去的执行改为落到 Halt
+            if (!Module::isTerminator(code.back().op)) {
+                code.push_back(Instruction::of(Op::Halt));
+            }
+            const auto base = static_cast<int32_t>(code.size());
+            for (const auto &[guard, offset] : guards) {
+                code[guard].target = base + offset;
+            }
+            code.insert(code.end(), copies.begin(), copies.end());
+        }
+        return changes;
+    }
+
+    size_t Peephole::forwardStores(Module &module) {
+        auto                   &code = module.code;
+        const std::vector<bool> leader = module.leaders();
+        size_t                  changes = 0;
+
+        // 一个存储单元在块内的已知内容：value 为它当前的值，
+        // store 是尚未被读取过的最近一次存储（可以被后面的存储覆盖删除），
+        // truncated 表示 value 已经是截断后的单元格值
+        struct Known {
+            Operand value;
+            int32_t store = -1;
+            bool    truncated = false;
+        };
+        std::unordered_map<int32_t, Known> tape;
+        std::unordered_map<int64_t, Known> heap;
+
+        auto forget = [](auto &table, int32_t reg) {
+            for (auto it = table.begin(); it != table.end();) {
+                if (it->second.value.isRegister() && it->second.value.reg == reg) {
+                    it = table.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        };
+
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (leader[i]) {
+                tape.clear();
+                heap.clear();
+            }
+            Instruction &instruction = code[i];
+            switch (instruction.op) {
+            case Op::StoreTape: {
+                Known &known = tape[instruction.offset];
+                if (known.store >= 0) {
+                    makeNop(code[static_cast<size_t>(known.store)]);
+                    ++changes;
+                }
+                known = {instruction.a, static_cast<int32_t>(i), false};
+                break;
+            }
+            case Op::LoadTape: {
+                auto it = tape.find(instruction.offset);
+                if (it == tape.end()) {
+                    tape[instruction.offset] = {Operand::r(instruction.dst), -1, true};
+                    break;
+                }
+                Known &known = it->second;
+                instruction.op = known.truncated || module.cellBits >= 64 ? Op::Mov : Op::Trunc;
+                instruction.a = known.value;
+                ++changes;
+                break;
+            }
+            case Op::MovePointer:
+                tape.clear();
+                break;
+            case Op::StoreHeap: {
+                if (!instruction.a.isImmediate()) {
+                    heap.clear();
+                    break;
+                }
+                Known &known = heap[instruction.a.imm];
+                if (known.store >= 0) {
+                    makeNop(code[static_cast<size_t>(known.store)]);
+                    ++changes;
+                }
+                known = {instruction.b, static_cast<int32_t>(i), true};
+                break;
+            }
+            case Op::LoadHeap: {
+                if (!instruction.a.isImmediate()) {
+                    // 未知地址的读取可能读到任何一个待定的存储
+                    for (auto &entry : heap) {
+                        entry.second.store = -1;
+                    }
+                    break;
+                }
+                auto it = heap.find(instruction.a.imm);
+                if (it == heap.end()) {
+                    heap[instruction.a.imm] = {Operand::r(instruction.dst), -1, true};
+                    break;
+                }
+                instruction.op = Op::Mov;
+                instruction.a = it->second.value;
+                ++changes;
+                break;
+            }
+            case Op::Call:
+            case Op::Return:
+            case Op::Halt:
+            case Op::Fail:
+                tape.clear();
+                heap.clear();
+                break;
+            default:
+                break;
+            }
+
+            // 寄存器被重新定义后，以它为值的表项失效
+            if (Module::definesRegister(instruction.op) && instruction.op != Op::LoadTape && instruction.op != Op::LoadHeap) {
+                forget(tape, instruction.dst);
+                forget(heap, instruction.dst);
+            }
+        }
+        return changes;
+    }
+
+    size_t LoopIdiom::run(Module &module) {
+        if (module.tapeCells == 0 || module.cellBits > 32) {
+            return 0;
+        }
+        auto                   &code = module.code;
+        const std::vector<bool> leader = module.leaders();
+        const size_t            size = code.size();
+        const int64_t           mask = (int64_t(1) << module.cellBits) - 1;
+        size_t                  changes = 0;
+
+        // 在定义之前就被某个块读到的寄存器，说明它的值跨块传递
+        std::vector<bool>   crosses(static_cast<size_t>(module.registers), false);
+        std::vector<size_t> definedIn(static_cast<size_t>(module.registers), 0);
+        size_t              block = 0;
+        for (size_t i = 0; i < size; ++i) {
+            block += leader[i] ? 1 : 0;
+            const auto &instruction = code[i];
+            for (const Operand *operand : {&instruction.a, &instruction.b}) {
+                if (operand->isRegister() && definedIn[static_cast<size_t>(operand->reg)] != block) {
+                    crosses[static_cast<size_t>(operand->reg)] = true;
+                }
+            }
+            if (Module::definesRegister(instruction.op)) {
+                definedIn[static_cast<size_t>(instruction.dst)] = block;
+            }
+        }
+
+        // 改写后比原来长的循环放到模块末尾，原处跳过去再跳回来
+        std::vector<Instruction>                tail;
+        std::vector<std::pair<size_t, int32_t>> jumps; // 原处的 Jump 下标 -> 在 tail 中的位置
+
+        size_t begin = 0;
+        while (begin < size) {
+            size_t end = begin + 1;
+            while (end < size && !leader[end]) {
+                ++end;
+            }
+
+            const Instruction &back = code[end - 1];
+            LoopSummary        summary;
+            if (back.op != Op::JumpNonZero || static_cast<size_t>(back.target) != begin || !summarize(module, begin, end, crosses, summary)) {
+                begin = end;
+                continue;
+            }
+            if (summary.low < 0 || summary.high > 0) {
+                const bool guarded = begin > 0 && code[begin - 1].op == Op::JumpOutside && code[begin - 1].a.imm <= summary.low &&
+                                     code[begin - 1].b.imm >= summary.high;
+                if (!guarded) {
+                    begin = end;
+                    continue;
+                }
+            }
+
+            // 每轮减 1 时执行 [p+0] 轮，加 1 时执行 -[p+0] 轮（回绕到 0），其余单元加上轮数乘增量。
+            // 乘数取按单元格宽度的有符号代表，乘积和相加都不会溢出 64 位
+            std::vector<Instruction> idiom;
+            const int32_t            count = module.newRegister();
+            Instruction              load = Instruction::of(Op::LoadTape, count);
+            idiom.push_back(load);
+            for (const auto &[offset, delta] : summary.stored) {
+                int64_t factor = summary.step == mask ? delta : -delta & mask;
+                factor = factor > mask / 2 ? factor - mask - 1 : factor;
+
+                const int32_t old = module.newRegister();
+                load = Instruction::of(Op::LoadTape, old);
+                load.offset = offset;
+                idiom.push_back(load);
+                const int32_t sum = module.newRegister();
+                if (factor == 1 || factor == -1) {
+                    idiom.push_back(Instruction::binary(factor == 1 ? Op::Add : Op::Sub, sum, Operand::r(old), Operand::r(count)));
+                } else {
+                    const int32_t product = module.newRegister();
+                    idiom.push_back(Instruction::binary(Op::Mul, product, Operand::r(count), Operand::i(factor)));
+                    idiom.push_back(Instruction::binary(Op::Add, sum, Operand::r(old), Operand::r(product)));
+                }
+                Instruction store = Instruction::unary(Op::StoreTape, -1, Operand::r(sum));
+                store.offset = offset;
+                idiom.push_back(store);
+            }
+            idiom.push_back(Instruction::unary(Op::StoreTape, -1, Operand::i(0)));
+
+            for (size_t i = begin; i < end; ++i) {
+                makeNop(code[i]);
+            }
+            if (idiom.size() <= end - begin) {
+                std::copy(idiom.begin(), idiom.end(), code.begin() + static_cast<ptrdiff_t>(begin));
+            } else {
+                jumps.emplace_back(begin, static_cast<int32_t>(tail.size()));
+                tail.insert(tail.end(), idiom.begin(), idiom.end());
+                tail.push_back(Instruction::branch(Op::Jump, static_cast<int32_t>(end)));
+            }
+            ++changes;
+            begin = end;
+        }
+
+        if (!tail.empty()) {
+            if (!Module::isTerminator(code.back().op)) {
+                code.push_back(Instruction::of(Op::Halt));
+            }
+            const auto base = static_cast<int32_t>(code.size());
+            for (const auto &[index, offset] : jumps) {
+                code[index] = Instruction::branch(Op::Jump, base + offset);
+            }
+            code.insert(code.end(), tail.begin(), tail.end());
+        }
+        if (changes) {
+            module.compact();
+        }
+        return changes;
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef RIK_IR_PASSES
+#define RIK_IR_PASSES
+
+#include "PassManager.h"
+
+namespace Rikkyu::IR {
+    // 块内常量传播与折叠：
+    //   - 已知为常量的寄存器在使用处替换为立即数；
+    //   - 操作数都是立即数的算术直接算出结果（会溢出或除零的保留到运行时报错）；
+    //   - x + 0、x * 1 等恒等式化简为 Mov；
+    //   - 条件是立即数的跳转变成无条件跳转或删除。
+    class ConstantFolding : public Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "constant-folding"; }
+
+        size_t run(Module &module) override;
+    };
+
+    // 死代码消除：删除从入口不可达的指令，以及结果从未被使用的无副作用指令
+    class DeadCodeElimination : public Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "dead-code-elimination"; }
+
+        size_t run(Module &module) override;
+    };
+
+    // 窥孔优化：
+    //   - 跳转链穿透，跳到下一条的跳转删除；
+    //   - 块内的多次指针移动合并为一次，中间的纸带访问改为相对偏移；
+    //   - 块内纸带 / 常量地址堆单元的存储到读取转发，被覆盖的存储删除。
+    class Peephole : public Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "peephole"; }
+
+        size_t run(Module &module) override;
+
+    private:
+        size_t threadJumps(Module &module);
+        size_t foldPointerMoves(Module &module);
+        size_t forwardStores(Module &module);
+    };
+
+    // 循环惯用法：只有一个块、回边跳回块开头的循环，如果块内只是把若干纸带单元加上常数，
+    // 并且计数单元 [p+0] 每轮 ±1、回边按它的新值判断，就改写成乘加再把 [p+0] 清零（[-]、[->+<] 一类）。
+    // 单元格宽度需不超过 32 位，乘积才放得进 64 位；访问 [p+0] 以外的单元时，
+    // 块前必须紧跟覆盖这些偏移的 JumpOutside，越界时仍走原样的慢路径逐轮执行
+    class LoopIdiom : public Pass {
+    public:
+        [[nodiscard]] const char *name() const override { return "loop-idiom"; }
+
+        size_t run(Module &module) override;
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR_PASSES
@@ -0,0 +1,448 @@
+#include "VM.h"
+
+#include <charconv>
+#include <string>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::IR {
+    // run() 的输入输出：直接读写 BufferedIO，永远不会挂起
+    struct VM::BlockingPort {
+        static constexpr bool kYields = false;
+        static constexpr bool kCounts = false;
+
+        utils::BufferedInput  &input;
+        utils::BufferedOutput &output;
+
+        RIK_INLINE int get() {
+            return input.get();
+        }
+
+        RIK_INLINE bool readInteger(int64_t &value, utils::BufferedInput::NumberStatus &status) {
+            std::string text;
+            status = input.readInteger(value, text);
+            return true;
+        }
+
+        RIK_INLINE bool put(char c) {
+            output.put(c);
+            return true;
+        }
+
+        RIK_INLINE bool writeInteger(int64_t value) {
+            output.writeInteger(value);
+            return true;
+        }
+
+        void flush() {
+            output.flush();
+        }
+    };
+
+    // 与 BlockingPort 相同，另外统计执行的指令条数
+    struct VM::CountingPort : BlockingPort {
+        static constexpr bool kCounts = true;
+
+        uint64_t executed = 0;
+    };
+
+    // resume() 的输入输出：读写 VM 里的缓冲区。
+    // get() / readInteger() 在输入不够时返回“会阻塞”，put() / writeInteger() 在缓冲满时返回 false（这次写入已经完成）
+    struct VM::ResumablePort {
+        static constexpr bool kYields = true;
+        static constexpr bool kCounts = false;
+        static constexpr int  kWouldBlock = -2;
+
+        VM &vm;
+
+        RIK_INLINE int get() {
+            if (vm.inputPosition_ < vm.pendingInput_.size()) {
+                return static_cast<unsigned char>(vm.pendingInput_[vm.inputPosition_++]);
+            }
+            return vm.inputClosed_ ? EOF : kWouldBlock;
+        }
+
+        // 与 BufferedInput::readInteger 相同：跳过空白，读到下一个空白为止并吃掉它。
+        // 记号后面还没有出现空白且输入没有关闭时，数字可能还没输完，返回 false 等待更多输入
+        bool readInteger(int64_t &value, utils::BufferedInput::NumberStatus &status) {
+            const std::string &input = vm.pendingInput_;
+            size_t             i = vm.inputPosition_;
+            while (i < input.size() && utils::BufferedInput::isSpace(input[i])) {
+                ++i;
+            }
+            const size_t begin = i;
+            while (i < input.size() && !utils::BufferedInput::isSpace(input[i])) {
+                ++i;
+            }
+            if (i == input.size() && !vm.inputClosed_) {
+                return false;
+            }
+
+            const std::string token = input.substr(begin, i - begin);
+            vm.inputPosition_ = i < input.size() ? i + 1 : i;
+            status = token.empty() ? utils::BufferedInput::NumberStatus::EndOfFile : utils::BufferedInput::parseInteger(token, value);
+            return true;
+        }
+
+        RIK_INLINE bool put(char c) {
+            vm.pendingOutput_.push_back(c);
+            return vm.pendingOutput_.size() < vm.outputLimit_;
+        }
+
+        bool writeInteger(int64_t value) {
+            char buffer[24];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            vm.pendingOutput_.append(buffer, result.ptr);
+            return vm.pendingOutput_.size() < vm.outputLimit_;
+        }
+
+        void flush() {}
+    };
+
+    VM::VM(size_t callDepthLimit)
+        : callDepthLimit_(callDepthLimit) {}
+
+    VM::Status VM::fail(Trap trap, size_t pc) {
+        return fail(module_->trap(trap), pc);
+    }
+
+    VM::Status VM::fail(const std::string &message, size_t pc) {
+        utils::ErrorHandler::getInstance().makeError(message, pc);
+        pc_ = module_->code.size();
+        return Status::Failed;
+    }
+
+    void VM::report(Trap trap, size_t pc) {
+        auto &handler = utils::ErrorHandler::getInstance();
+        if (trap == Trap::EndOfInput) {
+            handler.makeWarning(module_->trap(trap), pc);
+        } else {
+            handler.makeError(module_->trap(trap), pc);
+        }
+    }
+
+    void VM::reset() {
+        module_ = nullptr;
+        pc_ = 0;
+        p_ = 0;
+        tape_.reset();
+        dense_.reset();
+        stack_.clear();
+        calls_.clear();
+        sparse_.clear();
+        pendingInput_.clear();
+        inputPosition_ = 0;
+        inputClosed_ = false;
+        pendingOutput_.clear();
+    }
+
+    void VM::store(int64_t address, int64_t value) {
+        if (static_cast<uint64_t>(address) < dense_.size()) {
+            dense_.touch(static_cast<size_t>(address));
+            dense_[static_cast<size_t>(address)] = value;
+        } else {
+            sparse_[address] = value;
+        }
+    }
+
+    void VM::start(const Module &module) {
+        reset();
+        module_ = &module;
+        registers_.assign(static_cast<size_t>(module.registers), 0);
+        tape_.ensure(module.tapeCells);
+        dense_.ensure(kDenseHeap);
+    }
+
+    void VM::restore(const VM &snapshot) {
+        module_ = snapshot.module_;
+        pc_ = snapshot.pc_;
+        p_ = snapshot.p_;
+        registers_ = snapshot.registers_;
+        tape_.assign(snapshot.tape_);
+        stack_ = snapshot.stack_;
+        calls_ = snapshot.calls_;
+        dense_.assign(snapshot.dense_);
+        sparse_ = snapshot.sparse_;
+        pendingInput_.assign(snapshot.pendingInput_, snapshot.inputPosition_, std::string::npos);
+        inputPosition_ = 0;
+        inputClosed_ = snapshot.inputClosed_;
+        pendingOutput_.clear();
+    }
+
+    bool VM::run(const Module &module) {
+        start(module);
+        BlockingPort port{*input_, *output_};
+        return execute(port, SIZE_MAX) == Status::Finished;
+    }
+
+    bool VM::run(const Module &module, uint64_t &executed) {
+        start(module);
+        CountingPort port{{*input_, *output_}};
+        const bool finished = execute(port, SIZE_MAX) == Status::Finished;
+        executed = port.executed;
+        return finished;
+    }
+
+    VM::Status VM::resume(size_t budget) {
+        if (!module_) {
+            return Status::Finished;
+        }
+        ResumablePort port{*this};
+        return execute(port, budget);
+    }
+
+    void VM::feedInput(const char *data, size_t size) {
+        // 已经读过的部分超过一半时才整体前移，摊还下来每个字节只搬动常数次
+        if (inputPosition_ == pendingInput_.size()) {
+            pendingInput_.clear();
+            inputPosition_ = 0;
+        } else if (inputPosition_ > pendingInput_.size() / 2) {
+            pendingInput_.erase(0, inputPosition_);
+            inputPosition_ = 0;
+        }
+        pendingInput_.append(data, size);
+    }
+
+    template <typename Port>
+    VM::Status VM::execute(Port &port, size_t budget) {
+        const Module      &module = *module_;
+        const Instruction *code = module.code.data();
+        const size_t       size = module.code.size();
+        int64_t           *regs = registers_.data();
+        int64_t           *tape = tape_.data();
+        const size_t       cells = module.tapeCells;
+        size_t             p = p_;
+
+        const std::atomic<bool> *interrupt = interrupt_;
+
+        auto value = [regs](const Operand &operand) {
+            return operand.kind == Operand::Kind::Register ? regs[operand.reg] : operand.imm;
+        };
+        // 控制流转移时检查中断标志和执行预算
+        auto preempted = [interrupt, &budget](Status &status) {
+            if (interrupt && interrupt->load(std::memory_order_relaxed)) {
+                status = Status::Interrupted;
+                return true;
+            }
+            if constexpr (Port::kYields) {
+                if (--budget == 0) {
+                    status = Status::Yielded;
+                    return true;
+                }
+            }
+            return false;
+        };
+        // 挂起：保存下一条指令和纸带指针，下一次 resume() 从这里继续
+        auto suspend = [this, &port](size_t next, size_t pointer, Status status) {
+            pc_ = next;
+            p_ = pointer;
+            port.flush();
+            return status;
+        };
+        auto failWith = [this, &port](Trap trap, size_t at) {
+            port.flush();
+            return fail(trap, at);
+        };
+
+        Status status = Status::Finished;
+        size_t pc = pc_;
+        while (pc < size) {
+            const Instruction &instruction = code[pc];
+            if constexpr (Port::kCounts) {
+                ++port.executed;
+            }
+            switch (instruction.op) {
+            case Op::Nop:
+                break;
+            case Op::Mov:
+                regs[instruction.dst] = value(instruction.a);
+                break;
+            case Op::Trunc:
+                regs[instruction.dst] = module.truncate(value(instruction.a));
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul:
+            case Op::Div:
+            case Op::Mod: {
+                const int64_t b = value(instruction.b);
+                if (b == 0 && (instruction.op == Op::Div || instruction.op == Op::Mod)) {
+                    return failWith(instruction.op == Op::Div ? Trap::DivisionByZero : Trap::ModuloByZero, pc);
+                }
+                if (!evaluate(instruction.op, value(instruction.a), b, regs[instruction.dst])) {
+                    return failWith(Trap::Overflow, pc);
+                }
+                break;
+            }
+            case Op::LoadTape:
+            case Op::StoreTape: {
+                const size_t cell = p + static_cast<size_t>(static_cast<int64_t>(instruction.offset));
+                if (cell >= cells) {
+                    return failWith(instruction.offset < 0 ? Trap::PointerBackward : Trap::PointerForward, pc);
+                }
+                if (instruction.op == Op::LoadTape) {
+                    regs[instruction.dst] = tape[cell];
+                } else {
+                    tape_.touch(cell);
+                    tape[cell] = module.truncate(value(instruction.a));
+                }
+                break;
+            }
+            case Op::MovePointer: {
+                const int64_t delta = value(instruction.a);
+                const size_t  next = p + static_cast<size_t>(delta);
+                if (next >= cells) {
+                    report(delta < 0 ? Trap::PointerBackward : Trap::PointerForward, pc);
+                    break;
+                }
+                p = next;
+                break;
+            }
+            case Op::LoadHeap:
+                regs[instruction.dst] = load(value(instruction.a));
+                break;
+            case Op::StoreHeap:
+                store(value(instruction.a), value(instruction.b));
+                break;
+            case Op::Push:
+                stack_.push_back(value(instruction.a));
+                break;
+            case Op::Pop:
+                if (stack_.empty()) {
+                    return failWith(Trap::StackUnderflow, pc);
+                }
+                regs[instruction.dst] = stack_.back();
+                stack_.pop_back();
+                break;
+            case Op::Peek: {
+                const auto depth = static_cast<size_t>(value(instruction.a));
+                if (depth >= stack_.size()) {
+                    return failWith(Trap::StackUnderflow, pc);
+                }
+                regs[instruction.dst] = stack_[stack_.size() - 1 - depth];
+                break;
+            }
+            case Op::Discard:
+            case Op::Require: {
+                const auto depth = static_cast<uint64_t>(value(instruction.a));
+                if (depth > stack_.size()) {
+                    return failWith(Trap::StackUnderflow, pc);
+                }
+                if (instruction.op == Op::Discard) {
+                    stack_.resize(stack_.size() - depth);
+                }
+                break;
+            }
+            case Op::Jump:
+                pc = static_cast<size_t>(instruction.target);
+                if (preempted(status)) {
+                    return suspend(pc, p, status);
+                }
+                continue;
+            case Op::JumpZero:
+                if (value(instruction.a) == 0) {
+                    pc = static_cast<size_t>(instruction.target);
+                    if (preempted(status)) {
+                        return suspend(pc, p, status);
+                    }
+                    continue;
+                }
+                break;
+            case Op::JumpNonZero:
+                if (value(instruction.a) != 0) {
+                    pc = static_cast<size_t>(instruction.target);
+                    if (preempted(status)) {
+                        return suspend(pc, p, status);
+                    }
+                    continue;
+                }
+                break;
+            case Op::JumpNegative:
+                if (value(instruction.a) < 0) {
+                    pc = static_cast<size_t>(instruction.target);
+                    if (preempted(status)) {
+                        return suspend(pc, p, status);
+                    }
+                    continue;
+                }
+                break;
+            case Op::JumpOutside:
+                if (p + static_cast<size_t>(instruction.a.imm) >= cells || p + static_cast<size_t>(instruction.b.imm) >= cells) {
+                    pc = static_cast<size_t>(instruction.target);
+                    if (preempted(status)) {
+                        return suspend(pc, p, status);
+                    }
+                    continue;
+                }
+                break;
+            case Op::Call:
+                if (calls_.size() >= callDepthLimit_) {
+                    return failWith(Trap::CallOverflow, pc);
+                }
+                calls_.push_back(static_cast<uint32_t>(pc + 1));
+                pc = static_cast<size_t>(instruction.target);
+                if (preempted(status)) {
+                    return suspend(pc, p, status);
+                }
+                continue;
+            case Op::Return:
+                if (calls_.empty()) {
+                    return failWith(Trap::ReturnOutsideCall, pc);
+                }
+                pc = calls_.back();
+                calls_.pop_back();
+                continue;
+            case Op::Halt:
+                pc = size;
+                continue;
+            case Op::Fail:
+                port.flush();
+                return fail(module_->messages[static_cast<size_t>(instruction.a.imm)], pc);
+            case Op::ReadChar: {
+                const int c = port.get();
+                if (c == ResumablePort::kWouldBlock) {
+                    return suspend(pc, p, Status::NeedInput);
+                }
+                if (c < 0 && !module_->trap(Trap::EndOfInput).empty()) {
+                    report(Trap::EndOfInput, pc);
+                }
+                regs[instruction.dst] = c;
+                break;
+            }
+            case Op::ReadNumber: {
+                int64_t                             number = 0;
+                utils::BufferedInput::NumberStatus result{};
+                if (!port.readInteger(number, result)) {
+                    return suspend(pc, p, Status::NeedInput);
+                }
+                switch (result) {
+                case utils::BufferedInput::NumberStatus::Ok:
+                    regs[instruction.dst] = number;
+                    break;
+                case utils::BufferedInput::NumberStatus::Overflow:
+                    return failWith(Trap::Overflow, pc);
+                default:
+                    return failWith(Trap::InvalidNumber, pc);
+                }
+                break;
+            }
+            case Op::WriteChar:
+                if (!port.put(static_cast<char>(value(instruction.a)))) {
+                    return suspend(pc + 1, p, Status::OutputFull);
+                }
+                break;
+            case Op::WriteNumber:
+                if (!port.writeInteger(value(instruction.a))) {
+                    return suspend(pc + 1, p, Status::OutputFull);
+                }
+                break;
+            }
+            ++pc;
+        }
+
+        pc_ = size;
+        p_ = p;
+        port.flush();
+        return Status::Finished;
+    }
+} // namespace Rikkyu::IR
@@ -0,0 +1,139 @@
+#pragma once
+#ifndef RIK_IR_VM
+#define RIK_IR_VM
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IR.h"
+#include "../utils/BufferedIO/BufferedIO.h"
+#include "../utils/Pool/ResettableBuffer.h"
+
+namespace Rikkyu::IR {
+    // 直接解释执行 IR 模块的虚拟机，所有前端共用。
+    // 运行时错误按模块里登记的错误信息报告，并停止执行；纸带指针越界只报告，不停止。
+    //
+    // 有两种执行方式：
+    //   - run()：通过 BufferedInput / BufferedOutput 阻塞地读写，直到程序结束；
+    //   - start() + resume()：可恢复执行。输入由调用者用 feedInput() 喂进来，输出积累在 output() 里，
+    //     输入用完、输出缓冲满或执行预算耗尽时 resume() 返回，指令指针、纸带指针等状态都保存在 VM 里，
+    //     下一次 resume() 从原处继续。一个线程可以借此轮流推进许多个交互式会话。
+    class VM {
+    public:
+        static constexpr size_t kDefaultCallDepth = size_t(1) << 16;
+        static constexpr size_t kDenseHeap = size_t(1) << 16;
+        static constexpr size_t kDefaultOutputLimit = size_t(1) << 16;
+
+        enum class Status : uint8_t {
+            Finished,    // 正常结束
+            Failed,      // 运行时错误，已经报告
+            Interrupted, // 中断标志被置位
+            NeedInput,   // 输入已经读完但还没有关闭，喂入更多输入后继续
+            OutputFull,  // 输出缓冲达到上限，取走输出后继续
+            Yielded      // 执行预算耗尽，可以直接继续
+        };
+
+        explicit VM(size_t callDepthLimit = kDefaultCallDepth);
+        ~VM() = default;
+
+        VM(const VM &) = delete;
+        VM &operator=(const VM &) = delete;
+
+        void setIO(utils::BufferedInput &input, utils::BufferedOutput &output) {
+            input_ = &input;
+            output_ = &output;
+        }
+
+        // 另一个线程把 flag 置为 true 后，执行在下一次跳转或调用时停止；nullptr 表示不可中断
+        void setInterrupt(const std::atomic<bool> *flag) {
+            interrupt_ = flag;
+        }
+
+        // 正常结束返回 true，出错或被中断返回 false。每次运行前状态全部清空，
+        // 纸带和稠密堆只清理上一次运行写过的范围
+        bool run(const Module &module);
+        // 同上，并统计执行的指令条数（有额外开销，只用于性能分析）
+        bool run(const Module &module, uint64_t &executed);
+
+        // 供 utils::RunnerPool 复用：提前清理上一次运行留下的状态
+        void reset();
+
+        // 清空状态并从 module 的第一条指令开始可恢复执行。module 必须在执行结束前保持有效
+        void start(const Module &module);
+
+        // 继续执行，直到结束或需要挂起。budget 是最多允许的控制流转移次数，用完时返回 Yielded
+        Status resume(size_t budget = SIZE_MAX);
+
+        // 复制 snapshot 的执行状态（模块、指令指针、纸带、栈、堆和还没读走的输入），之后 resume() 从 snapshot
+        // 挂起的地方继续。输出、IO 和中断设置不复制。用于从同一段共享前缀分叉出多次执行，见 IR::BatchRunner
+        void restore(const VM &snapshot);
+
+        // 可恢复执行的输入。closeInput() 之后读到末尾的行为与 run() 遇到 EOF 相同
+        void feedInput(const char *data, size_t size);
+        void closeInput() {
+            inputClosed_ = true;
+        }
+        // 已经喂入但程序还没有读走的字节数
+        [[nodiscard]] size_t bufferedInput() const {
+            return pendingInput_.size() - inputPosition_;
+        }
+
+        // 可恢复执行积累的输出，调用者取走后用 clearOutput() 清空。超过 limit 字节时 resume() 返回 OutputFull
+        [[nodiscard]] const std::string &output() const {
+            return pendingOutput_;
+        }
+        void clearOutput() {
+            pendingOutput_.clear();
+        }
+        void setOutputLimit(size_t limit) {
+            outputLimit_ = limit;
+        }
+
+    private:
+        struct BlockingPort;
+        struct CountingPort;
+        struct ResumablePort;
+
+        template <typename Port>
+        Status execute(Port &port, size_t budget);
+        Status fail(Trap trap, size_t pc);
+        Status fail(const std::string &message, size_t pc);
+        // 不停止执行的错误和警告
+        void report(Trap trap, size_t pc);
+
+        RIK_INLINE int64_t load(int64_t address) const {
+            if (static_cast<uint64_t>(address) < dense_.size()) {
+                return dense_[static_cast<size_t>(address)];
+            }
+            auto it = sparse_.find(address);
+            return it == sparse_.end() ? 0 : it->second;
+        }
+
+        void store(int64_t address, int64_t value);
+
+        size_t                               callDepthLimit_;
+        const Module                        *module_ = nullptr;
+        size_t                               pc_ = 0; // 挂起时下一条要执行的指令
+        size_t                               p_ = 0;  // 纸带指针
+        std::vector<int64_t>                 registers_;
+        utils::ResettableBuffer<int64_t>     tape_;
+        std::vector<int64_t>                 stack_;
+        std::vector<uint32_t>                calls_;
+        utils::ResettableBuffer<int64_t>     dense_;
+        std::unordered_map<int64_t, int64_t> sparse_;
+        std::string                          pendingInput_;
+        size_t                               inputPosition_ = 0;
+        bool                                 inputClosed_ = false;
+        std::string                          pendingOutput_;
+        size_t                               outputLimit_ = kDefaultOutputLimit;
+        const std::atomic<bool>             *interrupt_ = nullptr;
+        utils::BufferedInput                *input_ = &utils::BufferedInput::standardInput();
+        utils::BufferedOutput               *output_ = &utils::BufferedOutput::standardOutput();
+    };
+} // namespace Rikkyu::IR
+
+#endif // RIK_IR_VM
@@ -0,0 +1,348 @@
+#include "Daemon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../utils/BufferedIO/BufferedIO.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::Server {
+    namespace {
+        // 程序输出的去处：每次写入变成一个 Output 帧。超过上限的部分被丢弃并中断程序
+        struct OutputSink {
+            int                fd;
+            size_t             limit;
+            size_t             written = 0;
+            bool               exceeded = false;
+            bool               broken = false; // 客户端已经断开
+            std::atomic<bool> *interrupt;
+        };
+
+        void writeOutput(void *context, const char *data, size_t size) {
+            auto *sink = static_cast<OutputSink *>(context);
+            if (sink->exceeded || sink->broken) {
+                return;
+            }
+            size_t allowed = std::min(size, sink->limit - sink->written);
+            if (allowed && !writeFrame(sink->fd, FrameType::Output, data, allowed)) {
+                sink->broken = true;
+                sink->interrupt->store(true, std::memory_order_relaxed);
+            }
+            sink->written += allowed;
+            if (allowed < size) {
+                sink->exceeded = true;
+                sink->interrupt->store(true, std::memory_order_relaxed);
+            }
+        }
+
+        // 把诊断信息发给客户端，其中有错误时 failed 置为 true
+        bool sendDiagnostics(int fd, const std::vector<utils::ErrorObj> &diagnostics, bool &failed) {
+            for (const auto &diagnostic : diagnostics) {
+                if (diagnostic.type == utils::ErrorType::ET_CriticalError) {
+                    failed = true;
+                }
+                if (!writeDiagnostic(fd, diagnosticKind(diagnostic.type), diagnostic.text)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint32_t limit(uint32_t requested, uint32_t fallback, uint32_t maximum) {
+            return std::min(requested ? requested : fallback, maximum);
+        }
+    } // namespace
+
+    Daemon::Watchdog::Watchdog()
+        : thread_(&Watchdog::loop, this) {}
+
+    Daemon::Watchdog::~Watchdog() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        changed_.notify_all();
+        thread_.join();
+    }
+
+    void Daemon::Watchdog::arm(Job &job, Clock::time_point deadline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job.slot = deadlines_.emplace(deadline, &job);
+            job.armed = true;
+        }
+        changed_.notify_one();
+    }
+
+    void Daemon::Watchdog::disarm(Job &job) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job.armed) {
+            deadlines_.erase(job.slot);
+            job.armed = false;
+        }
+    }
+
+    void Daemon::Watchdog::loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            if (deadlines_.empty()) {
+                changed_.wait(lock);
+                continue;
+            }
+            const auto now = Clock::now();
+            while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+                Job *job = deadlines_.begin()->second;
+                job->timedOut.store(true, std::memory_order_relaxed);
+                job->interrupt.store(true, std::memory_order_relaxed);
+                job->armed = false;
+                deadlines_.erase(deadlines_.begin());
+            }
+            if (!deadlines_.empty()) {
+                changed_.wait_until(lock, deadlines_.begin()->first);
+            }
+        }
+    }
+
+    Daemon::Daemon(DaemonOptions options)
+        : options_(std::move(options)), cache_(options_.cacheEntries), vms_(options_.workers), whitespaceEngines_(options_.workers),
+          befungeEngines_(options_.workers) {}
+
+    bool Daemon::serve() {
+        auto &handler = utils::ErrorHandler::getInstance();
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options_.socketPath.empty() || options_.socketPath.size() >= sizeof(address.sun_path)) {
+            handler.makeError(utils::StringBuilder::concatenate("[SVE01]: Invalid socket path: ", options_.socketPath), 0);
+            return false;
+        }
+        std::memcpy(address.sun_path, options_.socketPath.c_str(), options_.socketPath.size() + 1);
+
+        const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0) {
+            handler.makeError(utils::StringBuilder::concatenate("[SVE02]: Cannot create socket: ", std::strerror(errno)), 0);
+            return false;
+        }
+        // 上一次运行留下的套接字文件会让 bind 失败
+        ::unlink(options_.socketPath.c_str());
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listener, SOMAXCONN) < 0) {
+            handler.makeError(utils::StringBuilder::concatenate("[SVE02]: Cannot listen on ", options_.socketPath, ": ", std::strerror(errno)), 0);
+            ::close(listener);
+            return false;
+        }
+        listener_.store(listener);
+
+        {
+            // 会话结束后连接回到线程池，继续等待下一个请求
+            SessionLoop sessions([this](int fd, bool keep) {
+                if (keep) {
+                    workers_->submit([this, fd] { serveConnection(fd); });
+                } else {
+                    closeConnection(fd);
+                }
+            });
+            // 析构时等待所有连接处理完
+            WorkerPool pool(options_.workers);
+            workers_ = &pool;
+            sessions_ = &sessions;
+            for (;;) {
+                const int connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if (connection < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED) {
+                        continue;
+                    }
+                    // stop() 关闭了监听套接字
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(connectionsMutex_);
+                    connections_.insert(connection);
+                }
+                pool.submit([this, connection] { serveConnection(connection); });
+            }
+            // 先停掉事件循环，剩下的会话不会再把连接交回线程池；之后才交来的会话直接被关闭
+            sessions.stop();
+        }
+        workers_ = nullptr;
+        sessions_ = nullptr;
+
+        listener_.store(-1);
+        ::close(listener);
+        ::unlink(options_.socketPath.c_str());
+        return true;
+    }
+
+    void Daemon::stop() {
+        const int listener = listener_.load();
+        if (listener >= 0) {
+            ::shutdown(listener, SHUT_RDWR);
+        }
+        // 让等待下一个请求的连接立即结束
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        for (const int connection : connections_) {
+            ::shutdown(connection, SHUT_RD);
+        }
+    }
+
+    void Daemon::serveConnection(int fd) {
+        timeval idle{};
+        idle.tv_sec = static_cast<time_t>(options_.idleTimeoutMs / 1000);
+        idle.tv_usec = static_cast<suseconds_t>(options_.idleTimeoutMs % 1000 * 1000);
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+
+        std::vector<char> payload;
+        Request           request;
+        FrameType         type{};
+        while (readFrame(fd, type, payload, kRequestHeaderSize + static_cast<size_t>(options_.maxRequestBytes))) {
+            // 交互式会话结束前后才到的 Input 帧（比如迟到的输入结束标记）没有意义，直接忽略
+            if (type == FrameType::Input) {
+                continue;
+            }
+            if (type != FrameType::Request || !decodeRequest(payload, request)) {
+                writeDone(fd, Status::BadRequest, false, 0);
+                break;
+            }
+            if (request.interactive) {
+                bool handedOff = false;
+                if (!startSession(fd, request, handedOff)) {
+                    break;
+                }
+                if (handedOff) {
+                    return;
+                }
+                continue;
+            }
+            if (!execute(fd, request)) {
+                break;
+            }
+        }
+        closeConnection(fd);
+    }
+
+    void Daemon::closeConnection(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            connections_.erase(fd);
+        }
+        ::close(fd);
+    }
+
+    bool Daemon::execute(int fd, const Request &request) {
+        using Clock = Watchdog::Clock;
+        const auto start = Clock::now();
+        auto       elapsed = [&start] {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        };
+
+        bool       hit = false;
+        const auto program = cache_.get(request.language, request.program, hit);
+        bool       failed = false;
+        if (!sendDiagnostics(fd, program->diagnostics, failed)) {
+            return false;
+        }
+        if (!program->ok) {
+            return writeDone(fd, Status::Error, hit, elapsed());
+        }
+
+        Job        job;
+        OutputSink sink{fd, limit(request.maxOutput, options_.defaultMaxOutput, options_.maxOutput), 0, false, false, &job.interrupt};
+
+        auto &handler = utils::ErrorHandler::getInstance();
+        handler.clearErrors();
+        watchdog_.arm(job, start + std::chrono::milliseconds(limit(request.timeoutMs, options_.defaultTimeoutMs, options_.maxTimeoutMs)));
+        {
+            // 程序直接读请求里的输入，BufferedOutput 刷新一次就是一个 Output 帧
+            utils::BufferedInput  bufferedInput(request.input.data(), request.input.size());
+            utils::BufferedOutput bufferedOutput(writeOutput, &sink);
+            switch (request.language) {
+            case Language::Brainfuck: {
+                auto vm = vms_.acquire();
+                vm->setIO(bufferedInput, bufferedOutput);
+                vm->setInterrupt(&job.interrupt);
+                vm->run(*program->brainfuck);
+                break;
+            }
+            case Language::Whitespace: {
+                auto engine = whitespaceEngines_.acquire();
+                engine->setIO(bufferedInput, bufferedOutput);
+                engine->setInterrupt(&job.interrupt);
+                engine->run(*program->whitespace);
+                break;
+            }
+            case Language::Befunge: {
+                auto engine = befungeEngines_.acquire();
+                engine->setIO(bufferedInput, bufferedOutput);
+                engine->setInterrupt(&job.interrupt);
+                engine->run(*program->befunge);
+                break;
+            }
+            }
+        }
+        watchdog_.disarm(job);
+
+        const std::vector<utils::ErrorObj> diagnostics = handler.getErrors();
+        handler.clearErrors();
+        if (sink.broken || !sendDiagnostics(fd, diagnostics, failed)) {
+            return false;
+        }
+
+        Status status = Status::Ok;
+        if (job.timedOut.load(std::memory_order_relaxed)) {
+            status = Status::Timeout;
+        } else if (sink.exceeded) {
+            status = Status::OutputLimit;
+        } else if (failed) {
+            status = Status::Error;
+        }
+        return writeDone(fd, status, hit, elapsed());
+    }
+
+    bool Daemon::startSession(int fd, const Request &request, bool &handedOff) {
+        const auto start = SessionLoop::Clock::now();
+        auto       elapsed = [&start] {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(SessionLoop::Clock::now() - start).count());
+        };
+
+        bool       hit = false;
+        const auto program = cache_.get(request.language, request.program, hit);
+        bool       failed = false;
+        if (!sendDiagnostics(fd, program->diagnostics, failed)) {
+            return false;
+        }
+        if (!program->ok) {
+            return writeDone(fd, Status::Error, hit, elapsed());
+        }
+        const IR::Module *module = program->resumable();
+        if (!module) {
+            if (!writeDiagnostic(fd, 1, "[SVE04]: Interactive mode is not available for this program")) {
+                return false;
+            }
+            return writeDone(fd, Status::Error, hit, elapsed());
+        }
+
+        auto session = std::make_unique<SessionLoop::Session>(fd, program, vms_.acquire());
+        session->cacheHit = hit;
+        session->start = start;
+        session->timeout = std::chrono::milliseconds(limit(request.timeoutMs, options_.defaultTimeoutMs, options_.maxTimeoutMs));
+        session->maxOutput = limit(request.maxOutput, options_.defaultMaxOutput, options_.maxOutput);
+        session->maxInput = options_.maxRequestBytes;
+        session->idleTimeout = std::chrono::milliseconds(options_.idleTimeoutMs);
+        // 池里的 VM 可能还指着上一个非交互请求的中断标志，会话的超时由事件循环自己计算
+        IR::VM &vm = *session->vm;
+        vm.setInterrupt(nullptr);
+        vm.start(*module);
+        vm.feedInput(request.input.data(), request.input.size());
+
+        handedOff = true;
+        sessions_->add(std::move(session));
+        return true;
+    }
+} // namespace Rikkyu::Server
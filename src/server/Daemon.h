@@ -0,0 +1,115 @@
+#pragma once
+#ifndef RIK_SERVER_DAEMON
+#define RIK_SERVER_DAEMON
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "Protocol.h"
+#include "ProgramCache.h"
+#include "SessionLoop.h"
+#include "WorkerPool.h"
+#include "../befunge/Engine.h"
+#include "../ir/VM.h"
+#include "../utils/Pool/RunnerPool.h"
+#include "../whitespace/Engine.h"
+
+namespace Rikkyu::Server {
+    struct DaemonOptions {
+        std::string socketPath = "/tmp/rikkyu.sock";
+        size_t      workers = 4;
+        size_t      cacheEntries = 256;
+        uint32_t    defaultTimeoutMs = 1000;
+        uint32_t    maxTimeoutMs = 30000;
+        uint32_t    defaultMaxOutput = 1u << 20;
+        uint32_t    maxOutput = 64u << 20;
+        uint32_t    maxRequestBytes = 16u << 20; // 程序 + 输入
+        uint32_t    idleTimeoutMs = 10000;       // 连接在两个请求之间最多空闲多久
+    };
+
+    // 常驻的解释器服务。在 Unix 域套接字上接受连接，每个连接由工作线程池中的一个线程处理，
+    // 连接上的请求依次执行，输出按帧流式发回（协议见 Protocol.h）。
+    // 编译结果放在 LRU 缓存中，重复提交同一程序时跳过解析和编译；
+    // 执行器从池中借出，归还时只清理上一次运行碰过的状态。
+    // 超时和输出上限通过各个引擎的中断标志实现：引擎在跳转或轨迹边界检查标志后停止。
+    // 交互式请求编译好以后交给 SessionLoop，等待输入期间不占用工作线程，结束后连接再回到线程池。
+    class Daemon {
+    public:
+        explicit Daemon(DaemonOptions options);
+        ~Daemon() = default;
+
+        Daemon(const Daemon &) = delete;
+        Daemon &operator=(const Daemon &) = delete;
+
+        // 绑定套接字并在当前线程上接受连接，直到 stop() 被调用。无法监听时报告错误并返回 false
+        bool serve();
+
+        // 可以从其他线程调用（不能从信号处理函数里调用）。已经在执行的请求会执行完
+        void stop();
+
+        [[nodiscard]] ProgramCache::Statistics cacheStatistics() {
+            return cache_.statistics();
+        }
+
+    private:
+        // 一个正在执行的请求的中断状态
+        struct Job {
+            using Deadlines = std::multimap<std::chrono::steady_clock::time_point, Job *>;
+
+            std::atomic<bool>   interrupt{false};
+            std::atomic<bool>   timedOut{false};
+            bool                armed = false; // armed 和 slot 由 Watchdog 的互斥量保护
+            Deadlines::iterator slot;
+        };
+
+        // 一个后台线程，在请求到期时设置它的中断标志
+        class Watchdog {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            Watchdog();
+            ~Watchdog();
+
+            void arm(Job &job, Clock::time_point deadline);
+            void disarm(Job &job);
+
+        private:
+            void loop();
+
+            Job::Deadlines          deadlines_;
+            std::mutex              mutex_;
+            std::condition_variable changed_;
+            bool                    stopping_ = false;
+            std::thread             thread_;
+        };
+
+        void serveConnection(int fd);
+        void closeConnection(int fd);
+        // 执行一个请求并发回全部响应帧，连接不可用时返回 false
+        bool execute(int fd, const Request &request);
+        // 编译交互式请求并交给 sessions_，成功交出时 handedOff 为 true，此后连接归事件循环所有
+        bool startSession(int fd, const Request &request, bool &handedOff);
+
+        DaemonOptions                         options_;
+        ProgramCache                          cache_;
+        utils::RunnerPool<IR::VM>             vms_;
+        utils::RunnerPool<Whitespace::Engine> whitespaceEngines_;
+        utils::RunnerPool<Befunge::Engine>    befungeEngines_;
+        Watchdog                              watchdog_;
+        std::atomic<int>                      listener_{-1};
+        std::mutex                            connectionsMutex_;
+        std::set<int>                         connections_;
+        WorkerPool                           *workers_ = nullptr; // 只在 serve() 期间有效
+        SessionLoop                          *sessions_ = nullptr;
+    };
+} // namespace Rikkyu::Server
+
+#endif // RIK_SERVER_DAEMON
@@ -0,0 +1,104 @@
+#include "ProgramCache.h"
+
+#include "../brainfuck/ParallelLoader.h"
+#include "../ir/PassManager.h"
+#include "../whitespace/Compiler.h"
+#include "../whitespace/IRLowering.h"
+#include "../whitespace/interpreter.h"
+
+namespace Rikkyu::Server {
+    ProgramCache::ProgramCache(size_t capacity)
+        : capacity_(capacity ? capacity : 1) {}
+
+    std::shared_ptr<const CompiledProgram> ProgramCache::compile(Language language, const std::string &source) {
+        auto &handler = utils::ErrorHandler::getInstance();
+        handler.clearErrors();
+
+        auto program = std::make_shared<CompiledProgram>();
+        program->language = language;
+        std::vector<char> code(source.begin(), source.end());
+        switch (language) {
+        case Language::Brainfuck: {
+            // 小程序在 ParallelLoader 里直接串行处理
+            const Brainfuck::ParallelLoader loader;
+            auto                            expressions = loader.parse(code);
+            if (!handler.hasErrors()) {
+                program->brainfuck = std::make_unique<IR::Module>(loader.lower(expressions));
+            }
+            break;
+        }
+        case Language::Whitespace: {
+            Whitespace::Parser parser;
+            auto               expressions = parser.parse(code);
+            if (!handler.hasErrors()) {
+                program->whitespace = std::make_unique<Whitespace::Program>(Whitespace::Compiler().compile(expressions, parser.labels()));
+            }
+            break;
+        }
+        case Language::Befunge:
+            program->befunge = std::make_unique<Befunge::Playfield>(Befunge::Playfield::load(source.data(), source.size()));
+            break;
+        }
+
+        program->ok = true;
+        for (const auto &error : handler.getErrors()) {
+            if (error.type == utils::ErrorType::ET_CriticalError) {
+                program->ok = false;
+            }
+        }
+        program->diagnostics = handler.getErrors();
+        handler.clearErrors();
+
+        // IR 版本只是交互式执行的附加品，降低失败的诊断不属于这个程序
+        if (program->ok && program->whitespace) {
+            auto module = std::make_unique<IR::Module>();
+            if (Whitespace::IRLowering().lower(*program->whitespace, *module)) {
+                IR::PassManager::standard().run(*module);
+                program->whitespaceModule = std::move(module);
+            }
+            handler.clearErrors();
+        }
+        return program;
+    }
+
+    std::shared_ptr<const CompiledProgram> ProgramCache::get(Language language, const std::string &source, bool &hit) {
+        std::string key;
+        key.reserve(source.size() + 1);
+        key.push_back(static_cast<char>(language));
+        key += source;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto                        found = index_.find(key);
+            if (found != index_.end()) {
+                entries_.splice(entries_.begin(), entries_, found->second);
+                ++statistics_.hits;
+                hit = true;
+                return found->second->second;
+            }
+            ++statistics_.misses;
+        }
+
+        hit = false;
+        auto program = compile(language, source);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto                        found = index_.find(key);
+        if (found != index_.end()) {
+            return found->second->second;
+        }
+        entries_.emplace_front(std::move(key), program);
+        index_.emplace(entries_.front().first, entries_.begin());
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            ++statistics_.evictions;
+        }
+        return program;
+    }
+
+    ProgramCache::Statistics ProgramCache::statistics() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+} // namespace Rikkyu::Server
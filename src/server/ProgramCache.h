@@ -0,0 +1,77 @@
+#pragma once
+#ifndef RIK_SERVER_PROGRAM_CACHE
+#define RIK_SERVER_PROGRAM_CACHE
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Protocol.h"
+#include "../befunge/Playfield.h"
+#include "../ir/IR.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../whitespace/Bytecode.h"
+
+namespace Rikkyu::Server {
+    // 编译好、可以在多个线程里同时执行的程序。创建后只读。
+    //   - Brainfuck：经过标准 pass 优化的 IR 模块，由 IR::VM 执行；
+    //   - Whitespace：字节码，由 Whitespace::Engine 执行；另外尝试降低为 IR，供交互式请求在可恢复的 IR::VM 上执行，
+    //     含有超出 64 位的字面量时没有 IR 版本；
+    //   - Befunge：初始网格，Engine 在它的副本上执行。
+    // 编译失败的程序也会被缓存（ok 为 false），重复提交时直接回放诊断信息。
+    struct CompiledProgram {
+        Language                             language = Language::Brainfuck;
+        bool                                 ok = false;
+        std::vector<utils::ErrorObj>         diagnostics;
+        std::unique_ptr<IR::Module>          brainfuck;
+        std::unique_ptr<Whitespace::Program> whitespace;
+        std::unique_ptr<IR::Module>          whitespaceModule;
+        std::unique_ptr<Befunge::Playfield>  befunge;
+
+        // 交互式请求使用的可恢复模块，不支持时为 nullptr
+        [[nodiscard]] const IR::Module *resumable() const {
+            return language == Language::Brainfuck ? brainfuck.get() : whitespaceModule.get();
+        }
+    };
+
+    // 以 (语言, 源码) 为键的线程安全 LRU 缓存
+    class ProgramCache {
+    public:
+        struct Statistics {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+        };
+
+        explicit ProgramCache(size_t capacity);
+        ~ProgramCache() = default;
+
+        ProgramCache(const ProgramCache &) = delete;
+        ProgramCache &operator=(const ProgramCache &) = delete;
+
+        // 命中时 hit 为 true。编译在锁外进行，同一程序被并发提交时可能编译两次，先插入的那份生效
+        std::shared_ptr<const CompiledProgram> get(Language language, const std::string &source, bool &hit);
+
+        [[nodiscard]] Statistics statistics();
+
+        // 在当前线程上编译，诊断信息从当前线程的 ErrorHandler 收集
+        static std::shared_ptr<const CompiledProgram> compile(Language language, const std::string &source);
+
+    private:
+        using Entry = std::pair<std::string, std::shared_ptr<const CompiledProgram>>;
+
+        size_t                                                           capacity_;
+        std::mutex                                                       mutex_;
+        std::list<Entry>                                                 entries_; // 最近使用的在前面
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;   // 键指向 entries_ 里的字符串
+        Statistics                                                       statistics_;
+    };
+} // namespace Rikkyu::Server
+
+#endif // RIK_SERVER_PROGRAM_CACHE
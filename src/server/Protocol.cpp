@@ -0,0 +1,162 @@
+#include "Protocol.h"
+
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Rikkyu::Server {
+    namespace {
+        uint32_t loadU32(const char *data) {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+            return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16 |
+                   static_cast<uint32_t>(bytes[3]) << 24;
+        }
+
+        void storeU32(char *data, uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                data[i] = static_cast<char>(value >> (8 * i));
+            }
+        }
+    } // namespace
+
+    bool readFully(int fd, void *data, size_t size) {
+        auto *cursor = static_cast<char *>(data);
+        while (size) {
+            const ssize_t n = ::read(fd, cursor, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            cursor += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool writeFully(int fd, const void *data, size_t size) {
+        const auto *cursor = static_cast<const char *>(data);
+        while (size) {
+            // 对端提前断开时不能让 SIGPIPE 杀掉整个守护进程
+            const ssize_t n = ::send(fd, cursor, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            cursor += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readFrame(int fd, FrameType &type, std::vector<char> &payload, size_t maxPayload) {
+        char header[kFrameHeaderSize];
+        if (!readFully(fd, header, sizeof(header))) {
+            return false;
+        }
+        const uint32_t size = loadU32(header);
+        if (size > maxPayload) {
+            return false;
+        }
+        type = static_cast<FrameType>(header[4]);
+        payload.resize(size);
+        return readFully(fd, payload.data(), size);
+    }
+
+    bool writeFrame(int fd, FrameType type, const void *payload, size_t size) {
+        char header[kFrameHeaderSize];
+        storeU32(header, static_cast<uint32_t>(size));
+        header[4] = static_cast<char>(type);
+        return writeFully(fd, header, sizeof(header)) && writeFully(fd, payload, size);
+    }
+
+    bool decodeRequest(const std::vector<char> &payload, Request &request) {
+        if (payload.size() < kRequestHeaderSize) {
+            return false;
+        }
+        const char *data = payload.data();
+        const auto  language = static_cast<uint8_t>(data[0]);
+        if (language < static_cast<uint8_t>(Language::Brainfuck) || language > static_cast<uint8_t>(Language::Befunge)) {
+            return false;
+        }
+        const uint64_t programSize = loadU32(data + 12);
+        const uint64_t inputSize = loadU32(data + 16);
+        if (kRequestHeaderSize + programSize + inputSize != payload.size()) {
+            return false;
+        }
+
+        request.language = static_cast<Language>(language);
+        request.interactive = (static_cast<uint8_t>(data[1]) & kInteractive) != 0;
+        request.timeoutMs = loadU32(data + 4);
+        request.maxOutput = loadU32(data + 8);
+        request.program.assign(data + kRequestHeaderSize, programSize);
+        request.input.assign(data + kRequestHeaderSize + programSize, inputSize);
+        return true;
+    }
+
+    uint8_t diagnosticKind(utils::ErrorType type) {
+        switch (type) {
+        case utils::ErrorType::ET_Notice:
+            return 0;
+        case utils::ErrorType::ET_CriticalError:
+            return 1;
+        default:
+            return 2;
+        }
+    }
+
+    bool writeDiagnostic(int fd, uint8_t kind, const std::string &text) {
+        std::string frame;
+        appendDiagnostic(frame, kind, text);
+        return writeFully(fd, frame.data(), frame.size());
+    }
+
+    bool writeDone(int fd, Status status, bool cacheHit, uint64_t microseconds) {
+        std::string frame;
+        appendDone(frame, status, cacheHit, microseconds);
+        return writeFully(fd, frame.data(), frame.size());
+    }
+
+    void appendFrame(std::string &out, FrameType type, const void *payload, size_t size) {
+        char header[kFrameHeaderSize];
+        storeU32(header, static_cast<uint32_t>(size));
+        header[4] = static_cast<char>(type);
+        out.append(header, sizeof(header));
+        out.append(static_cast<const char *>(payload), size);
+    }
+
+    void appendDiagnostic(std::string &out, uint8_t kind, const std::string &text) {
+        char header[kFrameHeaderSize + 1];
+        storeU32(header, static_cast<uint32_t>(text.size() + 1));
+        header[4] = static_cast<char>(FrameType::Diagnostic);
+        header[5] = static_cast<char>(kind);
+        out.append(header, sizeof(header));
+        out += text;
+    }
+
+    void appendDone(std::string &out, Status status, bool cacheHit, uint64_t microseconds) {
+        char payload[12] = {static_cast<char>(status), static_cast<char>(cacheHit ? 1 : 0), 0, 0};
+        for (int i = 0; i < 8; ++i) {
+            payload[4 + i] = static_cast<char>(microseconds >> (8 * i));
+        }
+        appendFrame(out, FrameType::Done, payload, sizeof(payload));
+    }
+
+    bool parseFrame(const std::string &buffer, size_t offset, FrameType &type, size_t &payloadSize, size_t maxPayload, bool &oversized) {
+        oversized = false;
+        if (buffer.size() - offset < kFrameHeaderSize) {
+            return false;
+        }
+        payloadSize = loadU32(buffer.data() + offset);
+        if (payloadSize > maxPayload) {
+            oversized = true;
+            return false;
+        }
+        type = static_cast<FrameType>(buffer[offset + 4]);
+        return buffer.size() - offset - kFrameHeaderSize >= payloadSize;
+    }
+} // namespace Rikkyu::Server
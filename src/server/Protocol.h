@@ -0,0 +1,85 @@
+#pragma once
+#ifndef RIK_SERVER_PROTOCOL
+#define RIK_SERVER_PROTOCOL
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::Server {
+    // 守护进程的线路协议。每一帧是
+    //   u32 载荷长度（小端，不含帧头） | u8 帧类型 | 载荷
+    // 客户端发送 Request 帧，服务端按顺序回复若干 Output / Diagnostic 帧，最后以一个 Done 帧结束。
+    // 同一个连接上可以依次发送多个请求。
+    //
+    // 交互式请求（标志 kInteractive）的输入不必一次给全：Request 里的输入只是开头，之后客户端可以随时发送 Input 帧，
+    // 空的 Input 帧表示输入结束。程序读完已有的输入时挂起等待，而不是占着一个线程阻塞；
+    // 这种请求的超时只计算实际执行的时间，等待输入的时间受空闲超时限制。
+    enum class FrameType : uint8_t {
+        // u8 语言 | u8 标志 | u16 保留 | u32 超时毫秒 | u32 输出上限字节 | u32 程序长度 | u32 输入长度 | 程序 | 输入
+        // 超时和输出上限为 0 时使用服务端默认值，并且都不能超过服务端的上限
+        Request = 'R',
+        Input = 'I',      // 交互式请求的后续输入，空载荷表示输入结束
+        Output = 'O',     // 程序输出的一段原始字节
+        Diagnostic = 'E', // u8 种类（0 提示，1 错误，2 警告） | 文本
+        Done = 'D'        // u8 状态 | u8 是否命中缓存 | u16 保留 | u64 耗时微秒（编译 + 执行）
+    };
+
+    enum class Language : uint8_t {
+        Brainfuck = 1,
+        Whitespace = 2,
+        Befunge = 3
+    };
+
+    enum class Status : uint8_t {
+        Ok = 0,
+        Error = 1,       // 编译或运行时错误，详情在 Diagnostic 帧里
+        Timeout = 2,     // 超过时间限制被中断
+        OutputLimit = 3, // 输出超过上限被中断，之前的输出已经发出
+        BadRequest = 4   // 请求格式错误，服务端随后关闭连接
+    };
+
+    static constexpr uint8_t kInteractive = 1;
+
+    struct Request {
+        Language    language = Language::Brainfuck;
+        bool        interactive = false;
+        uint32_t    timeoutMs = 0;
+        uint32_t    maxOutput = 0;
+        std::string program;
+        std::string input;
+    };
+
+    static constexpr size_t kFrameHeaderSize = 5;
+    static constexpr size_t kRequestHeaderSize = 20;
+
+    // 阻塞地读满 / 写完，自动处理 EINTR；对端关闭或出错时返回 false
+    bool readFully(int fd, void *data, size_t size);
+    bool writeFully(int fd, const void *data, size_t size);
+
+    // 读取一帧。载荷超过 maxPayload 时返回 false，不会读取载荷
+    bool readFrame(int fd, FrameType &type, std::vector<char> &payload, size_t maxPayload);
+    bool writeFrame(int fd, FrameType type, const void *payload, size_t size);
+
+    // 解析 Request 帧的载荷，格式错误时返回 false
+    bool decodeRequest(const std::vector<char> &payload, Request &request);
+
+    // Diagnostic 帧里的种类编号
+    uint8_t diagnosticKind(utils::ErrorType type);
+
+    bool writeDiagnostic(int fd, uint8_t kind, const std::string &text);
+    bool writeDone(int fd, Status status, bool cacheHit, uint64_t microseconds);
+
+    // 把帧追加到 out 末尾，供非阻塞发送的调用者自己缓冲
+    void appendFrame(std::string &out, FrameType type, const void *payload, size_t size);
+    void appendDiagnostic(std::string &out, uint8_t kind, const std::string &text);
+    void appendDone(std::string &out, Status status, bool cacheHit, uint64_t microseconds);
+
+    // 从缓冲区开头解析一帧。数据还不完整时返回 false；载荷超过 maxPayload 时 oversized 为 true
+    bool parseFrame(const std::string &buffer, size_t offset, FrameType &type, size_t &payloadSize, size_t maxPayload, bool &oversized);
+} // namespace Rikkyu::Server
+
+#endif // RIK_SERVER_PROTOCOL
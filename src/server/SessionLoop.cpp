@@ -0,0 +1,371 @@
+#include "SessionLoop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::Server {
+    namespace {
+        bool setNonBlocking(int fd, bool enabled) {
+            const int flags = ::fcntl(fd, F_GETFL);
+            if (flags < 0) {
+                return false;
+            }
+            return ::fcntl(fd, F_SETFL, enabled ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) == 0;
+        }
+    } // namespace
+
+    SessionLoop::SessionLoop(Finished finished)
+        : finished_(std::move(finished)), epoll_(::epoll_create1(EPOLL_CLOEXEC)), wake_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = wake_;
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+        thread_ = std::thread(&SessionLoop::loop, this);
+    }
+
+    SessionLoop::~SessionLoop() {
+        stop();
+        ::close(wake_);
+        ::close(epoll_);
+    }
+
+    void SessionLoop::add(std::unique_ptr<Session> session) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stopping_) {
+                incoming_.push_back(std::move(session));
+            }
+        }
+        if (session) {
+            const int fd = session->fd;
+            session.reset();
+            finished_(fd, false);
+            return;
+        }
+        const uint64_t one = 1;
+        ::write(wake_, &one, sizeof(one));
+    }
+
+    void SessionLoop::stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        const uint64_t one = 1;
+        ::write(wake_, &one, sizeof(one));
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void SessionLoop::loop() {
+        std::vector<epoll_event> events(64);
+        bool                     stopping = false;
+        while (!stopping) {
+            // 有会话可以执行时只轮询，否则睡到最近的空闲期限
+            int  timeout = -1;
+            auto now = Clock::now();
+            for (const auto &[fd, state] : sessions_) {
+                if (state.runnable()) {
+                    timeout = 0;
+                    break;
+                }
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(state.idleSince + state.idleTimeout - now).count() + 1;
+                const int  wait = static_cast<int>(std::clamp<decltype(left)>(left, 0, 60000));
+                timeout = timeout < 0 ? wait : std::min(timeout, wait);
+            }
+
+            const int count = ::epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), timeout);
+            if (count < 0 && errno != EINTR) {
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == wake_) {
+                    uint64_t value;
+                    ::read(wake_, &value, sizeof(value));
+                    std::vector<std::unique_ptr<Session>> incoming;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        incoming.swap(incoming_);
+                        stopping = stopping_;
+                    }
+                    for (auto &session : incoming) {
+                        attach(std::move(session));
+                    }
+                    continue;
+                }
+                auto found = sessions_.find(fd);
+                if (found == sessions_.end()) {
+                    continue;
+                }
+                State         &state = found->second;
+                const uint32_t ready = events[i].events;
+                if (!state.session) {
+                    // 空闲连接上的新请求，或者对端断开，都交给调用者的阻塞读取去处理
+                    state.handBack = true;
+                    continue;
+                }
+                if (ready & EPOLLERR) {
+                    abort(state);
+                    continue;
+                }
+                if (ready & EPOLLIN) {
+                    receive(state);
+                } else if ((ready & EPOLLHUP) && !state.done) {
+                    // 不再关注可读时，连接彻底断开只能从 EPOLLHUP 得知
+                    abort(state);
+                }
+                if (ready & EPOLLOUT) {
+                    send(state);
+                }
+            }
+
+            now = Clock::now();
+            for (auto &[fd, state] : sessions_) {
+                if (state.runnable()) {
+                    step(state);
+                    send(state);
+                } else if (now - state.idleSince >= state.idleTimeout) {
+                    // 客户端太久不给输入或不收输出。连 Done 帧都发不出去时只能断开
+                    if (!state.session) {
+                        state.keep = false;
+                        state.handBack = true;
+                    } else if (state.done) {
+                        abort(state);
+                    } else {
+                        finish(state, Status::Timeout);
+                        state.idleSince = now;
+                    }
+                }
+            }
+
+            for (auto it = sessions_.begin(); it != sessions_.end();) {
+                State &state = it->second;
+                if (state.session && state.done && state.out.empty() && state.keep) {
+                    park(state);
+                }
+                if (state.handBack || (state.done && state.out.empty() && !state.keep)) {
+                    release(state);
+                    it = sessions_.erase(it);
+                } else {
+                    watch(state);
+                    ++it;
+                }
+            }
+        }
+
+        for (auto &[fd, state] : sessions_) {
+            abort(state);
+            release(state);
+        }
+        sessions_.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &session : incoming_) {
+            const int fd = session->fd;
+            session.reset();
+            finished_(fd, false);
+        }
+        incoming_.clear();
+    }
+
+    void SessionLoop::attach(std::unique_ptr<Session> session) {
+        const int fd = session->fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (!setNonBlocking(fd, true) || ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            session.reset();
+            finished_(fd, false);
+            return;
+        }
+        State &state = sessions_[fd];
+        state.fd = fd;
+        state.idleTimeout = session->idleTimeout;
+        state.session = std::move(session);
+        state.failed = false;
+        state.idleSince = Clock::now();
+        state.events = EPOLLIN;
+    }
+
+    void SessionLoop::receive(State &state) {
+        // 已经结束的会话不再读取，后面的数据属于下一个请求
+        if (state.done) {
+            return;
+        }
+        // 每次最多读一块，水平触发的 epoll 会在下一轮继续报告可读，积压的输入因此有上限
+        char          buffer[1 << 16];
+        const ssize_t n = ::recv(state.fd, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                abort(state);
+            }
+            return;
+        }
+        if (n == 0) {
+            // 客户端半关闭了写方向：输入到此为止，程序照常跑完，但连接不能再用于下一个请求
+            state.eof = true;
+            state.keep = false;
+            state.session->vm->closeInput();
+            state.waiting = false;
+            return;
+        }
+        state.idleSince = Clock::now();
+        state.in.append(buffer, static_cast<size_t>(n));
+
+        IR::VM &vm = *state.session->vm;
+        size_t  offset = 0;
+        while (!state.done) {
+            FrameType type{};
+            size_t    size = 0;
+            bool      oversized = false;
+            if (!parseFrame(state.in, offset, type, size, state.session->maxInput, oversized)) {
+                if (oversized) {
+                    state.keep = false;
+                    finish(state, Status::BadRequest);
+                }
+                break;
+            }
+            if (type != FrameType::Input) {
+                state.keep = false;
+                finish(state, Status::BadRequest);
+                break;
+            }
+            if (size == 0) {
+                vm.closeInput();
+            } else {
+                vm.feedInput(state.in.data() + offset + kFrameHeaderSize, size);
+            }
+            state.waiting = false;
+            offset += kFrameHeaderSize + size;
+        }
+        state.in.erase(0, offset);
+    }
+
+    void SessionLoop::send(State &state) {
+        size_t sent = 0;
+        while (sent < state.out.size()) {
+            const ssize_t n = ::send(state.fd, state.out.data() + sent, state.out.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    abort(state);
+                    return;
+                }
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        if (sent) {
+            state.out.erase(0, sent);
+            state.idleSince = Clock::now();
+        }
+    }
+
+    void SessionLoop::step(State &state) {
+        IR::VM    &vm = *state.session->vm;
+        const auto begin = Clock::now();
+        const auto status = vm.resume(kSlice);
+        const auto end = Clock::now();
+        state.used += end - begin;
+
+        const std::string &output = vm.output();
+        bool               exceeded = false;
+        if (!output.empty()) {
+            const size_t allowed = std::min(output.size(), state.session->maxOutput - state.written);
+            if (allowed) {
+                appendFrame(state.out, FrameType::Output, output.data(), allowed);
+            }
+            state.written += allowed;
+            exceeded = allowed < output.size();
+            vm.clearOutput();
+        }
+
+        // 指针越界之类不停止执行的诊断随时可能出现。这个线程轮流推进许多会话，每一段执行之后马上取走，
+        // 不能留在 ErrorHandler 里被别的会话拿去
+        auto &handler = utils::ErrorHandler::getInstance();
+        for (const auto &diagnostic : handler.getErrors()) {
+            state.failed = state.failed || diagnostic.type == utils::ErrorType::ET_CriticalError;
+            appendDiagnostic(state.out, diagnosticKind(diagnostic.type), diagnostic.text);
+        }
+        handler.clearErrors();
+        if (exceeded) {
+            finish(state, Status::OutputLimit);
+            return;
+        }
+
+        switch (status) {
+        case IR::VM::Status::Finished:
+        case IR::VM::Status::Failed:
+            finish(state, status == IR::VM::Status::Failed || state.failed ? Status::Error : Status::Ok);
+            return;
+        case IR::VM::Status::NeedInput:
+            state.waiting = true;
+            state.idleSince = end;
+            break;
+        default:
+            break;
+        }
+        if (state.used >= state.session->timeout) {
+            finish(state, Status::Timeout);
+        }
+    }
+
+    void SessionLoop::finish(State &state, Status status) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - state.session->start).count();
+        appendDone(state.out, status, state.session->cacheHit, static_cast<uint64_t>(elapsed));
+        state.done = true;
+        state.waiting = false;
+    }
+
+    void SessionLoop::abort(State &state) {
+        state.out.clear();
+        state.done = true;
+        state.keep = false;
+    }
+
+    void SessionLoop::park(State &state) {
+        // 归还 VM 和程序，只留下连接本身等待下一个请求
+        state.session.reset();
+        state.in.clear();
+        state.idleSince = Clock::now();
+    }
+
+    void SessionLoop::watch(State &state) {
+        uint32_t events = 0;
+        if (!state.session) {
+            events = EPOLLIN;
+        } else if (!state.done && !state.eof && state.session->vm->bufferedInput() < state.session->maxInput) {
+            events |= EPOLLIN;
+        }
+        if (!state.out.empty()) {
+            events |= EPOLLOUT;
+        }
+        if (events != state.events) {
+            epoll_event event{};
+            event.events = events;
+            event.data.fd = state.fd;
+            ::epoll_ctl(epoll_, EPOLL_CTL_MOD, state.fd, &event);
+            state.events = events;
+        }
+    }
+
+    void SessionLoop::release(State &state) {
+        ::epoll_ctl(epoll_, EPOLL_CTL_DEL, state.fd, nullptr);
+        const bool keep = state.keep && setNonBlocking(state.fd, false);
+        // 先归还 VM 和程序，再把连接交回去
+        state.session.reset();
+        finished_(state.fd, keep);
+    }
+} // namespace Rikkyu::Server
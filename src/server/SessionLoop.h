@@ -0,0 +1,109 @@
+#pragma once
+#ifndef RIK_SERVER_SESSION_LOOP
+#define RIK_SERVER_SESSION_LOOP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Protocol.h"
+#include "ProgramCache.h"
+#include "../ir/VM.h"
+#include "../utils/Pool/RunnerPool.h"
+
+namespace Rikkyu::Server {
+    // 交互式请求的事件循环。一个线程用 epoll 同时照看所有交互式会话：
+    // 套接字可读时把 Input 帧喂给会话的 VM，可写时发出积压的输出，
+    // 有事可做的会话轮流执行一小段（kSlice 次控制流转移），等待输入的会话不占用任何线程。
+    // 会话结束后连接先留在 epoll 里，等客户端发来下一个请求时才交还给调用者，空闲的连接同样不占线程。
+    class SessionLoop {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // 连接交还时调用：keep 为 true 时连接上已经有下一个请求可读（已经恢复为阻塞模式），否则调用者负责关闭 fd
+        using Finished = std::function<void(int fd, bool keep)>;
+
+        // 一个已经 start() 好的交互式请求
+        struct Session {
+            Session(int fd, std::shared_ptr<const CompiledProgram> program, utils::RunnerPool<IR::VM>::Lease vm)
+                : fd(fd), program(std::move(program)), vm(std::move(vm)) {}
+
+            int                                    fd;
+            std::shared_ptr<const CompiledProgram> program; // 保证模块在执行期间有效
+            utils::RunnerPool<IR::VM>::Lease       vm;
+            bool                                   cacheHit = false;
+            Clock::time_point                      start;
+            Clock::duration                        timeout{}; // 只计算执行时间
+            size_t                                 maxOutput = 0;
+            size_t                                 maxInput = 0; // 单个 Input 帧的上限，也是未读输入的积压上限
+            Clock::duration                        idleTimeout{};
+        };
+
+        static constexpr size_t kSlice = size_t(1) << 16;
+        static constexpr size_t kHighWater = size_t(1) << 18; // 待发送的数据超过这么多时暂停执行
+
+        explicit SessionLoop(Finished finished);
+        ~SessionLoop();
+
+        SessionLoop(const SessionLoop &) = delete;
+        SessionLoop &operator=(const SessionLoop &) = delete;
+
+        // 可以从任意线程调用。stop() 之后加入的会话直接以 keep = false 结束
+        void add(std::unique_ptr<Session> session);
+
+        // 中止所有会话并等待事件循环线程退出
+        void stop();
+
+    private:
+        struct State {
+            int                      fd = -1;
+            std::unique_ptr<Session> session; // 会话结束、连接空闲时为 nullptr
+            Clock::duration          idleTimeout{};
+            std::string              in;  // 收到但还没有解析的数据
+            std::string              out; // 还没有发出去的帧
+            size_t                   written = 0;
+            Clock::duration          used{};
+            Clock::time_point        idleSince;
+            uint32_t                 events = 0;       // 当前在 epoll 里关注的事件
+            bool                     waiting = false;  // VM 在等输入
+            bool                     eof = false;      // 对端不会再发数据
+            bool                     done = false;     // Done 帧已经入队，发完就结束
+            bool                     keep = true;      // 结束后连接还能继续处理请求
+            bool                     handBack = false; // 空闲的连接上来了新数据
+            bool                     failed = false;   // 已经发出过错误诊断
+
+            [[nodiscard]] bool runnable() const {
+                return !waiting && !done && out.size() < kHighWater;
+            }
+        };
+
+        void loop();
+        void attach(std::unique_ptr<Session> session);
+        void receive(State &state);
+        void send(State &state);
+        void step(State &state);
+        void finish(State &state, Status status);
+        void abort(State &state);
+        void park(State &state);
+        void watch(State &state);
+        void release(State &state);
+
+        Finished                              finished_;
+        int                                   epoll_ = -1;
+        int                                   wake_ = -1;
+        std::mutex                            mutex_;
+        std::vector<std::unique_ptr<Session>> incoming_;
+        bool                                  stopping_ = false;
+        std::unordered_map<int, State>        sessions_;
+        std::thread                           thread_;
+    };
+} // namespace Rikkyu::Server
+
+#endif // RIK_SERVER_SESSION_LOOP
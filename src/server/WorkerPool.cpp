@@ -0,0 +1,50 @@
+#include "WorkerPool.h"
+
+#include <utility>
+
+namespace Rikkyu::Server {
+    WorkerPool::WorkerPool(size_t workers) {
+        if (workers == 0) {
+            workers = 1;
+        }
+        threads_.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            threads_.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::submit(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        ready_.notify_one();
+    }
+
+    void WorkerPool::work() {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+} // namespace Rikkyu::Server
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef RIK_SERVER_WORKER_POOL
+#define RIK_SERVER_WORKER_POOL
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Rikkyu::Server {
+    // 固定数量的工作线程和一个先进先出的任务队列
+    class WorkerPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit WorkerPool(size_t workers);
+        // 等待已经入队的任务全部执行完
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        void submit(Task task);
+
+        [[nodiscard]] size_t size() const {
+            return threads_.size();
+        }
+
+    private:
+        void work();
+
+        std::vector<std::thread> threads_;
+        std::deque<Task>         tasks_;
+        std::mutex               mutex_;
+        std::condition_variable  ready_;
+        bool                     stopping_ = false;
+    };
+} // namespace Rikkyu::Server
+
+#endif // RIK_SERVER_WORKER_POOL
@@ -0,0 +1,152 @@
+#include "BufferedIO.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Rikkyu::utils {
+    BufferedOutput::BufferedOutput(std::FILE *file)
+        : file_(file), owned_(new char[kBufferSize]), buffer_(owned_.get()), capacity_(kBufferSize) {}
+
+    BufferedOutput::BufferedOutput(WriteCallback callback, void *context)
+        : callback_(callback), context_(context), owned_(new char[kBufferSize]), buffer_(owned_.get()), capacity_(kBufferSize) {}
+
+    BufferedOutput::BufferedOutput(char *data, size_t capacity)
+        : buffer_(data), capacity_(capacity), span_(true) {}
+
+    BufferedOutput::~BufferedOutput() {
+        flush();
+    }
+
+    BufferedOutput &BufferedOutput::standardOutput() {
+        static BufferedOutput instance(stdout);
+        return instance;
+    }
+
+    void BufferedOutput::write(const char *data, size_t size) {
+        if (size > capacity_ - size_ && !span_) {
+            flush();
+            // 大块数据直接写出，不经过缓冲区
+            if (size >= capacity_) {
+                emit(data, size);
+                return;
+            }
+        }
+        while (size) {
+            if (size_ == capacity_) {
+                makeRoom();
+            }
+            const size_t count = std::min(size, capacity_ - size_);
+            std::memcpy(buffer_ + size_, data, count);
+            size_ += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    void BufferedOutput::flush() {
+        if (span_) {
+            // 调用者的内存里已经是最终结果；丢弃模式下清空暂存区
+            if (truncated_) {
+                size_ = 0;
+            }
+            return;
+        }
+        if (size_) {
+            emit(buffer_, size_);
+            size_ = 0;
+        }
+        if (file_) {
+            std::fflush(file_);
+        }
+    }
+
+    void BufferedOutput::makeRoom() {
+        if (span_ && !truncated_) {
+            truncated_ = true;
+            spanSize_ = size_;
+            owned_.reset(new char[kBufferSize]);
+            buffer_ = owned_.get();
+            capacity_ = kBufferSize;
+        }
+        if (span_) {
+            size_ = 0;
+            return;
+        }
+        flush();
+    }
+
+    void BufferedOutput::emit(const char *data, size_t size) {
+        if (file_) {
+            std::fwrite(data, 1, size, file_);
+        } else if (callback_) {
+            callback_(context_, data, size);
+        }
+    }
+
+    BufferedInput::BufferedInput(std::FILE *file)
+        : file_(file), owned_(new char[kBufferSize]), buffer_(owned_.get()) {}
+
+    BufferedInput::BufferedInput(const char *data, size_t size)
+        : buffer_(data), size_(size) {}
+
+    BufferedInput::BufferedInput(ReadCallback callback, void *context)
+        : callback_(callback), context_(context) {}
+
+    BufferedInput &BufferedInput::standardInput() {
+        static BufferedInput instance(stdin);
+        instance.tie(&BufferedOutput::standardOutput());
+        return instance;
+    }
+
+    bool BufferedInput::refill() {
+        if (tied_) {
+            tied_->flush();
+        }
+        position_ = 0;
+        if (file_) {
+            size_ = std::fread(owned_.get(), 1, kBufferSize, file_);
+        } else if (callback_) {
+            size_ = callback_(context_, &buffer_);
+        } else {
+            size_ = 0;
+        }
+        return size_ > 0;
+    }
+
+    bool BufferedInput::readToken(std::string &token) {
+        token.clear();
+        int c = get();
+        while (c != EOF && isSpace(c)) {
+            c = get();
+        }
+        while (c != EOF && !isSpace(c)) {
+            token.push_back(static_cast<char>(c));
+            c = get();
+        }
+        return !token.empty();
+    }
+
+    BufferedInput::NumberStatus BufferedInput::readInteger(int64_t &value, std::string &token) {
+        if (!readToken(token)) {
+            return NumberStatus::EndOfFile;
+        }
+        return parseInteger(token, value);
+    }
+
+    BufferedInput::NumberStatus BufferedInput::parseInteger(const std::string &token, int64_t &value) {
+        if (token.empty()) {
+            return NumberStatus::Invalid;
+        }
+        // from_chars 不接受前导 '+'
+        const char *begin = token.data() + (token[0] == '+' ? 1 : 0);
+        const char *end = token.data() + token.size();
+        auto [ptr, error] = std::from_chars(begin, end, value);
+        if (ptr != end) {
+            return NumberStatus::Invalid;
+        }
+        if (error == std::errc::result_out_of_range) {
+            return NumberStatus::Overflow;
+        }
+        return error == std::errc() ? NumberStatus::Ok : NumberStatus::Invalid;
+    }
+} // namespace Rikkyu::utils
@@ -0,0 +1,158 @@
+#pragma once
+#ifndef RIK_BUFFERED_IO_H
+#define RIK_BUFFERED_IO_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::utils {
+    // 带大缓冲区的输出，直接用 fwrite 写到 FILE*，不经过 iostream，也不受 sync_with_stdio 影响。
+    // 析构时自动刷新。
+    // 嵌入使用时可以不经过 FILE*：
+    //   - 回调：每次刷新把内部缓冲区的一段直接交给回调，不做额外复制；
+    //   - 调用者的内存：直接写进调用者提供的缓冲区，写满以后的输出被丢弃，truncated() 为 true。
+    class BufferedOutput {
+    public:
+        static constexpr size_t kBufferSize = size_t(1) << 16;
+
+        // data 只在回调期间有效
+        using WriteCallback = void (*)(void *context, const char *data, size_t size);
+
+        explicit BufferedOutput(std::FILE *file);
+        BufferedOutput(WriteCallback callback, void *context);
+        BufferedOutput(char *data, size_t capacity);
+        ~BufferedOutput();
+
+        BufferedOutput(const BufferedOutput &) = delete;
+        BufferedOutput &operator=(const BufferedOutput &) = delete;
+
+        // 进程共享的标准输出
+        static BufferedOutput &standardOutput();
+
+        RIK_INLINE void put(char c) {
+            if (size_ == capacity_) {
+                makeRoom();
+            }
+            buffer_[size_++] = c;
+        }
+
+        void write(const char *data, size_t size);
+
+        RIK_INLINE void write(const std::string &text) {
+            write(text.data(), text.size());
+        }
+
+        template <typename Integer>
+        RIK_INLINE void writeInteger(Integer value) {
+            if (capacity_ - size_ >= 24) {
+                auto result = std::to_chars(buffer_ + size_, buffer_ + capacity_, value);
+                size_ = static_cast<size_t>(result.ptr - buffer_);
+                return;
+            }
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            write(digits, static_cast<size_t>(result.ptr - digits));
+        }
+
+        void flush();
+
+        // 写进调用者内存的字节数（只对调用者内存有意义）
+        [[nodiscard]] size_t written() const {
+            return truncated_ ? spanSize_ : size_;
+        }
+
+        [[nodiscard]] bool truncated() const {
+            return truncated_;
+        }
+
+    private:
+        // 缓冲区满了：交给 FILE* / 回调，或者在调用者内存写满时改为丢弃
+        void makeRoom();
+        void emit(const char *data, size_t size);
+
+        std::FILE              *file_ = nullptr;
+        WriteCallback           callback_ = nullptr;
+        void                   *context_ = nullptr;
+        std::unique_ptr<char[]> owned_;
+        char                   *buffer_ = nullptr;
+        size_t                  capacity_ = 0;
+        size_t                  size_ = 0;
+        bool                    span_ = false; // 直接写调用者的内存
+        bool                    truncated_ = false;
+        size_t                  spanSize_ = 0;
+    };
+
+    // 带大缓冲区的输入，直接用 fread 读取 FILE*。
+    // 可以绑定一个输出，在需要重新填充缓冲区（可能阻塞）之前先把输出刷新出去，交互式程序的提示才能及时显示。
+    // 嵌入使用时也可以直接读调用者的一段内存，或者由回调一段一段地提供，两种方式都不复制数据。
+    class BufferedInput {
+    public:
+        static constexpr size_t kBufferSize = size_t(1) << 16;
+
+        // 把 *chunk 指向下一段输入并返回它的长度，返回 0 表示输入结束。这段数据在下一次回调前必须保持有效
+        using ReadCallback = size_t (*)(void *context, const char **chunk);
+
+        enum class NumberStatus {
+            Ok,
+            Overflow,  // 是合法整数，但超出 int64_t，完整的数字文本在 token 里
+            Invalid,
+            EndOfFile
+        };
+
+        explicit BufferedInput(std::FILE *file);
+        BufferedInput(const char *data, size_t size);
+        BufferedInput(ReadCallback callback, void *context);
+        ~BufferedInput() = default;
+
+        BufferedInput(const BufferedInput &) = delete;
+        BufferedInput &operator=(const BufferedInput &) = delete;
+
+        // 进程共享的标准输入，已绑定标准输出
+        static BufferedInput &standardInput();
+
+        void tie(BufferedOutput *output) {
+            tied_ = output;
+        }
+
+        // 读取一个字节（包括空白字符），到达末尾返回 EOF
+        RIK_INLINE int get() {
+            if (position_ == size_ && !refill()) {
+                return EOF;
+            }
+            return static_cast<unsigned char>(buffer_[position_++]);
+        }
+
+        // 跳过空白后读取一个由非空白字符组成的记号
+        bool readToken(std::string &token);
+
+        // 跳过空白后读取一个十进制整数
+        NumberStatus readInteger(int64_t &value, std::string &token);
+
+        // 记号之间的分隔符
+        static RIK_INLINE bool isSpace(int c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        // 把一个完整的记号解析为十进制整数，允许前导 '+'。readInteger 和不经过 FILE* 的输入共用
+        static NumberStatus parseInteger(const std::string &token, int64_t &value);
+
+    private:
+        bool refill();
+
+        std::FILE              *file_ = nullptr;
+        ReadCallback            callback_ = nullptr;
+        void                   *context_ = nullptr;
+        std::unique_ptr<char[]> owned_; // 只有读 FILE* 时才需要自己的缓冲区
+        const char             *buffer_ = nullptr;
+        size_t                  position_ = 0;
+        size_t                  size_ = 0;
+        BufferedOutput         *tied_ = nullptr;
+    };
+} // namespace Rikkyu::utils
+
+#endif // RIK_BUFFERED_IO_H
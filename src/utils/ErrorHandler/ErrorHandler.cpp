@@ -4,7 +4,7 @@
 namespace Rikkyu::utils {
     // 单例实例获取方法
     ErrorHandler& ErrorHandler::getInstance() {
-        static ErrorHandler instance;
+        static thread_local ErrorHandler instance;
         return instance;
     }
 
@@ -27,7 +27,7 @@ namespace Rikkyu::utils {
 
     class ErrorHandler {
     public:
-        // 获取单例实例
+        // 获取单例实例。每个线程各有一个，守护进程的工作线程之间互不干扰
         static ErrorHandler& getInstance();
 
         // 删除拷贝构造函数和赋值运算符
@@ -43,6 +43,9 @@ namespace Rikkyu::utils {
         bool hasErrors() {
             return !errors.empty();
         }
+        const std::vector<ErrorObj> &getErrors() const {
+            return errors;
+        }
     private:
         // 私有构造函数
         ErrorHandler() = default;
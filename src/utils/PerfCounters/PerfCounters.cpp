@@ -0,0 +1,131 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Rikkyu::utils {
+#ifdef __linux__
+    namespace {
+        constexpr uint64_t cacheReadMiss(uint64_t cache) {
+            return cache | (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) | (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+        }
+
+        int openEvent(uint32_t type, uint64_t config) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // 当前线程，任意 CPU
+            return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    } // namespace
+
+    PerfCounters::PerfCounters() {
+        static constexpr struct {
+            uint32_t type;
+            uint64_t config;
+        } kEvents[kEventCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL)},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        };
+        for (size_t i = 0; i < kEventCount; ++i) {
+            fds_[i] = openEvent(kEvents[i].type, kEvents[i].config);
+            if (fds_[i] < 0 && reason_.empty()) {
+                reason_ = std::string(name(static_cast<Event>(i))) + ": " + std::strerror(errno);
+            }
+        }
+    }
+
+    PerfCounters::~PerfCounters() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    void PerfCounters::start() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            }
+        }
+        started_ = std::chrono::steady_clock::now();
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    PerfCounters::Sample PerfCounters::stop() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        Sample sample;
+        sample.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+        for (size_t i = 0; i < kEventCount; ++i) {
+            // value, time_enabled, time_running
+            uint64_t data[3] = {};
+            if (fds_[i] < 0 || ::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+                continue;
+            }
+            if (data[2] == 0) {
+                // 整段时间都没轮到这个计数器
+                continue;
+            }
+            sample.values[i] = data[2] < data[1] ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+            sample.valid[i] = true;
+        }
+        return sample;
+    }
+#else
+    PerfCounters::PerfCounters() : reason_("perf_event_open is only available on Linux") {
+        fds_.fill(-1);
+    }
+
+    PerfCounters::~PerfCounters() = default;
+
+    void PerfCounters::start() {
+        started_ = std::chrono::steady_clock::now();
+    }
+
+    PerfCounters::Sample PerfCounters::stop() {
+        Sample sample;
+        sample.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+        return sample;
+    }
+#endif
+
+    bool PerfCounters::available() const {
+        // task-clock 是软件事件，几乎总能打开，不算数
+        for (size_t i = 0; i < TaskClock; ++i) {
+            if (fds_[i] >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *PerfCounters::name(Event event) {
+        static constexpr const char *kNames[kEventCount] = {"cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses", "task-clock"};
+        return event < kEventCount ? kNames[event] : "?";
+    }
+} // namespace Rikkyu::utils
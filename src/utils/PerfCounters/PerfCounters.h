@@ -0,0 +1,69 @@
+#pragma once
+#ifndef RIK_UTILS_PERF_COUNTERS
+#define RIK_UTILS_PERF_COUNTERS
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Rikkyu::utils {
+    // 用 Linux perf_event_open 读取当前线程的硬件性能计数器，只统计用户态。
+    // 每个事件单独打开，某个事件不受支持（虚拟机、perf_event_paranoid 限制、非 Linux）时只有它缺席，
+    // 其余照常工作；硬件计数器一个都打不开时 available() 为 false，仍然可以得到墙上时间。
+    class PerfCounters {
+    public:
+        enum Event : size_t {
+            Cycles,
+            Instructions,
+            BranchMisses,
+            L1DMisses,  // L1 数据缓存读缺失
+            LLCMisses,  // 末级缓存读缺失
+            TaskClock,  // 线程实际占用 CPU 的纳秒数（软件事件），与墙上时间对比可以看出是否在等 I/O
+            kEventCount
+        };
+
+        // 一段区间的读数。计数器被内核分时复用时按启用 / 运行时间的比例放大
+        struct Sample {
+            std::array<uint64_t, kEventCount> values{};
+            std::array<bool, kEventCount>     valid{};
+            double                            wallSeconds = 0;
+
+            [[nodiscard]] bool has(Event event) const {
+                return valid[event];
+            }
+
+            [[nodiscard]] uint64_t operator[](Event event) const {
+                return values[event];
+            }
+        };
+
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        [[nodiscard]] bool available() const;
+
+        // 第一个打不开的事件的原因，全部可用时为空
+        [[nodiscard]] const std::string &unavailableReason() const {
+            return reason_;
+        }
+
+        static const char *name(Event event);
+
+        // 清零并开始计数
+        void start();
+        // 停止计数并返回 start() 以来的读数
+        Sample stop();
+
+    private:
+        std::array<int, kEventCount>          fds_{};
+        std::string                           reason_;
+        std::chrono::steady_clock::time_point started_;
+    };
+} // namespace Rikkyu::utils
+
+#endif // RIK_UTILS_PERF_COUNTERS
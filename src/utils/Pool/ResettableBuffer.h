@@ -0,0 +1,166 @@
+#pragma once
+#ifndef RIK_UTILS_RESETTABLE_BUFFER
+#define RIK_UTILS_RESETTABLE_BUFFER
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::utils {
+    // 初始全零的定长数组，记录被写过的下标范围，reset() 只把这一段清回零，
+    // 代价取决于上一次运行碰过多少单元，而不是数组的容量。
+    // 写入方负责在写之前调用 touch() / touchRange()。
+    // 在 POSIX 上内存直接来自匿名映射：脏区超过 kAdviseBytes 时，整页部分用 madvise(MADV_DONTNEED) 交还内核，
+    // 再次访问时由内核提供零页，只有两端不足一页的部分用 memset 清零。
+    template <typename T>
+    class ResettableBuffer {
+        static_assert(std::is_trivially_copyable_v<T>, "ResettableBuffer 依赖全零字节就是 T 的零值");
+
+    public:
+        static constexpr size_t kAdviseBytes = size_t(128) << 10;
+
+        ResettableBuffer() = default;
+        explicit ResettableBuffer(size_t size) {
+            allocate(size);
+        }
+        ~ResettableBuffer() {
+            release();
+        }
+
+        ResettableBuffer(const ResettableBuffer &) = delete;
+        ResettableBuffer &operator=(const ResettableBuffer &) = delete;
+
+        [[nodiscard]] RIK_INLINE T *data() {
+            return data_;
+        }
+
+        [[nodiscard]] RIK_INLINE const T *data() const {
+            return data_;
+        }
+
+        [[nodiscard]] RIK_INLINE size_t size() const {
+            return size_;
+        }
+
+        RIK_INLINE T &operator[](size_t index) {
+            return data_[index];
+        }
+
+        RIK_INLINE const T &operator[](size_t index) const {
+            return data_[index];
+        }
+
+        RIK_INLINE void touch(size_t index) {
+            low_ = std::min(low_, index);
+            high_ = std::max(high_, index + 1);
+        }
+
+        // [first, last) 被写过
+        RIK_INLINE void touchRange(size_t first, size_t last) {
+            low_ = std::min(low_, first);
+            high_ = std::max(high_, last);
+        }
+
+        [[nodiscard]] size_t dirtyCells() const {
+            return high_ > low_ ? high_ - low_ : 0;
+        }
+
+        // 保证容量至少为 size 且内容全零。容量足够时只清理脏区
+        void ensure(size_t size) {
+            if (size > size_) {
+                release();
+                allocate(size);
+            } else {
+                reset();
+            }
+        }
+
+        // 变成 other 的副本。other 脏区以外都是零，所以只需要复制脏区
+        void assign(const ResettableBuffer &other) {
+            ensure(other.size_);
+            if (other.high_ > other.low_) {
+                std::memcpy(data_ + other.low_, other.data_ + other.low_, (other.high_ - other.low_) * sizeof(T));
+                low_ = other.low_;
+                high_ = other.high_;
+            }
+        }
+
+        void reset() {
+            if (high_ <= low_) {
+                return;
+            }
+            auto  *first = reinterpret_cast<unsigned char *>(data_ + low_);
+            auto  *last = reinterpret_cast<unsigned char *>(data_ + high_);
+            size_t bytes = static_cast<size_t>(last - first);
+#ifndef _WIN32
+            if (bytes >= kAdviseBytes) {
+                const auto page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+                auto      *alignedFirst = reinterpret_cast<unsigned char *>((reinterpret_cast<uintptr_t>(first) + page - 1) & ~(page - 1));
+                auto      *alignedLast = reinterpret_cast<unsigned char *>(reinterpret_cast<uintptr_t>(last) & ~(page - 1));
+                if (alignedFirst < alignedLast && ::madvise(alignedFirst, static_cast<size_t>(alignedLast - alignedFirst), MADV_DONTNEED) == 0) {
+                    std::memset(first, 0, static_cast<size_t>(alignedFirst - first));
+                    std::memset(alignedLast, 0, static_cast<size_t>(last - alignedLast));
+                    bytes = 0;
+                }
+            }
+#endif
+            if (bytes) {
+                std::memset(first, 0, bytes);
+            }
+            low_ = SIZE_MAX;
+            high_ = 0;
+        }
+
+    private:
+        void allocate(size_t size) {
+            low_ = SIZE_MAX;
+            high_ = 0;
+            if (size == 0) {
+                return;
+            }
+#ifdef _WIN32
+            data_ = static_cast<T *>(std::calloc(size, sizeof(T)));
+            if (!data_) {
+                throw std::bad_alloc();
+            }
+#else
+            void *memory = ::mmap(nullptr, size * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            data_ = static_cast<T *>(memory);
+#endif
+            size_ = size;
+        }
+
+        void release() {
+            if (data_) {
+#ifdef _WIN32
+                std::free(data_);
+#else
+                ::munmap(data_, size_ * sizeof(T));
+#endif
+            }
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        T     *data_ = nullptr;
+        size_t size_ = 0;
+        size_t low_ = SIZE_MAX; // 脏区 [low_, high_)，为空时 low_ > high_
+        size_t high_ = 0;
+    };
+} // namespace Rikkyu::utils
+
+#endif // RIK_UTILS_RESETTABLE_BUFFER
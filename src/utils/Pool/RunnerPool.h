@@ -0,0 +1,91 @@
+#pragma once
+#ifndef RIK_UTILS_RUNNER_POOL
+#define RIK_UTILS_RUNNER_POOL
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Rikkyu::utils {
+    // 可复用执行器（Runner / Engine / VM）的线程安全对象池。
+    // 归还时调用 T::reset()，只清理上一次运行碰过的状态，下一次 acquire() 拿到的就是干净的对象，
+    // 省去大块内存的分配和清零。空闲对象超过 capacity 时多出来的直接销毁。
+    template <typename T>
+    class RunnerPool {
+    public:
+        using Factory = std::function<std::unique_ptr<T>()>;
+
+        // 借出的对象，析构时自动归还
+        class Lease {
+        public:
+            Lease(RunnerPool &pool, std::unique_ptr<T> object)
+                : pool_(&pool), object_(std::move(object)) {}
+            ~Lease() {
+                if (object_) {
+                    pool_->release(std::move(object_));
+                }
+            }
+
+            Lease(Lease &&) noexcept = default;
+            Lease &operator=(Lease &&) = delete;
+            Lease(const Lease &) = delete;
+            Lease &operator=(const Lease &) = delete;
+
+            T &operator*() const {
+                return *object_;
+            }
+
+            T *operator->() const {
+                return object_.get();
+            }
+
+        private:
+            RunnerPool        *pool_;
+            std::unique_ptr<T> object_;
+        };
+
+        explicit RunnerPool(size_t capacity, Factory factory = [] { return std::make_unique<T>(); })
+            : capacity_(capacity), factory_(std::move(factory)) {}
+        ~RunnerPool() = default;
+
+        RunnerPool(const RunnerPool &) = delete;
+        RunnerPool &operator=(const RunnerPool &) = delete;
+
+        Lease acquire() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!idle_.empty()) {
+                    std::unique_ptr<T> object = std::move(idle_.back());
+                    idle_.pop_back();
+                    return Lease(*this, std::move(object));
+                }
+            }
+            return Lease(*this, factory_());
+        }
+
+        [[nodiscard]] size_t idle() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return idle_.size();
+        }
+
+    private:
+        void release(std::unique_ptr<T> object) {
+            // 在锁外清理，reset 的代价不会阻塞其他线程借还
+            object->reset();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (idle_.size() < capacity_) {
+                idle_.push_back(std::move(object));
+            }
+        }
+
+        size_t                          capacity_;
+        Factory                         factory_;
+        std::mutex                      mutex_;
+        std::vector<std::unique_ptr<T>> idle_;
+    };
+} // namespace Rikkyu::utils
+
+#endif // RIK_UTILS_RUNNER_POOL
@@ -0,0 +1,282 @@
+#include "SourceFilter.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RIK_SOURCE_FILTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(RIK_SOURCE_FILTER_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define RIK_SOURCE_FILTER_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace Rikkyu::utils {
+    namespace {
+        using Alphabet = SourceFilter::Alphabet;
+
+        constexpr std::array<bool, 256> makeTokenTable(Alphabet alphabet) {
+            std::array<bool, 256> table{};
+            const char           *chars = alphabet == Alphabet::Brainfuck ? "+-><,.[]" : " \t\n";
+            for (; *chars; ++chars) {
+                table[static_cast<uint8_t>(*chars)] = true;
+            }
+            return table;
+        }
+
+        constexpr std::array<bool, 256> kBrainfuckTokens = makeTokenTable(Alphabet::Brainfuck);
+        constexpr std::array<bool, 256> kWhitespaceTokens = makeTokenTable(Alphabet::Whitespace);
+
+        template <Alphabet A>
+        constexpr bool isToken(char c) {
+            return (A == Alphabet::Brainfuck ? kBrainfuckTokens : kWhitespaceTokens)[static_cast<uint8_t>(c)];
+        }
+
+        // 逐字节处理 [begin, size)，tokens / offsets 从 count 开始写。无条件写入、按需前进，循环里没有分支
+        template <Alphabet A>
+        size_t compactTail(const char *data, size_t begin, size_t size, char *tokens, uint32_t *offsets, size_t count) {
+            for (size_t i = begin; i < size; ++i) {
+                const char c = data[i];
+                tokens[count] = c;
+                if (offsets) {
+                    offsets[count] = static_cast<uint32_t>(i);
+                }
+                count += isToken<A>(c);
+            }
+            return count;
+        }
+
+        void bracketsTail(const char *data, size_t begin, size_t size, std::vector<uint32_t> &positions) {
+            for (size_t i = begin; i < size; ++i) {
+                if (data[i] == '[' || data[i] == ']') {
+                    positions.push_back(static_cast<uint32_t>(i));
+                }
+            }
+        }
+
+        // 按位取出 mask 里的下标，base 为这一块的起点
+        template <typename Mask>
+        size_t compactBits(const char *data, size_t base, Mask mask, char *tokens, uint32_t *offsets, size_t count) {
+            for (; mask; mask &= mask - 1) {
+                const auto i = static_cast<size_t>(__builtin_ctzll(mask));
+                tokens[count] = data[base + i];
+                if (offsets) {
+                    offsets[count] = static_cast<uint32_t>(base + i);
+                }
+                ++count;
+            }
+            return count;
+        }
+
+        template <typename Mask>
+        void bracketBits(size_t base, Mask mask, std::vector<uint32_t> &positions) {
+            for (; mask; mask &= mask - 1) {
+                positions.push_back(static_cast<uint32_t>(base + static_cast<size_t>(__builtin_ctzll(mask))));
+            }
+        }
+
+        template <Alphabet A>
+        size_t compactScalar(const char *data, size_t size, char *tokens, uint32_t *offsets) {
+            return compactTail<A>(data, 0, size, tokens, offsets, 0);
+        }
+
+        [[maybe_unused]] void bracketsScalar(const char *data, size_t size, std::vector<uint32_t> &positions) {
+            bracketsTail(data, 0, size, positions);
+        }
+
+#ifdef RIK_SOURCE_FILTER_SSE2
+        // SSE2 没有 pshufb，每个字符各比较一次
+        template <Alphabet A>
+        int classifySSE2(__m128i block) {
+            auto eq = [block](char c) {
+                return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+            };
+            __m128i hit;
+            if constexpr (A == Alphabet::Brainfuck) {
+                hit = _mm_or_si128(_mm_or_si128(_mm_or_si128(eq('+'), eq('-')), _mm_or_si128(eq('>'), eq('<'))),
+                                   _mm_or_si128(_mm_or_si128(eq(','), eq('.')), _mm_or_si128(eq('['), eq(']'))));
+            } else {
+                hit = _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), eq('\n'));
+            }
+            return _mm_movemask_epi8(hit);
+        }
+
+        template <Alphabet A>
+        size_t compactSSE2(const char *data, size_t size, char *tokens, uint32_t *offsets) {
+            size_t count = 0, i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const int     mask = classifySSE2<A>(block);
+                if (mask == 0) {
+                    continue;
+                }
+                if (mask == 0xFFFF) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(tokens + count), block);
+                    if (offsets) {
+                        for (size_t k = 0; k < 16; ++k) {
+                            offsets[count + k] = static_cast<uint32_t>(i + k);
+                        }
+                    }
+                    count += 16;
+                    continue;
+                }
+                count = compactBits(data, i, static_cast<uint32_t>(mask), tokens, offsets, count);
+            }
+            return compactTail<A>(data, i, size, tokens, offsets, count);
+        }
+
+        void bracketsSSE2(const char *data, size_t size, std::vector<uint32_t> &positions) {
+            const __m128i open = _mm_set1_epi8('['), close = _mm_set1_epi8(']');
+            size_t        i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const int     mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, open), _mm_cmpeq_epi8(block, close)));
+                bracketBits(i, static_cast<uint32_t>(mask), positions);
+            }
+            bracketsTail(data, i, size, positions);
+        }
+#endif
+
+#ifdef RIK_SOURCE_FILTER_AVX2
+        // 8 位掩码 -> 把被选中的字节挪到前面的 pshufb 下标，未用的位置填 0x80（结果为 0）
+        struct ShuffleTable {
+            uint64_t entries[256];
+        };
+
+        constexpr ShuffleTable makeShuffleTable() {
+            ShuffleTable table{};
+            for (unsigned mask = 0; mask < 256; ++mask) {
+                uint64_t entry = 0x8080808080808080ULL;
+                unsigned slot = 0;
+                for (unsigned bit = 0; bit < 8; ++bit) {
+                    if (mask & (1u << bit)) {
+                        entry &= ~(uint64_t(0xFF) << (slot * 8));
+                        entry |= uint64_t(bit) << (slot * 8);
+                        ++slot;
+                    }
+                }
+                table.entries[mask] = entry;
+            }
+            return table;
+        }
+
+        constexpr ShuffleTable kShuffle = makeShuffleTable();
+
+        // 高低半字节各查一张 16 项的表，两个结果按位与不为 0 即为有意义的字符。
+        //   Brainfuck：高半字节 2 -> 1（+ , - .），3 -> 2（< >），5 -> 4（[ ]）
+        //              低半字节 B -> 1|4（+ [），C -> 1|2（, <），D -> 1|4（- ]），E -> 1|2（. >）
+        //   Whitespace：高半字节 0 -> 1（\t \n），2 -> 2（空格）；低半字节 0 -> 2，9 -> 1，A -> 1
+        template <Alphabet A>
+        __attribute__((target("avx2"))) uint32_t classifyAVX2(__m256i block) {
+            __m256i high, low;
+            if constexpr (A == Alphabet::Brainfuck) {
+                high = _mm256_setr_epi8(0, 0, 1, 2, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                        0, 0, 1, 2, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+                low = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 3, 5, 3, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 3, 5, 3, 0);
+            } else {
+                high = _mm256_setr_epi8(1, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                        1, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+                low = _mm256_setr_epi8(2, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0,
+                                       2, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0);
+            }
+            const __m256i nibble = _mm256_set1_epi8(0x0F);
+            const __m256i hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+            const __m256i lo = _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+            const __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(hi, lo), _mm256_setzero_si256());
+            return ~static_cast<uint32_t>(_mm256_movemask_epi8(miss));
+        }
+
+        template <Alphabet A>
+        __attribute__((target("avx2"))) size_t compactAVX2(const char *data, size_t size, char *tokens, uint32_t *offsets) {
+            const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            size_t        count = 0, i = 0;
+            for (; i + 32 <= size; i += 32) {
+                const __m256i  block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                const uint32_t mask = classifyAVX2<A>(block);
+                if (mask == 0) {
+                    continue;
+                }
+                if (mask == UINT32_MAX) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(tokens + count), block);
+                    if (offsets) {
+                        for (size_t k = 0; k < 32; k += 8) {
+                            const __m256i at = _mm256_add_epi32(iota, _mm256_set1_epi32(static_cast<int>(i + k)));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(offsets + count + k), at);
+                        }
+                    }
+                    count += 32;
+                    continue;
+                }
+                // 每 8 字节一组：查表得到 pshufb 下标，把选中的字节挪到前面整组写出
+                for (size_t group = 0; group < 4; ++group) {
+                    const unsigned bits = (mask >> (group * 8)) & 0xFF;
+                    if (bits == 0) {
+                        continue;
+                    }
+                    const __m128i select = _mm_cvtsi64_si128(static_cast<long long>(kShuffle.entries[bits]));
+                    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(data + i + group * 8));
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(tokens + count), _mm_shuffle_epi8(bytes, select));
+                    if (offsets) {
+                        const __m256i at = _mm256_add_epi32(_mm256_cvtepu8_epi32(select), _mm256_set1_epi32(static_cast<int>(i + group * 8)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(offsets + count), at);
+                    }
+                    count += static_cast<size_t>(__builtin_popcount(bits));
+                }
+            }
+            return compactTail<A>(data, i, size, tokens, offsets, count);
+        }
+
+        __attribute__((target("avx2"))) void bracketsAVX2(const char *data, size_t size, std::vector<uint32_t> &positions) {
+            const __m256i open = _mm256_set1_epi8('['), close = _mm256_set1_epi8(']');
+            size_t        i = 0;
+            for (; i + 32 <= size; i += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                const __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(block, open), _mm256_cmpeq_epi8(block, close));
+                bracketBits(i, static_cast<uint32_t>(_mm256_movemask_epi8(hit)), positions);
+            }
+            bracketsTail(data, i, size, positions);
+        }
+#endif
+
+        struct Implementation {
+            const char *name;
+            size_t (*brainfuck)(const char *, size_t, char *, uint32_t *);
+            size_t (*whitespace)(const char *, size_t, char *, uint32_t *);
+            void (*brackets)(const char *, size_t, std::vector<uint32_t> &);
+        };
+
+        Implementation choose() {
+#ifdef RIK_SOURCE_FILTER_AVX2
+            if (__builtin_cpu_supports("avx2")) {
+                return {"avx2", compactAVX2<Alphabet::Brainfuck>, compactAVX2<Alphabet::Whitespace>, bracketsAVX2};
+            }
+#endif
+#ifdef RIK_SOURCE_FILTER_SSE2
+            return {"sse2", compactSSE2<Alphabet::Brainfuck>, compactSSE2<Alphabet::Whitespace>, bracketsSSE2};
+#else
+            return {"scalar", compactScalar<Alphabet::Brainfuck>, compactScalar<Alphabet::Whitespace>, bracketsScalar};
+#endif
+        }
+
+        const Implementation &selected() {
+            static const Implementation implementation = choose();
+            return implementation;
+        }
+    } // namespace
+
+    size_t SourceFilter::compact(const char *data, size_t size, Alphabet alphabet, char *tokens, uint32_t *offsets) {
+        const Implementation &implementation = selected();
+        return (alphabet == Alphabet::Brainfuck ? implementation.brainfuck : implementation.whitespace)(data, size, tokens, offsets);
+    }
+
+    void SourceFilter::brackets(const char *data, size_t size, std::vector<uint32_t> &positions) {
+        selected().brackets(data, size, positions);
+    }
+
+    const char *SourceFilter::implementation() {
+        return selected().name;
+    }
+} // namespace Rikkyu::utils
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef RIK_UTILS_SOURCE_FILTER
+#define RIK_UTILS_SOURCE_FILTER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Rikkyu::utils {
+    // 源码预过滤：一次处理 16 / 32 字节，按语言的字符集挑出有意义的字节，其余（注释）整块跳过。
+    // 运行时选择实现：支持 AVX2 时用 pshufb 按高低半字节查表分类、按 8 字节一组查表压缩；
+    // 否则在 x86-64 上用 SSE2 逐字符比较；其他平台逐字节查表。三种实现的结果完全相同。
+    class SourceFilter {
+    public:
+        enum class Alphabet : uint8_t {
+            Brainfuck,  // + - > < , . [ ]
+            Whitespace, // 空格、制表符、换行
+        };
+
+        // 输出缓冲区比输入多留的元素个数，压缩时整组写入，末尾可能写出这么多个无用元素
+        static constexpr size_t kSlack = 32;
+
+        // 把 [data, data + size) 中属于 alphabet 的字节按原顺序写到 tokens，返回个数。
+        // offsets 不为空时同时写下每个字节相对 data 的下标，因此 size 不能超过 4 GiB。
+        // tokens / offsets 至少要有 size + kSlack 个元素
+        static size_t compact(const char *data, size_t size, Alphabet alphabet, char *tokens, uint32_t *offsets);
+
+        // 把 [data, data + size) 中 '[' 和 ']' 相对 data 的下标按顺序追加到 positions
+        static void brackets(const char *data, size_t size, std::vector<uint32_t> &positions);
+
+        // 当前选中的实现："avx2"、"sse2" 或 "scalar"
+        static const char *implementation();
+    };
+} // namespace Rikkyu::utils
+
+#endif // RIK_UTILS_SOURCE_FILTER
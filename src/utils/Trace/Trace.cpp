@@ -0,0 +1,154 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace Rikkyu::utils {
+    namespace {
+        constexpr char     kMagic[8] = {'R', 'I', 'K', 'T', 'R', 'A', 'C', 'E'};
+        constexpr uint32_t kVersion = 1;
+
+        // 转储统一用小端序，与写入机器无关
+        void writeLE(std::ostream &out, uint64_t value, size_t bytes) {
+            char buffer[8];
+            for (size_t i = 0; i < bytes; ++i) {
+                buffer[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+            out.write(buffer, static_cast<std::streamsize>(bytes));
+        }
+
+        bool readLE(std::istream &in, uint64_t &value, size_t bytes) {
+            unsigned char buffer[8];
+            if (!in.read(reinterpret_cast<char *>(buffer), static_cast<std::streamsize>(bytes))) {
+                return false;
+            }
+            value = 0;
+            for (size_t i = 0; i < bytes; ++i) {
+                value |= static_cast<uint64_t>(buffer[i]) << (8 * i);
+            }
+            return true;
+        }
+
+        const char *languageName(uint64_t language) {
+            switch (static_cast<TraceLanguage>(language)) {
+            case TraceLanguage::Brainfuck:
+                return "Brainfuck";
+            case TraceLanguage::Whitespace:
+                return "Whitespace";
+            default:
+                return "Unknown";
+            }
+        }
+    } // namespace
+
+    TraceRing::TraceRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.reset(new Slot[size]);
+        mask_ = size - 1;
+    }
+
+    std::vector<TraceEvent> TraceRing::snapshot(uint64_t *first) const {
+        const uint64_t end = head_.load(std::memory_order_acquire);
+        const uint64_t size = capacity();
+        const uint64_t begin = end > size ? end - size : 0;
+
+        std::vector<TraceEvent> events;
+        uint64_t                start = begin;
+        events.reserve(static_cast<size_t>(end - begin));
+        for (uint64_t i = begin; i < end; ++i) {
+            const Slot    &slot = slots_[i & mask_];
+            const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            const uint64_t header = slot.header.load(std::memory_order_relaxed);
+            const uint64_t value = slot.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // 读取期间该槽位被写入方覆盖（或正在覆盖），这一条以及更早的都已经不可信
+            if (before != 2 * i + 2 || slot.sequence.load(std::memory_order_relaxed) != before) {
+                events.clear();
+                start = i + 1;
+                continue;
+            }
+            events.push_back({static_cast<uint32_t>(header), static_cast<uint16_t>(header >> 32), static_cast<uint16_t>(header >> 48), static_cast<int64_t>(value)});
+        }
+        if (first) {
+            *first = start;
+        }
+        return events;
+    }
+
+    bool TraceRing::dump(std::ostream &out, TraceLanguage language, const std::vector<std::string> &opcodeNames) const {
+        uint64_t                      first = 0;
+        const std::vector<TraceEvent> events = snapshot(&first);
+        const uint64_t                recorded = first + events.size();
+
+        out.write(kMagic, sizeof(kMagic));
+        writeLE(out, kVersion, 4);
+        writeLE(out, static_cast<uint32_t>(language), 4);
+        writeLE(out, recorded, 8);
+        writeLE(out, events.size(), 8);
+        writeLE(out, opcodeNames.size(), 4);
+        for (const auto &name : opcodeNames) {
+            writeLE(out, name.size(), 2);
+            out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+        for (const auto &event : events) {
+            writeLE(out, event.pc, 4);
+            writeLE(out, event.op, 2);
+            writeLE(out, event.flags, 2);
+            writeLE(out, static_cast<uint64_t>(event.value), 8);
+        }
+        return static_cast<bool>(out);
+    }
+
+    bool decodeTrace(std::istream &in, std::ostream &out) {
+        char magic[sizeof(kMagic)];
+        if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kMagic)) {
+            return false;
+        }
+
+        uint64_t version, language, recorded, count, nameCount;
+        if (!readLE(in, version, 4) || version != kVersion || !readLE(in, language, 4) ||
+            !readLE(in, recorded, 8) || !readLE(in, count, 8) || !readLE(in, nameCount, 4)) {
+            return false;
+        }
+
+        std::vector<std::string> names(static_cast<size_t>(nameCount));
+        for (auto &name : names) {
+            uint64_t length;
+            if (!readLE(in, length, 2)) {
+                return false;
+            }
+            name.resize(static_cast<size_t>(length));
+            if (!in.read(name.data(), static_cast<std::streamsize>(length))) {
+                return false;
+            }
+        }
+
+        out << "# " << languageName(language) << " trace: " << recorded << " events recorded, last " << count << " kept\n";
+        // 序号从被保留的第一条事件在整个执行中的位置开始
+        uint64_t sequence = recorded - count;
+        for (uint64_t i = 0; i < count; ++i, ++sequence) {
+            uint64_t pc, op, flags, value;
+            if (!readLE(in, pc, 4) || !readLE(in, op, 2) || !readLE(in, flags, 2) || !readLE(in, value, 8)) {
+                return false;
+            }
+
+            out << std::setw(10) << sequence << "  @" << std::left << std::setw(8) << pc << ' ' << std::setw(10);
+            if (op < names.size()) {
+                out << names[static_cast<size_t>(op)];
+            } else {
+                out << ("op" + std::to_string(op));
+            }
+            out << std::right;
+            if (flags & TF_Truncated) {
+                out << "  value=<big>";
+            } else if (flags & TF_HasValue) {
+                out << "  value=" << static_cast<int64_t>(value);
+            }
+            out << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+} // namespace Rikkyu::utils
@@ -0,0 +1,129 @@
+#pragma once
+#ifndef RIK_TRACE_H
+#define RIK_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::utils {
+    enum class TraceLanguage : uint32_t {
+        Brainfuck = 1,
+        Whitespace = 2,
+    };
+
+    enum TraceFlags : uint16_t {
+        TF_HasValue = 1,  // value 有效（栈非空）
+        TF_Truncated = 2, // 值超出 int64_t，value 只是占位
+    };
+
+    // 一条执行事件：执行 pc 处的指令之前，栈顶 / 当前单元格的值
+    struct TraceEvent {
+        uint32_t pc;
+        uint16_t op;
+        uint16_t flags;
+        int64_t  value;
+    };
+
+    // 定长的二进制环形缓冲区，写满后覆盖最旧的事件。
+    // 单写者无锁：写入方只有几次普通存储，不加锁也不做读-改-写；
+    // 其他线程可以随时 snapshot()，被并发覆盖的事件会被丢弃而不会读到半条。
+    class TraceRing {
+    public:
+        static constexpr size_t kDefaultCapacity = size_t(1) << 16;
+
+        // 容量向上取整为 2 的幂
+        explicit TraceRing(size_t capacity = kDefaultCapacity);
+        ~TraceRing() = default;
+
+        TraceRing(const TraceRing &) = delete;
+        TraceRing &operator=(const TraceRing &) = delete;
+
+        RIK_INLINE void record(uint32_t pc, uint16_t op, uint16_t flags, int64_t value) {
+            const uint64_t index = head_.load(std::memory_order_relaxed);
+            Slot          &slot = slots_[index & mask_];
+            // 每个槽位是一个小的 seqlock：奇数表示正在写，写完后变成 2 * (index + 1)
+            slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.header.store(pc | (static_cast<uint64_t>(op) << 32) | (static_cast<uint64_t>(flags) << 48), std::memory_order_relaxed);
+            slot.value.store(static_cast<uint64_t>(value), std::memory_order_relaxed);
+            slot.sequence.store(2 * index + 2, std::memory_order_release);
+            head_.store(index + 1, std::memory_order_release);
+        }
+
+        [[nodiscard]] size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        // 从开始到现在记录过的事件总数（包括已被覆盖的）
+        [[nodiscard]] uint64_t recorded() const {
+            return head_.load(std::memory_order_acquire);
+        }
+
+        // 缓冲区中仍然有效的事件，按时间先后排列；first 返回第一条的全局序号
+        [[nodiscard]] std::vector<TraceEvent> snapshot(uint64_t *first = nullptr) const;
+
+        // 写出二进制转储。文件头自带操作码名称表，解码时不需要对应的解释器
+        bool dump(std::ostream &out, TraceLanguage language, const std::vector<std::string> &opcodeNames) const;
+
+        void clear() {
+            head_.store(0, std::memory_order_release);
+        }
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<uint64_t> header{0};
+            std::atomic<uint64_t> value{0};
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        size_t                  mask_;
+        std::atomic<uint64_t>   head_{0};
+    };
+
+    // 跟踪策略。解释器以模板参数接收策略，NoTrace 的 record 为空函数，
+    // 关闭跟踪时整个调用连同取值一起被编译器消除。
+    struct NoTrace {
+        static constexpr bool enabled = false;
+
+        RIK_INLINE void record(uint32_t, uint16_t, uint16_t, int64_t) {}
+    };
+
+    // 只数执行了多少步，供性能计数器报告换算每条程序指令的开销
+    struct CountTracer {
+        static constexpr bool enabled = true;
+
+        uint64_t count = 0;
+
+        RIK_INLINE void record(uint32_t, uint16_t, uint16_t, int64_t) {
+            ++count;
+        }
+    };
+
+    class RingTracer {
+    public:
+        static constexpr bool enabled = true;
+
+        explicit RingTracer(TraceRing &ring) : ring_(&ring) {}
+
+        RIK_INLINE void record(uint32_t pc, uint16_t op, uint16_t flags, int64_t value) {
+            ring_->record(pc, op, flags, value);
+        }
+
+    private:
+        TraceRing *ring_;
+    };
+
+    // 离线解码：把 TraceRing::dump 的输出转换成逐行文本，格式错误时返回 false
+    bool decodeTrace(std::istream &in, std::ostream &out);
+} // namespace Rikkyu::utils
+
+#endif // RIK_TRACE_H
@@ -2,7 +2,14 @@
 #ifndef RIK_WS_ABSTRACT_EXP
 #define RIK_WS_ABSTRACT_EXP
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 namespace Rikkyu::Whitespace {
+    // 解析时驻留得到的标签编号，从 0 开始连续分配
+    using LabelId = int32_t;
+
     // 前向声明所有Whitespace指令类型
     class StackPushExpression;
     class StackDuplicateExpression;
@@ -10,6 +17,7 @@ namespace Rikkyu::Whitespace {
     class StackSwapExpression;
     class StackDiscardExpression;
     class StackSlideExpression;
+    class StackGuardExpression;
     class ArithmeticAddExpression;
     class ArithmeticSubExpression;
     class ArithmeticMulExpression;
@@ -38,6 +46,7 @@ namespace Rikkyu::Whitespace {
         virtual void visit(const StackSwapExpression &) = 0;
         virtual void visit(const StackDiscardExpression &) = 0;
         virtual void visit(const StackSlideExpression &) = 0;
+        virtual void visit(const StackGuardExpression &) = 0;
         virtual void visit(const ArithmeticAddExpression &) = 0;
         virtual void visit(const ArithmeticSubExpression &) = 0;
         virtual void visit(const ArithmeticMulExpression &) = 0;
@@ -67,6 +76,15 @@ namespace Rikkyu::Whitespace {
         virtual void run(class Runner &runner) const = 0;
         virtual void accept(ExpressionVisitor &visitor) const = 0;
         virtual std::string toIR() const = 0;
+
+        // 栈效果：执行前栈中至少需要的元素个数，以及执行后栈深度的变化量。
+        // Parser 依此为每个基本块计算所需深度，并在块入口统一做下溢检查。
+        [[nodiscard]] virtual size_t         stackRequired() const { return 0; }
+        [[nodiscard]] virtual std::ptrdiff_t stackDelta() const { return 0; }
+
+        // 基本块边界：标签开始一个新块，跳转 / 调用 / 返回 / 退出结束当前块
+        [[nodiscard]] virtual bool startsBlock() const { return false; }
+        [[nodiscard]] virtual bool endsBlock() const { return false; }
     };
 }
 
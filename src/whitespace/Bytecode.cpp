@@ -0,0 +1,61 @@
+#include "Bytecode.h"
+
+namespace Rikkyu::Whitespace {
+    const char *opcodeName(Opcode op) {
+        switch (op) {
+#define RIK_WS_OPCODE_NAME(name, mnemonic) \
+    case Opcode::name:                     \
+        return mnemonic;
+            RIK_WS_OPCODES(RIK_WS_OPCODE_NAME)
+#undef RIK_WS_OPCODE_NAME
+        }
+        return "Unknown";
+    }
+
+    std::string Program::toIR(size_t pc) const {
+        const Instruction &instruction = code_[pc];
+        std::string        ir = opcodeName(instruction.op);
+        switch (instruction.op) {
+        case Opcode::Push:
+        case Opcode::AddImmediate:
+        case Opcode::MulImmediate:
+        case Opcode::LoadImmediate:
+        case Opcode::StoreImmediate:
+            ir += " " + instruction.value.toString();
+            break;
+        case Opcode::Guard:
+        case Opcode::Copy:
+        case Opcode::Slide:
+            ir += " " + std::to_string(instruction.operand);
+            break;
+        case Opcode::Call:
+        case Opcode::Jump:
+        case Opcode::JumpZero:
+        case Opcode::JumpNegative:
+        case Opcode::DupJumpZero:
+        case Opcode::DupJumpNegative:
+            ir += " @" + std::to_string(instruction.operand);
+            break;
+        case Opcode::Trap:
+            ir += " \"" + messages_[static_cast<size_t>(instruction.operand)] + "\"";
+            break;
+        default:
+            break;
+        }
+        return ir;
+    }
+
+    bool Program::isBranch(Opcode op) {
+        switch (op) {
+        case Opcode::Call:
+        case Opcode::Jump:
+        case Opcode::JumpZero:
+        case Opcode::JumpNegative:
+        case Opcode::DupJumpZero:
+        case Opcode::DupJumpNegative:
+            return true;
+        default:
+            return false;
+        }
+    }
+} // namespace Rikkyu::Whitespace
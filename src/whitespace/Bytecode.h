@@ -0,0 +1,120 @@
+#pragma once
+#ifndef RIK_WHITESPACE_BYTECODE
+#define RIK_WHITESPACE_BYTECODE
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Value.h"
+
+namespace Rikkyu::Whitespace {
+    // 所有字节码操作码及其 IR 助记符。新增操作码时只需要改这一处，
+    // 名字表、分派表都由这个列表展开生成。
+    // TRAP 只由编译器生成，放在 HALT 之后，作为未定义标签的跳转目标。
+    // 后半部分是 PeepholeOptimizer 生成的超级指令，带立即数操作数。
+#define RIK_WS_OPCODES(X)                 \
+    X(Guard, "GUARD")                     \
+    X(Push, "PUSH")                       \
+    X(Dup, "DUP")                         \
+    X(Copy, "COPY")                       \
+    X(Swap, "SWAP")                       \
+    X(Drop, "DROP")                       \
+    X(Slide, "SLIDE")                     \
+    X(Add, "ADD")                         \
+    X(Sub, "SUB")                         \
+    X(Mul, "MUL")                         \
+    X(Div, "DIV")                         \
+    X(Mod, "MOD")                         \
+    X(Store, "STORE")                     \
+    X(Retrieve, "RETRIEVE")               \
+    X(Call, "CALL")                       \
+    X(Jump, "JUMP")                       \
+    X(JumpZero, "JUMP_ZERO")              \
+    X(JumpNegative, "JUMP_NEG")           \
+    X(Return, "RETURN")                   \
+    X(Exit, "EXIT")                       \
+    X(OutChar, "OUTCHAR")                 \
+    X(OutNum, "OUTNUM")                   \
+    X(InChar, "INCHAR")                   \
+    X(InNum, "INNUM")                     \
+    X(Halt, "HALT")                       \
+    X(Trap, "TRAP")                       \
+    X(AddImmediate, "ADDI")               \
+    X(MulImmediate, "MULI")               \
+    X(LoadImmediate, "LOADI")             \
+    X(StoreImmediate, "STOREI")           \
+    X(DupJumpZero, "DUPJZ")               \
+    X(DupJumpNegative, "DUPJN")
+
+    enum class Opcode : uint8_t {
+#define RIK_WS_OPCODE_ENUM(name, mnemonic) name,
+        RIK_WS_OPCODES(RIK_WS_OPCODE_ENUM)
+#undef RIK_WS_OPCODE_ENUM
+    };
+
+    const char *opcodeName(Opcode op);
+
+    // 一条字节码指令，操作数直接内联：
+    //   operand - COPY / SLIDE 的 n，GUARD 需要的栈深度，跳转 / 调用的目标下标，TRAP 的错误信息下标
+    //   value   - PUSH / ADDI / MULI 的立即数，LOADI / STOREI 的堆地址
+    struct Instruction {
+        Opcode  op = Opcode::Halt;
+        int32_t operand = 0;
+        Value   value;
+    };
+
+    // 编译完成的程序。标签都已解析为指令下标，顺序执行总会停在一条 Halt 上，
+    // 执行时不需要再做越界检查。Halt 之后可能跟着若干 TRAP，未定义的标签都跳到这里。
+    class Program {
+    public:
+        Program() = default;
+        ~Program() = default;
+
+        Program(Program &&) = default;
+        Program &operator=(Program &&) = default;
+
+        [[nodiscard]] const std::vector<Instruction> &code() const {
+            return code_;
+        }
+
+        [[nodiscard]] std::vector<Instruction> &code() {
+            return code_;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return code_.empty();
+        }
+
+        // PUSH 的大整数立即数由程序持有，保证指令里的 Value 一直有效
+        void keepLiteral(const Literal &literal) {
+            if (literal.storage) {
+                literals_.push_back(literal.storage);
+            }
+        }
+
+        // TRAP 执行时报告的错误信息，返回它的下标
+        int32_t addMessage(std::string message) {
+            messages_.push_back(std::move(message));
+            return static_cast<int32_t>(messages_.size() - 1);
+        }
+
+        [[nodiscard]] const std::vector<std::string> &messages() const {
+            return messages_;
+        }
+
+        [[nodiscard]] std::string toIR(size_t pc) const;
+
+        // 分支类指令的 operand 是跳转目标
+        [[nodiscard]] static bool isBranch(Opcode op);
+
+    private:
+        std::vector<Instruction>                   code_;
+        std::vector<std::shared_ptr<const BigInt>> literals_;
+        std::vector<std::string>                   messages_;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_BYTECODE
@@ -0,0 +1,20 @@
+#include "CEmitter.h"
+
+#include "../ir/CBackend.h"
+#include "../ir/PassManager.h"
+#include "IRLowering.h"
+
+namespace Rikkyu::Whitespace {
+    std::string CEmitter::emit(const Program &program) {
+        IR::Module module;
+        if (!IRLowering().lower(program, module)) {
+            return "";
+        }
+        IR::PassManager::standard().run(module);
+        return IR::CBackend().emit(module);
+    }
+
+    bool CEmitter::compileNative(const std::string &source, const std::string &outputPath, const std::string &compiler) {
+        return IR::CBackend::compileNative(source, outputPath, compiler);
+    }
+} // namespace Rikkyu::Whitespace
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef RIK_WHITESPACE_C_EMITTER
+#define RIK_WHITESPACE_C_EMITTER
+
+#include <string>
+
+#include "Bytecode.h"
+
+namespace Rikkyu::Whitespace {
+    // 把编译好的字节码翻译成 C 源码（提前编译后端）。
+    // 字节码先经 IRLowering 降低为共用 IR，跑一遍 IR::PassManager::standard()，
+    // 再交给与 Brainfuck 共用的 IR::CBackend 生成代码。
+    // 整数使用 64 位，溢出时以 WSE17 退出（大整数程序请使用解释器）。
+    class CEmitter {
+    public:
+        CEmitter() = default;
+        ~CEmitter() = default;
+
+        // 失败（例如含有超出 64 位的字面量）时报告错误并返回空串
+        std::string emit(const Program &program);
+
+        // 把 C 源码写到 outputPath + ".c"，再调用系统 C 编译器生成可执行文件
+        static bool compileNative(const std::string &source, const std::string &outputPath, const std::string &compiler = "cc");
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_C_EMITTER
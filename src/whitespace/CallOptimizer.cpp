@@ -0,0 +1,79 @@
+#include "CallOptimizer.h"
+
+namespace Rikkyu::Whitespace {
+    void CallOptimizer::optimize(Program &program) {
+        inlined_ = 0;
+        tailCalls_ = 0;
+        inlineLeaves(program);
+        eliminateTailCalls(program);
+    }
+
+    std::ptrdiff_t CallOptimizer::leafLength(const std::vector<Instruction> &code, size_t entry) const {
+        for (size_t i = entry; i < code.size() && i - entry <= maxInlineLength_; ++i) {
+            const Opcode op = code[i].op;
+            if (op == Opcode::Return) {
+                return static_cast<std::ptrdiff_t>(i - entry);
+            }
+            if (Program::isBranch(op) || op == Opcode::Exit || op == Opcode::Halt || op == Opcode::Trap) {
+                return -1;
+            }
+        }
+        return -1;
+    }
+
+    void CallOptimizer::inlineLeaves(Program &program) {
+        auto        &code = program.code();
+        const size_t size = code.size();
+
+        std::vector<std::ptrdiff_t> length(size, -2); // -2 尚未计算
+        std::vector<Instruction>    out;
+        std::vector<int32_t>        remap(size + 1, 0);
+        out.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            remap[i] = static_cast<int32_t>(out.size());
+            if (code[i].op == Opcode::Call) {
+                const auto entry = static_cast<size_t>(code[i].operand);
+                if (length[entry] == -2) {
+                    length[entry] = leafLength(code, entry);
+                }
+                if (length[entry] >= 0) {
+                    // 函数体里没有分支，原样复制即可；其中的 GUARD 相对入口计算，在调用点同样成立
+                    out.insert(out.end(), code.begin() + static_cast<std::ptrdiff_t>(entry), code.begin() + static_cast<std::ptrdiff_t>(entry) + length[entry]);
+                    ++inlined_;
+                    continue;
+                }
+            }
+            out.push_back(code[i]);
+        }
+        remap[size] = static_cast<int32_t>(out.size());
+
+        if (!inlined_) {
+            return;
+        }
+        for (auto &instruction : out) {
+            if (Program::isBranch(instruction.op)) {
+                instruction.operand = remap[static_cast<size_t>(instruction.operand)];
+            }
+        }
+        code = std::move(out);
+    }
+
+    void CallOptimizer::eliminateTailCalls(Program &program) {
+        auto &code = program.code();
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (code[i].op != Opcode::Call) {
+                continue;
+            }
+            // 返回点开头通常是一条不需要栈深度的 GUARD
+            size_t next = i + 1;
+            while (next < code.size() && code[next].op == Opcode::Guard && code[next].operand == 0) {
+                ++next;
+            }
+            if (next < code.size() && code[next].op == Opcode::Return) {
+                // 被调用者返回后立刻再返回，不如直接跳过去，让它的 RETURN 直接回到我们的调用者
+                code[i].op = Opcode::Jump;
+                ++tailCalls_;
+            }
+        }
+    }
+} // namespace Rikkyu::Whitespace
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef RIK_WHITESPACE_CALL_OPTIMIZER
+#define RIK_WHITESPACE_CALL_OPTIMIZER
+
+#include <cstddef>
+#include <vector>
+
+#include "Bytecode.h"
+
+namespace Rikkyu::Whitespace {
+    // 针对 CALL / RETURN 的优化，在窥孔优化之前运行：
+    //   CALL f  (f 是不超过 maxInlineLength 条指令的叶子子程序)  ->  f 的函数体
+    //   CALL f; RETURN                                         ->  JUMP f
+    // 叶子子程序指从入口起一直顺序执行到 RETURN，中间没有任何跳转、调用或结束指令。
+    // 内联后原来的子程序保留不动，其他跳转仍然可以到达它。
+    class CallOptimizer {
+    public:
+        static constexpr size_t kDefaultMaxInlineLength = 16;
+
+        explicit CallOptimizer(size_t maxInlineLength = kDefaultMaxInlineLength)
+            : maxInlineLength_(maxInlineLength) {}
+        ~CallOptimizer() = default;
+
+        void optimize(Program &program);
+
+        [[nodiscard]] size_t inlined() const {
+            return inlined_;
+        }
+
+        [[nodiscard]] size_t tailCalls() const {
+            return tailCalls_;
+        }
+
+    private:
+        // 从 entry 开始的叶子子程序长度（不含 RETURN），不是叶子或太长时返回 -1
+        std::ptrdiff_t leafLength(const std::vector<Instruction> &code, size_t entry) const;
+
+        void inlineLeaves(Program &program);
+        void eliminateTailCalls(Program &program);
+
+        size_t maxInlineLength_;
+        size_t inlined_ = 0;
+        size_t tailCalls_ = 0;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_CALL_OPTIMIZER
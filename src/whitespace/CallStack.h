@@ -0,0 +1,74 @@
+#pragma once
+#ifndef RIK_WHITESPACE_CALL_STACK
+#define RIK_WHITESPACE_CALL_STACK
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::Whitespace {
+    // 返回地址栈。容量即深度上限，构造时一次性分配成连续数组，压栈 / 出栈只是移动下标。
+    class CallStack {
+    public:
+        static constexpr size_t kDefaultLimit = size_t(1) << 16;
+
+        explicit CallStack(size_t limit = kDefaultLimit)
+            : frames_(new uint32_t[limit]), limit_(limit) {}
+        ~CallStack() = default;
+
+        CallStack(const CallStack &) = delete;
+        CallStack &operator=(const CallStack &) = delete;
+
+        // 超过深度上限返回 false
+        RIK_INLINE bool push(uint32_t returnAddress) {
+            if (size_ == limit_) {
+                return false;
+            }
+            frames_[size_++] = returnAddress;
+            return true;
+        }
+
+        // 栈为空返回 false
+        RIK_INLINE bool pop(uint32_t &returnAddress) {
+            if (size_ == 0) {
+                return false;
+            }
+            returnAddress = frames_[--size_];
+            return true;
+        }
+
+        [[nodiscard]] size_t size() const {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] size_t limit() const {
+            return limit_;
+        }
+
+        // 修改深度上限会清空栈
+        void setLimit(size_t limit) {
+            if (limit != limit_) {
+                frames_.reset(new uint32_t[limit]);
+                limit_ = limit;
+            }
+            size_ = 0;
+        }
+
+        void clear() {
+            size_ = 0;
+        }
+
+    private:
+        std::unique_ptr<uint32_t[]> frames_;
+        size_t                      limit_;
+        size_t                      size_ = 0;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_CALL_STACK
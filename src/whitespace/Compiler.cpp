@@ -0,0 +1,171 @@
+#include "Compiler.h"
+#include "CallOptimizer.h"
+#include "Peephole.h"
+#include "StackAnalysis.h"
+#include "interpreter.h"
+
+namespace Rikkyu::Whitespace {
+    Program Compiler::compile(const ExpressionVector &expressions, const LabelTable &labels, bool optimize) {
+        program_ = Program();
+        labels_.clear();
+        names_ = &labels;
+        unresolved_.clear();
+
+        // 第一遍：除 LABEL 外每个表达式恰好对应一条指令，据此确定标签的位置。
+        // 重复定义的标签以第一次出现为准。
+        int32_t index = 0;
+        for (const auto &expression : expressions) {
+            if (auto mark = dynamic_cast<const FlowMarkExpression *>(expression.get())) {
+                const auto label = static_cast<size_t>(mark->label());
+                if (label >= labels_.size()) {
+                    labels_.resize(label + 1, -1);
+                }
+                if (labels_[label] < 0) {
+                    labels_[label] = index;
+                }
+            } else {
+                ++index;
+            }
+        }
+
+        program_.code().reserve(static_cast<size_t>(index) + 1);
+        for (const auto &expression : expressions) {
+            expression->accept(*this);
+        }
+        emit(Opcode::Halt);
+
+        // 未定义的标签各对应 Halt 之后的一条 TRAP，只有真的跳过去才报告错误
+        for (const auto &[index, label] : unresolved_) {
+            const auto id = static_cast<size_t>(label);
+            if (id >= labels_.size()) {
+                labels_.resize(id + 1, -1);
+            }
+            if (labels_[id] < 0) {
+                labels_[id] = static_cast<int32_t>(program_.code().size());
+                emit(Opcode::Trap, program_.addMessage(utils::StringBuilder::concatenate("[WSE05]: Undefined Label: ", names_->name(label))));
+            }
+            program_.code()[index].operand = labels_[id];
+        }
+        if (optimize) {
+            // 先内联小的叶子子程序、消除尾调用，再用控制流图证明哪些块入口检查是多余的，再由窥孔优化把它们删掉
+            CallOptimizer().optimize(program_);
+            ControlFlowGraph(program_).eliminateGuards(program_);
+            PeepholeOptimizer().optimize(program_);
+        }
+        return std::move(program_);
+    }
+
+    void Compiler::emit(Opcode op, int32_t operand, Value value) {
+        program_.code().push_back({op, operand, value});
+    }
+
+    void Compiler::emitBranch(Opcode op, LabelId label) {
+        const int32_t target = static_cast<size_t>(label) < labels_.size() ? labels_[static_cast<size_t>(label)] : -1;
+        if (target < 0) {
+            unresolved_.emplace_back(program_.code().size(), label);
+            emit(op);
+            return;
+        }
+        emit(op, target);
+    }
+
+    void Compiler::visit(const StackPushExpression &expression) {
+        program_.keepLiteral(expression.value());
+        emit(Opcode::Push, 0, expression.value().value);
+    }
+
+    void Compiler::visit(const StackDuplicateExpression &) {
+        emit(Opcode::Dup);
+    }
+
+    void Compiler::visit(const StackCopyExpression &expression) {
+        emit(Opcode::Copy, expression.n());
+    }
+
+    void Compiler::visit(const StackSwapExpression &) {
+        emit(Opcode::Swap);
+    }
+
+    void Compiler::visit(const StackDiscardExpression &) {
+        emit(Opcode::Drop);
+    }
+
+    void Compiler::visit(const StackSlideExpression &expression) {
+        emit(Opcode::Slide, expression.n());
+    }
+
+    void Compiler::visit(const StackGuardExpression &expression) {
+        // 永远无法满足的检查（负数参数）编码为 -1
+        emit(Opcode::Guard, expression.required() > static_cast<size_t>(INT32_MAX) ? -1 : static_cast<int32_t>(expression.required()));
+    }
+
+    void Compiler::visit(const ArithmeticAddExpression &) {
+        emit(Opcode::Add);
+    }
+
+    void Compiler::visit(const ArithmeticSubExpression &) {
+        emit(Opcode::Sub);
+    }
+
+    void Compiler::visit(const ArithmeticMulExpression &) {
+        emit(Opcode::Mul);
+    }
+
+    void Compiler::visit(const ArithmeticDivExpression &) {
+        emit(Opcode::Div);
+    }
+
+    void Compiler::visit(const ArithmeticModExpression &) {
+        emit(Opcode::Mod);
+    }
+
+    void Compiler::visit(const HeapStoreExpression &) {
+        emit(Opcode::Store);
+    }
+
+    void Compiler::visit(const HeapRetrieveExpression &) {
+        emit(Opcode::Retrieve);
+    }
+
+    void Compiler::visit(const FlowMarkExpression &) {}
+
+    void Compiler::visit(const FlowCallExpression &expression) {
+        emitBranch(Opcode::Call, expression.label());
+    }
+
+    void Compiler::visit(const FlowJumpExpression &expression) {
+        emitBranch(Opcode::Jump, expression.label());
+    }
+
+    void Compiler::visit(const FlowJumpZeroExpression &expression) {
+        emitBranch(Opcode::JumpZero, expression.label());
+    }
+
+    void Compiler::visit(const FlowJumpNegativeExpression &expression) {
+        emitBranch(Opcode::JumpNegative, expression.label());
+    }
+
+    void Compiler::visit(const FlowReturnExpression &) {
+        emit(Opcode::Return);
+    }
+
+    void Compiler::visit(const FlowExitExpression &) {
+        emit(Opcode::Exit);
+    }
+
+    void Compiler::visit(const IOOutputCharExpression &) {
+        emit(Opcode::OutChar);
+    }
+
+    void Compiler::visit(const IOOutputNumExpression &) {
+        emit(Opcode::OutNum);
+    }
+
+    void Compiler::visit(const IOInputCharExpression &) {
+        emit(Opcode::InChar);
+    }
+
+    void Compiler::visit(const IOInputNumExpression &) {
+        emit(Opcode::InNum);
+    }
+} // namespace Rikkyu::Whitespace
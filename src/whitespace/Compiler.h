@@ -0,0 +1,64 @@
+#pragma once
+#ifndef RIK_WHITESPACE_COMPILER
+#define RIK_WHITESPACE_COMPILER
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AbstractExpression.h"
+#include "Bytecode.h"
+#include "Runner.h"
+
+namespace Rikkyu::Whitespace {
+    class LabelTable;
+
+    // 把 Parser 产生的表达式序列编译为字节码。
+    // 标签在编译期解析为指令下标（支持向前跳转），LABEL 本身不产生指令。
+    class Compiler : public ExpressionVisitor {
+    public:
+        Compiler() = default;
+        ~Compiler() = default;
+
+        // 跳到未定义标签的分支指向一条 TRAP，执行到时才报告 WSE05；labels 是解析时的标签表，用于在错误信息里给出标签名。
+        // optimize 为 true 时编译后再做调用优化、栈检查消除和窥孔优化。
+        Program compile(const ExpressionVector &expressions, const LabelTable &labels, bool optimize = true);
+
+        void visit(const StackPushExpression &expression) override;
+        void visit(const StackDuplicateExpression &expression) override;
+        void visit(const StackCopyExpression &expression) override;
+        void visit(const StackSwapExpression &expression) override;
+        void visit(const StackDiscardExpression &expression) override;
+        void visit(const StackSlideExpression &expression) override;
+        void visit(const StackGuardExpression &expression) override;
+        void visit(const ArithmeticAddExpression &expression) override;
+        void visit(const ArithmeticSubExpression &expression) override;
+        void visit(const ArithmeticMulExpression &expression) override;
+        void visit(const ArithmeticDivExpression &expression) override;
+        void visit(const ArithmeticModExpression &expression) override;
+        void visit(const HeapStoreExpression &expression) override;
+        void visit(const HeapRetrieveExpression &expression) override;
+        void visit(const FlowMarkExpression &expression) override;
+        void visit(const FlowCallExpression &expression) override;
+        void visit(const FlowJumpExpression &expression) override;
+        void visit(const FlowJumpZeroExpression &expression) override;
+        void visit(const FlowJumpNegativeExpression &expression) override;
+        void visit(const FlowReturnExpression &expression) override;
+        void visit(const FlowExitExpression &expression) override;
+        void visit(const IOOutputCharExpression &expression) override;
+        void visit(const IOOutputNumExpression &expression) override;
+        void visit(const IOInputCharExpression &expression) override;
+        void visit(const IOInputNumExpression &expression) override;
+
+    private:
+        void emit(Opcode op, int32_t operand = 0, Value value = Value());
+        void emitBranch(Opcode op, LabelId label);
+
+        Program                                 program_;
+        std::vector<int32_t>                    labels_;     // LabelId -> 指令下标，未定义为 -1
+        const LabelTable                       *names_ = nullptr;
+        std::vector<std::pair<size_t, LabelId>> unresolved_; // 目标未定义的分支：指令下标和标签
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_COMPILER
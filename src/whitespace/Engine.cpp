@@ -0,0 +1,269 @@
+#include "Engine.h"
+
+#include "RuntimeIO.h"
+#include "Tracing.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+
+namespace Rikkyu::Whitespace {
+    void Engine::run(const Program &program) {
+        utils::NoTrace tracer;
+        execute(program, tracer);
+        output_->flush();
+    }
+
+    void Engine::run(const Program &program, utils::TraceRing &trace) {
+        utils::RingTracer tracer(trace);
+        execute(program, tracer);
+        output_->flush();
+    }
+
+    void Engine::run(const Program &program, utils::CountTracer &counter) {
+        execute(program, counter);
+        output_->flush();
+    }
+
+    template <typename Tracer>
+    void Engine::execute(const Program &program, Tracer &tracer) {
+        if (program.empty()) {
+            return;
+        }
+
+        const Instruction *const code = program.code().data();
+        const Instruction       *ip = code;
+        Memory                  &memory = memory_;
+        BigIntArena             &arena = memory_.arena();
+        utils::BufferedInput    &input = *input_;
+        utils::BufferedOutput   &output = *output_;
+        const std::atomic<bool> *interrupt = interrupt_;
+        callStack_.clear();
+
+#if RIK_WS_COMPUTED_GOTO
+        static const void *const dispatch[] = {
+#define RIK_WS_OPCODE_LABEL(name, mnemonic) &&op_##name,
+            RIK_WS_OPCODES(RIK_WS_OPCODE_LABEL)
+#undef RIK_WS_OPCODE_LABEL
+        };
+#define RIK_WS_CASE(name) op_##name:
+#define RIK_WS_DISPATCH()                                                               \
+    traceStep(tracer, static_cast<size_t>(ip - code), static_cast<uint16_t>(ip->op), memory); \
+    goto *dispatch[static_cast<size_t>(ip->op)]
+#define RIK_WS_NEXT() \
+    ++ip;             \
+    RIK_WS_DISPATCH()
+#define RIK_WS_JUMP(target)                                             \
+    if (interrupt && interrupt->load(std::memory_order_relaxed)) return; \
+    if (arena.full()) memory.collect();                                 \
+    ip = code + (target);                                               \
+    RIK_WS_DISPATCH()
+
+        RIK_WS_DISPATCH();
+        {
+#else
+#define RIK_WS_CASE(name) case Opcode::name:
+#define RIK_WS_NEXT() \
+    ++ip;             \
+    continue
+#define RIK_WS_JUMP(target)                                             \
+    if (interrupt && interrupt->load(std::memory_order_relaxed)) return; \
+    if (arena.full()) memory.collect();                                 \
+    ip = code + (target);                                               \
+    continue
+
+        for (;;) {
+            traceStep(tracer, static_cast<size_t>(ip - code), static_cast<uint16_t>(ip->op), memory);
+            switch (ip->op) {
+#endif
+            RIK_WS_CASE(Guard) {
+                if (!memory.stackRequire(static_cast<size_t>(ip->operand))) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Push) {
+                memory.stackPush(ip->value);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Dup) {
+                memory.stackDuplicateUnchecked();
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Copy) {
+                memory.stackCopyUnchecked(static_cast<size_t>(ip->operand));
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Swap) {
+                memory.stackSwapUnchecked();
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Drop) {
+                memory.stackDiscardUnchecked();
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Slide) {
+                memory.stackSlideUnchecked(static_cast<size_t>(ip->operand));
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Add) {
+                Value b = memory.stackPopUnchecked();
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::add(a, b, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Sub) {
+                Value b = memory.stackPopUnchecked();
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::sub(a, b, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Mul) {
+                Value b = memory.stackPopUnchecked();
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::mul(a, b, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Div) {
+                Value b = memory.stackPopUnchecked();
+                if (b.isZero()) {
+                    utils::ErrorHandler::getInstance().makeError("[WSE07]: Division by Zero.", 0);
+                    return;
+                }
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::div(a, b, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Mod) {
+                Value b = memory.stackPopUnchecked();
+                if (b.isZero()) {
+                    utils::ErrorHandler::getInstance().makeError("[WSE08]: Mod by Zero.", 0);
+                    return;
+                }
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::mod(a, b, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Store) {
+                Value value = memory.stackPopUnchecked();
+                Value address = memory.stackPopUnchecked();
+                if (!memory.heapStore(address, value)) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Retrieve) {
+                Value &top = memory.stackTopUnchecked();
+                if (!memory.heapRetrieve(top, top)) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Call) {
+                if (!callStack_.push(static_cast<uint32_t>(ip - code + 1))) {
+                    utils::ErrorHandler::getInstance().makeError("[WSE07]: Call stack overflow.", 0);
+                    return;
+                }
+                RIK_WS_JUMP(ip->operand);
+            }
+            RIK_WS_CASE(Jump) {
+                RIK_WS_JUMP(ip->operand);
+            }
+            RIK_WS_CASE(JumpZero) {
+                if (memory.stackPopUnchecked().isZero()) {
+                    RIK_WS_JUMP(ip->operand);
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(JumpNegative) {
+                if (memory.stackPopUnchecked().isNegative()) {
+                    RIK_WS_JUMP(ip->operand);
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Return) {
+                uint32_t target;
+                if (!callStack_.pop(target)) {
+                    utils::ErrorHandler::getInstance().makeError("[WSE19]: Return outside of subroutine.", 0);
+                    return;
+                }
+                RIK_WS_JUMP(target);
+            }
+            RIK_WS_CASE(Exit) {
+                return;
+            }
+            RIK_WS_CASE(OutChar) {
+                RuntimeIO::writeChar(output, memory.stackPopUnchecked());
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(OutNum) {
+                RuntimeIO::writeNumber(output, memory.stackPopUnchecked());
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(InChar) {
+                if (!memory.heapStore(memory.stackPopUnchecked(), RuntimeIO::readChar(input))) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(InNum) {
+                Value value;
+                if (!RuntimeIO::readNumber(input, arena, value)) {
+                    return;
+                }
+                if (!memory.heapStore(memory.stackPopUnchecked(), value)) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(Halt) {
+                return;
+            }
+            RIK_WS_CASE(Trap) {
+                utils::ErrorHandler::getInstance().makeError(program.messages()[static_cast<size_t>(ip->operand)], 0);
+                return;
+            }
+            RIK_WS_CASE(AddImmediate) {
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::add(a, ip->value, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(MulImmediate) {
+                Value &a = memory.stackTopUnchecked();
+                a = Arithmetic::mul(a, ip->value, arena);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(LoadImmediate) {
+                Value value;
+                if (!memory.heapRetrieve(ip->value, value)) {
+                    return;
+                }
+                memory.stackPush(value);
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(StoreImmediate) {
+                if (!memory.heapStore(ip->value, memory.stackPopUnchecked())) {
+                    return;
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(DupJumpZero) {
+                if (memory.stackTopUnchecked().isZero()) {
+                    RIK_WS_JUMP(ip->operand);
+                }
+                RIK_WS_NEXT();
+            }
+            RIK_WS_CASE(DupJumpNegative) {
+                if (memory.stackTopUnchecked().isNegative()) {
+                    RIK_WS_JUMP(ip->operand);
+                }
+                RIK_WS_NEXT();
+            }
+        }
+#if !RIK_WS_COMPUTED_GOTO
+        }
+#endif
+
+#undef RIK_WS_CASE
+#undef RIK_WS_NEXT
+#undef RIK_WS_JUMP
+#undef RIK_WS_DISPATCH
+    }
+} // namespace Rikkyu::Whitespace
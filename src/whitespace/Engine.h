@@ -0,0 +1,74 @@
+#pragma once
+#ifndef RIK_WHITESPACE_ENGINE
+#define RIK_WHITESPACE_ENGINE
+
+#include <atomic>
+#include <cstddef>
+
+#include "Bytecode.h"
+#include "CallStack.h"
+#include "Memory.h"
+#include "../utils/BufferedIO/BufferedIO.h"
+#include "../utils/Trace/Trace.h"
+
+// GCC / Clang 支持 labels-as-values，使用直接线索化分派；其他编译器退回 switch 循环
+#if defined(__GNUC__) && !defined(RIK_WS_NO_COMPUTED_GOTO)
+#define RIK_WS_COMPUTED_GOTO 1
+#else
+#define RIK_WS_COMPUTED_GOTO 0
+#endif
+
+namespace Rikkyu::Whitespace {
+    // 字节码执行引擎。与 Runner 不同，这里没有逐条指令的虚函数调用，
+    // 跳转类指令直接改写指令指针。
+    class Engine {
+    public:
+        explicit Engine(size_t callDepthLimit = CallStack::kDefaultLimit)
+            : callStack_(callDepthLimit) {}
+        ~Engine() = default;
+
+        Memory &memory() {
+            return memory_;
+        }
+
+        void setCallDepthLimit(size_t limit) {
+            callStack_.setLimit(limit);
+        }
+
+        // 供 utils::RunnerPool 复用：run() 不清理上一次留下的栈和堆，复用前必须调用
+        void reset() {
+            memory_.reset();
+            callStack_.clear();
+        }
+
+        // 替换输入输出，默认为进程共享的标准输入输出
+        void setIO(utils::BufferedInput &input, utils::BufferedOutput &output) {
+            input_ = &input;
+            output_ = &output;
+        }
+
+        // 另一个线程把 flag 置为 true 后，执行在下一次跳转、调用或返回时停止；nullptr 表示不可中断
+        void setInterrupt(const std::atomic<bool> *flag) {
+            interrupt_ = flag;
+        }
+
+        // 执行完毕（包括出错中止）时刷新输出
+        void run(const Program &program);
+        // 同上，并把每一步执行记录到 trace 中
+        void run(const Program &program, utils::TraceRing &trace);
+        // 同上，只统计执行的指令条数
+        void run(const Program &program, utils::CountTracer &counter);
+
+    private:
+        template <typename Tracer>
+        void execute(const Program &program, Tracer &tracer);
+
+        Memory                 memory_;
+        CallStack              callStack_;
+        const std::atomic<bool> *interrupt_ = nullptr;
+        utils::BufferedInput  *input_ = &utils::BufferedInput::standardInput();
+        utils::BufferedOutput *output_ = &utils::BufferedOutput::standardOutput();
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_ENGINE
@@ -0,0 +1,173 @@
+#pragma once
+#ifndef RIK_WHITESPACE_HEAP
+#define RIK_WHITESPACE_HEAP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "defs/defs.hpp"
+#include "Value.h"
+
+namespace Rikkyu::Whitespace {
+    // 堆的占用情况统计
+    struct HeapStats {
+        size_t densePages = 0;     // 已分配的稠密页数
+        size_t denseCells = 0;     // 稠密页中可用的单元总数
+        size_t sparseEntries = 0;  // 哈希表中的地址数
+        size_t sparseCapacity = 0; // 哈希表的槽位数
+    };
+
+    // Whitespace 堆。
+    // 小的非负地址（绝大多数程序只用这些）落在按需分配的稠密分页数组里，
+    // 负地址和过大的地址落在开放寻址（线性探测）的哈希表里。
+    class Heap {
+    public:
+        static constexpr size_t kPageBits = 12;
+        static constexpr size_t kPageSize = size_t(1) << kPageBits;
+        static constexpr size_t kMaxPages = 256; // 稠密区覆盖 [0, 1M)
+
+        Heap() = default;
+        ~Heap() = default;
+
+        RIK_INLINE void store(int64_t address, Value value) {
+            if (isDense(address)) {
+                page(static_cast<size_t>(address) >> kPageBits)[address & (kPageSize - 1)] = value;
+            } else {
+                sparseStore(address, value);
+            }
+        }
+
+        [[nodiscard]] RIK_INLINE Value retrieve(int64_t address) const {
+            if (isDense(address)) {
+                const size_t index = static_cast<size_t>(address) >> kPageBits;
+                if (index >= pages_.size() || !pages_[index]) {
+                    return Value();
+                }
+                return pages_[index][address & (kPageSize - 1)];
+            }
+            return sparseRetrieve(address);
+        }
+
+        // 清空所有地址。已分配的稠密页保留下来重新填零，代价只和上一次运行用到的页数、哈希表大小有关
+        void reset() {
+            for (auto &p : pages_) {
+                if (p) {
+                    std::fill(p.get(), p.get() + kPageSize, Value());
+                }
+            }
+            if (sparseSize_) {
+                std::fill(slots_.begin(), slots_.end(), Slot{0, Value(), false});
+                sparseSize_ = 0;
+            }
+        }
+
+        // 依次访问已分配空间里的每个值（包括从未写过的单元），visit 可以修改它
+        template <typename Visit>
+        void forEach(Visit &&visit) {
+            for (auto &p : pages_) {
+                if (p) {
+                    std::for_each(p.get(), p.get() + kPageSize, visit);
+                }
+            }
+            for (auto &slot : slots_) {
+                if (slot.used) {
+                    visit(slot.value);
+                }
+            }
+        }
+
+        [[nodiscard]] HeapStats stats() const {
+            HeapStats stats;
+            for (const auto &p : pages_) {
+                if (p) {
+                    ++stats.densePages;
+                }
+            }
+            stats.denseCells = stats.densePages * kPageSize;
+            stats.sparseEntries = sparseSize_;
+            stats.sparseCapacity = slots_.size();
+            return stats;
+        }
+
+    private:
+        struct Slot {
+            int64_t key;
+            Value   value;
+            bool    used;
+        };
+
+        [[nodiscard]] static RIK_INLINE bool isDense(int64_t address) {
+            return address >= 0 && static_cast<uint64_t>(address) < kMaxPages * kPageSize;
+        }
+
+        RIK_INLINE Value *page(size_t index) {
+            if (index >= pages_.size()) {
+                pages_.resize(index + 1);
+            }
+            if (!pages_[index]) {
+                pages_[index] = std::make_unique<Value[]>(kPageSize);
+            }
+            return pages_[index].get();
+        }
+
+        [[nodiscard]] static RIK_INLINE size_t hash(int64_t key) {
+            // 乘法散列，让相近的地址分散到不同槽位
+            uint64_t h = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+
+        void sparseStore(int64_t address, Value value) {
+            // 负载因子超过 1/2 时扩容
+            if ((sparseSize_ + 1) * 2 > slots_.size()) {
+                rehash(slots_.empty() ? 16 : slots_.size() * 2);
+            }
+            const size_t mask = slots_.size() - 1;
+            for (size_t i = hash(address) & mask;; i = (i + 1) & mask) {
+                if (!slots_[i].used) {
+                    slots_[i] = {address, value, true};
+                    ++sparseSize_;
+                    return;
+                }
+                if (slots_[i].key == address) {
+                    slots_[i].value = value;
+                    return;
+                }
+            }
+        }
+
+        [[nodiscard]] Value sparseRetrieve(int64_t address) const {
+            if (slots_.empty()) {
+                return Value();
+            }
+            const size_t mask = slots_.size() - 1;
+            for (size_t i = hash(address) & mask;; i = (i + 1) & mask) {
+                if (!slots_[i].used) {
+                    return Value();
+                }
+                if (slots_[i].key == address) {
+                    return slots_[i].value;
+                }
+            }
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Slot> old(capacity, Slot{0, Value(), false});
+            old.swap(slots_);
+            sparseSize_ = 0;
+            for (const auto &slot : old) {
+                if (slot.used) {
+                    sparseStore(slot.key, slot.value);
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Value[]>> pages_;
+        std::vector<Slot>                     slots_;
+        size_t                                sparseSize_ = 0;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_HEAP
@@ -0,0 +1,176 @@
+#include "IRLowering.h"
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::Whitespace {
+    IR::Operand IRLowering::operand(const TacOperand &operand, size_t position) {
+        switch (operand.kind) {
+        case TacOperand::Kind::Entry: {
+            // 入口值在第一次使用时才从栈上读出，块内运行时栈保持不动
+            const auto index = static_cast<size_t>(operand.index);
+            if (entries_.size() <= index) {
+                entries_.resize(index + 1, -1);
+            }
+            if (entries_[index] < 0) {
+                entries_[index] = module_->newRegister();
+                module_->emit(IR::Instruction::unary(IR::Op::Peek, entries_[index], IR::Operand::i(operand.index)));
+            }
+            return IR::Operand::r(entries_[index]);
+        }
+        case TacOperand::Kind::Temp:
+            return IR::Operand::r(temps_[static_cast<size_t>(operand.index)]);
+        default:
+            if (!operand.value.isSmall()) {
+                utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE16]: Literal too large for the 64-bit backends: ", operand.value.toString()), position);
+                failed_ = true;
+                return IR::Operand::i(0);
+            }
+            return IR::Operand::i(operand.value.smallValue());
+        }
+    }
+
+    bool IRLowering::lower(const Program &program, IR::Module &module) {
+        module = IR::Module();
+        module_ = &module;
+        failed_ = false;
+
+        module.setTrap(IR::Trap::StackUnderflow, "[WSE01]: Stack underflow");
+        module.setTrap(IR::Trap::DivisionByZero, "[WSE07]: Division by Zero.");
+        module.setTrap(IR::Trap::ModuloByZero, "[WSE08]: Mod by Zero.");
+        module.setTrap(IR::Trap::CallOverflow, "[WSE07]: Call stack overflow.");
+        module.setTrap(IR::Trap::ReturnOutsideCall, "[WSE19]: Return outside of subroutine.");
+        module.setTrap(IR::Trap::Overflow, "[WSE17]: Integer overflow in 64-bit backend");
+        module.setTrap(IR::Trap::InvalidNumber, "[WSE14]: Invalid number input");
+        module.messages = program.messages();
+
+        const ControlFlowGraph cfg(program);
+        const auto            &code = program.code();
+
+        // 字节码下标 -> IR 下标；跳转目标在所有块生成之后再回填
+        std::vector<int32_t>                       start(code.size() + 1, 0);
+        std::vector<std::pair<size_t, size_t>>     fixups;
+
+        // 不可达的块也照常生成：CALL 的返回点必须紧跟在 CALL 之后，交给死代码消除去删
+        for (const auto &block : cfg.blocks()) {
+            start[block.begin] = static_cast<int32_t>(module.code.size());
+            const LoweredBlock lowered = cfg.lower(program, block);
+            entries_.clear();
+            temps_.assign(static_cast<size_t>(lowered.temps), -1);
+
+            // 静态证明入口深度足够的块，块内的 GUARD 都不会失败
+            const bool proven = cfg.proven(block);
+            for (const auto &instruction : lowered.code) {
+                if (instruction.op == Opcode::Guard) {
+                    if (!proven) {
+                        module.emit(IR::Instruction::unary(IR::Op::Require, -1, operand(instruction.a, block.begin)));
+                    }
+                    continue;
+                }
+                const IR::Operand a = operand(instruction.a, block.begin);
+                IR::Operand       b;
+                if (instruction.op == Opcode::Store || (instruction.op >= Opcode::Add && instruction.op <= Opcode::Mod)) {
+                    b = operand(instruction.b, block.begin);
+                }
+                int32_t dst = -1;
+                if (instruction.dst >= 0) {
+                    dst = module.newRegister();
+                    temps_[static_cast<size_t>(instruction.dst)] = dst;
+                }
+
+                switch (instruction.op) {
+                case Opcode::Add:
+                case Opcode::Sub:
+                case Opcode::Mul:
+                case Opcode::Div:
+                case Opcode::Mod: {
+                    static const IR::Op ops[] = {IR::Op::Add, IR::Op::Sub, IR::Op::Mul, IR::Op::Div, IR::Op::Mod};
+                    module.emit(IR::Instruction::binary(ops[static_cast<int>(instruction.op) - static_cast<int>(Opcode::Add)], dst, a, b));
+                    break;
+                }
+                case Opcode::Retrieve:
+                    module.emit(IR::Instruction::unary(IR::Op::LoadHeap, dst, a));
+                    break;
+                case Opcode::Store:
+                    module.emit(IR::Instruction::binary(IR::Op::StoreHeap, -1, a, b));
+                    break;
+                case Opcode::OutChar:
+                    module.emit(IR::Instruction::unary(IR::Op::WriteChar, -1, a));
+                    break;
+                case Opcode::OutNum:
+                    module.emit(IR::Instruction::unary(IR::Op::WriteNumber, -1, a));
+                    break;
+                case Opcode::InChar:
+                case Opcode::InNum: {
+                    const int32_t input = module.newRegister();
+                    module.emit(IR::Instruction::of(instruction.op == Opcode::InChar ? IR::Op::ReadChar : IR::Op::ReadNumber, input));
+                    module.emit(IR::Instruction::binary(IR::Op::StoreHeap, -1, a, IR::Operand::r(input)));
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            // 条件和要压回的值都先读出来，再移动栈指针，避免写回时覆盖还没读的入口值
+            const Opcode terminator = lowered.terminator;
+            const bool   conditional = terminator == Opcode::JumpZero || terminator == Opcode::JumpNegative ||
+                                     terminator == Opcode::DupJumpZero || terminator == Opcode::DupJumpNegative;
+            IR::Operand condition;
+            if (conditional) {
+                condition = operand(lowered.condition, block.begin);
+            }
+            std::vector<IR::Operand> pushed;
+            pushed.reserve(lowered.pushed.size());
+            for (const auto &value : lowered.pushed) {
+                pushed.push_back(operand(value, block.begin));
+            }
+            if (lowered.consumed) {
+                module.emit(IR::Instruction::unary(IR::Op::Discard, -1, IR::Operand::i(static_cast<int64_t>(lowered.consumed))));
+            }
+            for (const auto &value : pushed) {
+                module.emit(IR::Instruction::unary(IR::Op::Push, -1, value));
+            }
+
+            auto branch = [&](IR::Op op, const IR::Operand &a) {
+                fixups.emplace_back(module.emit(IR::Instruction::branch(op, 0, a)), static_cast<size_t>(lowered.target));
+            };
+            switch (terminator) {
+            case Opcode::Call:
+                branch(IR::Op::Call, IR::Operand());
+                break;
+            case Opcode::Jump:
+                branch(IR::Op::Jump, IR::Operand());
+                break;
+            case Opcode::JumpZero:
+            case Opcode::DupJumpZero:
+                branch(IR::Op::JumpZero, condition);
+                break;
+            case Opcode::JumpNegative:
+            case Opcode::DupJumpNegative:
+                branch(IR::Op::JumpNegative, condition);
+                break;
+            case Opcode::Return:
+                module.emit(IR::Instruction::of(IR::Op::Return));
+                break;
+            case Opcode::Exit:
+            case Opcode::Halt:
+                module.emit(IR::Instruction::of(IR::Op::Halt));
+                break;
+            case Opcode::Trap:
+                module.emit(IR::Instruction::unary(IR::Op::Fail, -1, IR::Operand::i(lowered.target)));
+                break;
+            default:
+                break;
+            }
+        }
+        start[code.size()] = static_cast<int32_t>(module.code.size());
+        module.emit(IR::Instruction::of(IR::Op::Halt));
+
+        for (const auto &[index, target] : fixups) {
+            module.code[index].target = start[target];
+        }
+        module_ = nullptr;
+        return !failed_;
+    }
+} // namespace Rikkyu::Whitespace
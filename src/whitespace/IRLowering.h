@@ -0,0 +1,37 @@
+#pragma once
+#ifndef RIK_WHITESPACE_IR_LOWERING
+#define RIK_WHITESPACE_IR_LOWERING
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../ir/IR.h"
+#include "Bytecode.h"
+#include "StackAnalysis.h"
+
+namespace Rikkyu::Whitespace {
+    // 把字节码降低为共用 IR，之后的优化和执行（IR::VM / IR::CBackend）与 Brainfuck 共用。
+    //   - 每个基本块先经 ControlFlowGraph 降低为三地址形式，入口值用 Peek 读出，
+    //     块结束时用 Discard / Push 统一写回；
+    //   - 每条 GUARD 在原位置生成 Require，保证检查失败之前的副作用照常发生；静态证明深度足够的块不生成；
+    //   - 整数使用 64 位，溢出时以 WSE17 报错（大整数程序请使用解释器）。
+    class IRLowering {
+    public:
+        IRLowering() = default;
+        ~IRLowering() = default;
+
+        // 含有超出 64 位的字面量时报告 WSE16 并返回 false
+        bool lower(const Program &program, IR::Module &module);
+
+    private:
+        IR::Operand operand(const TacOperand &operand, size_t position);
+
+        IR::Module          *module_ = nullptr;
+        std::vector<int32_t> entries_; // 入口值 -> 寄存器，-1 表示还没有读出
+        std::vector<int32_t> temps_;   // 临时值 -> 寄存器
+        bool                 failed_ = false;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_IR_LOWERING
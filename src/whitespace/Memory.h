@@ -2,104 +2,146 @@
 #ifndef RIK_WHITESPACE_MEMORY
 #define RIK_WHITESPACE_MEMORY
 
-#include <map>
-#include <stack>
+#include <vector>
 #include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+#include "Heap.h"
+#include "Value.h"
 
 namespace Rikkyu::Whitespace {
     class Memory {
     public:
-        Memory() = default;
+        // 栈的初始预留容量，避免小程序在运行中反复扩容
+        static constexpr size_t kStackReserve = 1024;
+
+        Memory() { stack_.reserve(kStackReserve); }
         ~Memory() = default;
 
-        RIK_INLINE void stackPush(int value) {
-            stack_.push(value);
+        RIK_INLINE void stackPush(Value value) {
+            stack_.push_back(value);
         }
 
-        RIK_INLINE int stackPop() {
+        RIK_INLINE Value stackPop() {
             if (stack_.empty()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE01]: Stack underflow - 无法从空栈中弹出元素", 0);
+                return Value();
             }
-            int value = stack_.top();
-            stack_.pop();
+            Value value = stack_.back();
+            stack_.pop_back();
             return value;
         }
 
-        [[nodiscard]] RIK_INLINE int stackPeek() const {
+        [[nodiscard]] RIK_INLINE Value stackPeek() const {
             if (stack_.empty()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE02]: Stack is Empty - 无法查看空栈的顶部元素", 0);
+                return Value();
             }
-            return stack_.top();
+            return stack_.back();
         }
 
         RIK_INLINE void stackDuplicate() {
             if (stack_.empty()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE02]: Stack is Empty - 无法复制空栈的顶部元素", 0);
+                return;
             }
-            stack_.push(stack_.top());
+            stack_.push_back(stack_.back());
         }
 
         RIK_INLINE void stackCopy(int n) {
-            if (stack_.size() <= static_cast<size_t>(n) || n < 0) {
+            if (n < 0 || stack_.size() <= static_cast<size_t>(n)) {
                 utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE03]: Invalid access for main stack - 无效的栈访问索引: ", std::to_string(n)), n);
+                return;
             }
-
-            std::stack<int> temp;
-            for (int i = 0; i < n; ++i) {
-                temp.push(stackPop());
-            }
-
-            int value = stack_.top();
-
-            while (!temp.empty()) {
-                stack_.push(temp.top());
-                temp.pop();
-            }
-
-            stack_.push(value);
+            stack_.push_back(stack_[stack_.size() - 1 - static_cast<size_t>(n)]);
         }
 
         RIK_INLINE void stackSwap() {
             if (stack_.size() < 2) {
                 utils::ErrorHandler::getInstance().makeError("[WSE04]: Elements in stack are not enough to do swap operation - 栈中元素不足，无法执行交换操作", 0);
+                return;
             }
-
-            int a = stackPop();
-            int b = stackPop();
-
-            stack_.push(a);
-            stack_.push(b);
+            std::swap(stack_[stack_.size() - 1], stack_[stack_.size() - 2]);
         }
 
         RIK_INLINE void stackDiscard() {
             if (stack_.empty()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE02]: Stack is Empty - 无法丢弃空栈的元素", 0);
+                return;
             }
-            stack_.pop();
+            stack_.pop_back();
         }
 
         RIK_INLINE void stackSlide(int n) {
-            if (stack_.size() < static_cast<size_t>(n) || n < 0) {
+            if (n < 0 || stack_.size() <= static_cast<size_t>(n)) {
                 utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE02]: Stack slide count is invalid - 无效的栈滑动数量: ", std::to_string(n)), n);
+                return;
             }
+            // 栈顶元素直接落到被滑走区域的最底端，然后整体截断
+            stack_[stack_.size() - 1 - static_cast<size_t>(n)] = stack_.back();
+            stack_.resize(stack_.size() - static_cast<size_t>(n));
+        }
 
-            int top = stackPop();
-            for (int i = 0; i < n; ++i) {
-                stackPop();
+        // 以下 Unchecked 版本不做下溢检查，只能在 stackRequire 已经
+        // 为整个基本块验证过栈深度之后使用
+        RIK_INLINE bool stackRequire(size_t depth) const {
+            if (stack_.size() < depth) {
+                utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE01]: Stack underflow - 基本块需要的栈深度为 ", std::to_string(depth), "，实际只有 ", std::to_string(stack_.size())), 0);
+                return false;
             }
-            stack_.push(top);
+            return true;
+        }
+
+        RIK_INLINE Value stackPopUnchecked() {
+            Value value = stack_.back();
+            stack_.pop_back();
+            return value;
+        }
+
+        [[nodiscard]] RIK_INLINE Value &stackTopUnchecked() {
+            return stack_.back();
+        }
+
+        RIK_INLINE void stackDuplicateUnchecked() {
+            stack_.push_back(stack_.back());
+        }
+
+        RIK_INLINE void stackCopyUnchecked(size_t n) {
+            stack_.push_back(stack_[stack_.size() - 1 - n]);
+        }
+
+        RIK_INLINE void stackSwapUnchecked() {
+            std::swap(stack_[stack_.size() - 1], stack_[stack_.size() - 2]);
+        }
+
+        RIK_INLINE void stackDiscardUnchecked() {
+            stack_.pop_back();
         }
 
-        RIK_INLINE void heapStore(int address, int value) {
-            heap_[address] = value;
+        RIK_INLINE void stackSlideUnchecked(size_t n) {
+            stack_[stack_.size() - 1 - n] = stack_.back();
+            stack_.resize(stack_.size() - n);
         }
 
-        RIK_INLINE int heapRetrieve(int address) {
-            auto it = heap_.find(address);
-            if (it == heap_.end()) {
-                return 0;
+        [[nodiscard]] RIK_INLINE bool heapStore(Value address, Value value) {
+            if (!address.isSmall()) {
+                reportHeapAddress(address);
+                return false;
             }
-            return it->second;
+            heap_.store(address.smallValue(), value);
+            return true;
+        }
+
+        [[nodiscard]] RIK_INLINE bool heapRetrieve(Value address, Value &value) const {
+            if (!address.isSmall()) {
+                reportHeapAddress(address);
+                return false;
+            }
+            value = heap_.retrieve(address.smallValue());
+            return true;
+        }
+
+        [[nodiscard]] HeapStats heapStats() const {
+            return heap_.stats();
         }
 
         [[nodiscard]] RIK_INLINE bool stackEmpty() const {
@@ -110,10 +152,37 @@ namespace Rikkyu::Whitespace {
             return stack_.size();
         }
 
+        [[nodiscard]] RIK_INLINE BigIntArena &arena() {
+            return arena_;
+        }
+
+        // 回收 arena 里不再被栈和堆引用的大整数。之后所有指向大整数的 Value 都可能换了地址，
+        // 只能在没有其他地方持有 Value 的安全点调用（两条指令之间）
+        void collect() {
+            arena_.collect([this](auto &&relocate) {
+                for (Value &value : stack_) {
+                    relocate(value);
+                }
+                heap_.forEach(relocate);
+            });
+        }
+
+        // 回到刚构造时的状态，保留栈和堆已经分配的空间
+        void reset() {
+            stack_.clear();
+            heap_.reset();
+            arena_.clear();
+        }
+
     private:
-        std::stack<int>    stack_;
-        std::map<int, int> heap_;
+        static void reportHeapAddress(Value address) {
+            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE13]: Heap address out of range - 堆地址超出范围: ", address.toString()), 0);
+        }
+
+        std::vector<Value> stack_;
+        Heap               heap_;
+        BigIntArena        arena_;
     };
 } // namespace Rikkyu::Whitespace
 
-#endif // RIK_WHITESPACE_MEMORY
\ No newline at end of file
+#endif // RIK_WHITESPACE_MEMORY
@@ -0,0 +1,167 @@
+#include "Peephole.h"
+
+namespace Rikkyu::Whitespace {
+    namespace {
+        // 编译期常量折叠，统一走 BigInt，结果由 Literal 持有
+        Literal fold(Opcode op, Value a, Value b) {
+            BigInt x = a.toBig();
+            BigInt y = b.toBig();
+            BigInt r;
+            switch (op) {
+            case Opcode::Add:
+                r = BigInt::add(x, y);
+                break;
+            case Opcode::Sub:
+                r = BigInt::sub(x, y);
+                break;
+            case Opcode::Mul:
+                r = BigInt::mul(x, y);
+                break;
+            case Opcode::Div:
+                BigInt::divMod(x, y, &r, nullptr);
+                break;
+            default:
+                BigInt::divMod(x, y, nullptr, &r);
+                break;
+            }
+            return Literal(std::move(r));
+        }
+    } // namespace
+
+    void PeepholeOptimizer::optimize(Program &program) {
+        auto        &code = program.code();
+        const size_t size = code.size();
+
+        // 跳转目标和 CALL 的返回点都是融合的边界
+        std::vector<bool> target(size + 1, false);
+        for (size_t i = 0; i < size; ++i) {
+            if (Program::isBranch(code[i].op)) {
+                target[static_cast<size_t>(code[i].operand)] = true;
+            }
+            if (code[i].op == Opcode::Call) {
+                target[i + 1] = true;
+            }
+        }
+
+        std::vector<int32_t> remap(size + 1, 0);
+        bool                 pendingBoundary = false;
+        out_.clear();
+        out_.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            remap[i] = static_cast<int32_t>(out_.size());
+            const bool boundary = target[i] || pendingBoundary;
+
+            // 不需要任何栈深度的检查直接删掉，边界属性交给下一条指令
+            if (code[i].op == Opcode::Guard && code[i].operand == 0) {
+                pendingBoundary = boundary;
+                continue;
+            }
+
+            pendingBoundary = false;
+            out_.push_back({code[i], boundary});
+            while (reduce(program)) {
+            }
+        }
+        remap[size] = static_cast<int32_t>(out_.size());
+
+        code.clear();
+        for (auto &slot : out_) {
+            if (Program::isBranch(slot.instruction.op)) {
+                slot.instruction.operand = remap[static_cast<size_t>(slot.instruction.operand)];
+            }
+            code.push_back(slot.instruction);
+        }
+        out_.clear();
+    }
+
+    const Instruction *PeepholeOptimizer::tail(size_t n) const {
+        if (out_.size() <= n) {
+            return nullptr;
+        }
+        for (size_t i = out_.size() - n; i < out_.size(); ++i) {
+            if (out_[i].boundary) {
+                return nullptr;
+            }
+        }
+        return &out_[out_.size() - 1 - n].instruction;
+    }
+
+    void PeepholeOptimizer::replace(size_t count, const Instruction &instruction) {
+        const bool boundary = out_[out_.size() - count].boundary;
+        out_.resize(out_.size() - count);
+        out_.push_back({instruction, boundary});
+    }
+
+    bool PeepholeOptimizer::reduce(Program &program) {
+        const Instruction *last = tail(0);
+        if (!last) {
+            return false;
+        }
+
+        const Instruction *prev = tail(1);
+        const Instruction *prev2 = tail(2);
+        const Opcode       op = last->op;
+        switch (op) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod: {
+            if (!prev || prev->op != Opcode::Push) {
+                return false;
+            }
+            const Value b = prev->value;
+            if (prev2 && prev2->op == Opcode::Push && !((op == Opcode::Div || op == Opcode::Mod) && b.isZero())) {
+                Literal folded = fold(op, prev2->value, b);
+                program.keepLiteral(folded);
+                replace(3, {Opcode::Push, 0, folded.value});
+                return true;
+            }
+            if (op == Opcode::Add || op == Opcode::Mul) {
+                replace(2, {op == Opcode::Add ? Opcode::AddImmediate : Opcode::MulImmediate, 0, b});
+                return true;
+            }
+            if (op == Opcode::Sub && b.isSmall() && Value::fitsSmall(-static_cast<int64_t>(b.smallValue()))) {
+                replace(2, {Opcode::AddImmediate, 0, Value::small(-b.smallValue())});
+                return true;
+            }
+            return false;
+        }
+        case Opcode::AddImmediate: {
+            if (!prev || prev->op != Opcode::AddImmediate || !prev->value.isSmall() || !last->value.isSmall()) {
+                return false;
+            }
+            const int64_t sum = static_cast<int64_t>(prev->value.smallValue()) + last->value.smallValue();
+            if (!Value::fitsSmall(sum)) {
+                return false;
+            }
+            replace(2, {Opcode::AddImmediate, 0, Value::small(static_cast<intptr_t>(sum))});
+            return true;
+        }
+        case Opcode::Retrieve: {
+            if (!prev || prev->op != Opcode::Push || !prev->value.isSmall()) {
+                return false;
+            }
+            replace(2, {Opcode::LoadImmediate, 0, prev->value});
+            return true;
+        }
+        case Opcode::Store: {
+            if (!prev || prev->op != Opcode::Swap || !prev2 || prev2->op != Opcode::Push || !prev2->value.isSmall()) {
+                return false;
+            }
+            replace(3, {Opcode::StoreImmediate, 0, prev2->value});
+            return true;
+        }
+        case Opcode::JumpZero:
+        case Opcode::JumpNegative: {
+            if (!prev || prev->op != Opcode::Dup) {
+                return false;
+            }
+            replace(2, {op == Opcode::JumpZero ? Opcode::DupJumpZero : Opcode::DupJumpNegative, last->operand, Value()});
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+} // namespace Rikkyu::Whitespace
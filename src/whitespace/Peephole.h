@@ -0,0 +1,44 @@
+#pragma once
+#ifndef RIK_WHITESPACE_PEEPHOLE
+#define RIK_WHITESPACE_PEEPHOLE
+
+#include <vector>
+
+#include "Bytecode.h"
+
+namespace Rikkyu::Whitespace {
+    // 字节码上的窥孔优化：常量折叠，并把常见的指令序列融合成带立即数的超级指令
+    //   PUSH a; PUSH b; ADD     ->  PUSH (a + b)    （SUB / MUL / DIV / MOD 同理）
+    //   PUSH k; ADD / SUB / MUL ->  ADDI k / ADDI -k / MULI k
+    //   ADDI a; ADDI b          ->  ADDI (a + b)
+    //   PUSH addr; RETRIEVE     ->  LOADI addr
+    //   PUSH addr; SWAP; STORE  ->  STOREI addr
+    //   DUP; JUMP_ZERO / JUMP_NEG ->  DUPJZ / DUPJN
+    //   GUARD 0                 ->  删除
+    // 融合不会跨过跳转目标和调用的返回点，优化后所有跳转目标都会重新映射。
+    class PeepholeOptimizer {
+    public:
+        PeepholeOptimizer() = default;
+        ~PeepholeOptimizer() = default;
+
+        void optimize(Program &program);
+
+    private:
+        // 输出序列中的一条指令，boundary 表示它是某个跳转的目标（不能被融合进前一条）
+        struct Slot {
+            Instruction instruction;
+            bool        boundary;
+        };
+
+        // 尝试对输出序列的末尾做一次化简，成功返回 true
+        bool reduce(Program &program);
+        // 取末尾第 n 条（0 为最后一条），要求它和它之后的指令之间没有跳转目标
+        const Instruction *tail(size_t n) const;
+        // 用一条新指令替换末尾的 count 条，新指令继承第一条的 boundary
+        void replace(size_t count, const Instruction &instruction);
+
+        std::vector<Slot> out_;
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_PEEPHOLE
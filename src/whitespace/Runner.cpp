@@ -1,28 +1,111 @@
 #include "Runner.h"
+
+#include <utility>
+
 #include "Memory.h"
 #include "AbstractExpression.h"
+#include "Tokenizer.h"
+#include "Tracing.h"
+#include "expressions/FlowExpressions.h"
 
 namespace Rikkyu::Whitespace {
-    Runner::Runner() : memory_(new Memory()), callStack_() {}
+    Runner::Runner(size_t callDepthLimit) : memory_(std::make_unique<Memory>()), callStack_(callDepthLimit) {}
+
+    // Memory 在头文件里只有前置声明，析构函数必须放在这里
+    Runner::~Runner() = default;
+
+    void Runner::reset() {
+        memory_->reset();
+        callStack_.clear();
+    }
 
     Memory &Runner::memory() {
         return *memory_;
     }
 
-    void Runner::run(const ExpressionVector &expressions, bool showIR) {
-        size_t pc = 0;
+    void Runner::run(const ExpressionVector &expressions) {
+        utils::NoTrace tracer;
+        incremental_ = false;
+        execute(expressions, tracer, nullptr);
+    }
+
+    void Runner::run(const ExpressionVector &expressions, utils::TraceRing &trace) {
+        // 表达式的 IR 助记符与字节码一致，跟踪开始前一次性换算成操作码
+        const auto            names = traceOpcodeNames();
+        std::vector<uint16_t> ops(expressions.size(), kTraceLabel);
+        for (size_t i = 0; i < expressions.size(); ++i) {
+            const std::string ir = expressions[i]->toIR();
+            const std::string mnemonic = ir.substr(0, ir.find(' '));
+            for (size_t op = 0; op < names.size(); ++op) {
+                if (names[op] == mnemonic) {
+                    ops[i] = static_cast<uint16_t>(op);
+                    break;
+                }
+            }
+        }
+
+        utils::RingTracer tracer(trace);
+        incremental_ = false;
+        execute(expressions, tracer, ops.data());
+    }
+
+    void Runner::resume(const ExpressionVector &expressions, size_t from) {
+        utils::NoTrace tracer;
+        incremental_ = true;
+        execute(expressions, tracer, nullptr, from);
+    }
+
+    void Runner::finish() {
+        if (waitingFor_ != -1) {
+            incremental_ = false;
+            resolve(std::exchange(waitingFor_, -1));
+        }
+    }
+
+    template <typename Tracer>
+    void Runner::execute(const ExpressionVector &expressions, Tracer &tracer, const uint16_t *ops, size_t from) {
+        programEnd_ = expressions.size();
+        jumpTo_ = static_cast<size_t>(-1);
+        if (from == 0) {
+            callStack_.clear();
+            labels_.clear();
+            waitingFor_ = -1;
+        }
+
+        // 先登记所有标签，向前跳转 / 调用才能找到目标
+        for (size_t i = from; i < expressions.size(); ++i) {
+            if (auto mark = dynamic_cast<const FlowMarkExpression *>(expressions[i].get())) {
+                setLabel(mark->label(), mark->position());
+            }
+        }
+
+        size_t &pc = pc_;
+        pc = from;
+        if (waitingFor_ != -1) {
+            // 上一次停在跳向未定义标签的地方：标签仍未定义就继续等，新追加的代码也不会被执行到
+            pc = lookup(waitingFor_);
+            if (pc == static_cast<size_t>(-1)) {
+                return;
+            }
+            waitingFor_ = -1;
+        }
         while (pc < expressions.size()) {
-            if (showIR) {
-                std::cout << "[" << pc << "] " << expressions[pc]->toIR() << std::endl;
+            if constexpr (Tracer::enabled) {
+                traceStep(tracer, pc, ops[pc], *memory_);
             }
             expressions[pc]->run(*this);
             if (jumpTo_ != static_cast<size_t>(-1)) {
+                // 跳转处是安全点，循环产生的大整数在这里回收
+                if (memory_->arena().full()) {
+                    memory_->collect();
+                }
                 pc = jumpTo_;
                 jumpTo_ = static_cast<size_t>(-1);
             } else { 
                 ++pc;
             }
         }
+        output_->flush();
     }
 
     void Runner::reportError(const std::string &message, size_t position) {
@@ -33,49 +116,76 @@ namespace Rikkyu::Whitespace {
         utils::ErrorHandler::getInstance().makeWarning(message, position);
     }
 
-    void Runner::setLabel(const std::string &label, size_t position) {
-        labels_[label] = position;
+    void Runner::setLabel(LabelId label, size_t position) {
+        if (static_cast<size_t>(label) >= labels_.size()) {
+            labels_.resize(static_cast<size_t>(label) + 1, static_cast<size_t>(-1));
+        }
+        // 重复定义的标签以第一次出现为准，与 Compiler 一致
+        if (labels_[static_cast<size_t>(label)] == static_cast<size_t>(-1)) {
+            labels_[static_cast<size_t>(label)] = position;
+        }
+    }
+
+    size_t Runner::lookup(LabelId label) const {
+        return static_cast<size_t>(label) < labels_.size() ? labels_[static_cast<size_t>(label)] : static_cast<size_t>(-1);
     }
 
-    void Runner::jump(const std::string &label) {
-        auto it = labels_.find(label);
-        if (it == labels_.end()) {
-            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE05]: Undefined Label: ", label), 0);
+    size_t Runner::resolve(LabelId label) {
+        const size_t target = lookup(label);
+        if (target == static_cast<size_t>(-1) && incremental_) {
+            // 标签可能在之后输入的代码里，先停下等待
+            waitingFor_ = label;
+            return programEnd_;
+        }
+        if (target == static_cast<size_t>(-1)) {
+            // 没有标签表时只能给出编号
+            const std::string name = labelNames_ ? labelNames_->name(label) : std::to_string(label);
+            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE05]: Undefined Label: ", name), 0);
+            return programEnd_;
         }
-        jumpTo_ = it->second;
+        return target;
     }
 
-    void Runner::jumpIfZero(const std::string &label) {
-        if (memory_->stackPop() == 0) {
+    void Runner::jump(LabelId label) {
+        jumpTo_ = resolve(label);
+    }
+
+    void Runner::jumpIfZero(LabelId label) {
+        if (memory_->stackPopUnchecked().isZero()) {
             jump(label);
         }
     }
 
-    void Runner::jumpIfNegative(const std::string &label) {
-        if (memory_->stackPop() < 0) {
+    void Runner::jumpIfNegative(LabelId label) {
+        if (memory_->stackPopUnchecked().isNegative()) {
             jump(label);
         }
     }
 
-    void Runner::call(const std::string &label) {
-        auto it = labels_.find(label);
-        if (it == labels_.end()) {
-            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE05]: Undefined Label: ", label), 0);
+    void Runner::call(LabelId label) {
+        if (!callStack_.push(static_cast<uint32_t>(pc_ + 1))) {
+            utils::ErrorHandler::getInstance().makeError("[WSE07]: Call stack overflow.", 0);
+            halt();
+            return;
         }
-        callStack_.push(jumpTo_ != static_cast<size_t>(-1) ? jumpTo_ : static_cast<size_t>(-1));
-        jumpTo_ = it->second;
+        jumpTo_ = resolve(label);
     }
 
     void Runner::returnFromCall() {
-        if (callStack_.empty()) {
-            utils::ErrorHandler::getInstance().makeError("[WSE07]: Call stack overflow.", 0);
+        uint32_t target;
+        if (!callStack_.pop(target)) {
+            utils::ErrorHandler::getInstance().makeError("[WSE19]: Return outside of subroutine.", 0);
+            halt();
+            return;
         }
-        jumpTo_ = callStack_.top();
-        callStack_.pop();
+        jumpTo_ = target;
     }
 
     void Runner::exit() {
-        jumpTo_ = static_cast<size_t>(-1);
-        utils::ErrorHandler::getInstance().makeError("[WSE06]: Program unexpected terminal.", 0);
+        halt();
+    }
+
+    void Runner::halt() {
+        jumpTo_ = programEnd_;
     }
-} // namespace Rikkyu::Whitespace
\ No newline at end of file
+} // namespace Rikkyu::Whitespace
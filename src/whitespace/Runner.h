@@ -2,19 +2,21 @@
 #ifndef RIK_WHITESPACE_RUNNER
 #define RIK_WHITESPACE_RUNNER
 
-#include <map>
 #include <memory>
-#include <stack>
 #include <string>
 #include <vector>
 #include <iostream>
 
+#include "../utils/BufferedIO/BufferedIO.h"
 #include "../utils/ErrorHandler/ErrorHandler.h"
 #include "../utils/StringBuilder/StringBuilder.h"
+#include "../utils/Trace/Trace.h"
 #include "AbstractExpression.h"
+#include "CallStack.h"
 
 namespace Rikkyu::Whitespace {
     class Memory;
+    class LabelTable;
     class Expression;
     
     using ExpressionPtr = std::unique_ptr<Expression>;
@@ -22,36 +24,99 @@ namespace Rikkyu::Whitespace {
     
     class Runner {
     public:
-        Runner();
-        ~Runner() = default;
+        explicit Runner(size_t callDepthLimit = CallStack::kDefaultLimit);
+        ~Runner();
         
         Memory &memory();
+
+        // 供 utils::RunnerPool 复用：清空栈、堆和调用栈，保留已经分配的空间
+        void reset();
+
+        void setCallDepthLimit(size_t limit) {
+            callStack_.setLimit(limit);
+        }
+
+        utils::BufferedInput &input() {
+            return *input_;
+        }
+
+        utils::BufferedOutput &output() {
+            return *output_;
+        }
+
+        // 替换输入输出，默认为进程共享的标准输入输出
+        void setIO(utils::BufferedInput &input, utils::BufferedOutput &output) {
+            input_ = &input;
+            output_ = &output;
+        }
         
-        void run(const ExpressionVector &expressions, bool showIR = false);
+        // 解析时的标签表，报告未定义标签时用它给出标签的 0/1 形式。必须比 Runner 活得久
+        void setLabels(const LabelTable &labels) {
+            labelNames_ = &labels;
+        }
+
+        void run(const ExpressionVector &expressions);
+
+        // 同上，并把每一步执行记录到 trace 中，用 utils::decodeTrace 转换成文本
+        void run(const ExpressionVector &expressions, utils::TraceRing &trace);
+
+        // 增量执行（REPL）：expressions 是在上一次执行的程序末尾追加得到的，从下标 from 开始继续执行。
+        // 栈、堆、调用栈和已登记的标签都保留，只登记新追加部分的标签。
+        // 跳转 / 调用的标签还没有定义时不报错，停下来等之后追加的代码定义它，再从标签处继续，
+        // 因此整个会话的执行结果与一次执行拼接起来的程序相同
+        void resume(const ExpressionVector &expressions, size_t from);
+
+        // 增量执行结束：还在等的标签按未定义报错
+        void finish();
+
+        // 是否停在一个尚未定义的标签上
+        [[nodiscard]] bool waiting() const {
+            return waitingFor_ != -1;
+        }
         
         void reportError(const std::string &message, size_t position);
         
         void reportWarning(const std::string &message, size_t position);
         
-        void setLabel(const std::string &label, size_t position);
+        void setLabel(LabelId label, size_t position);
         
-        void jump(const std::string &label);
+        void jump(LabelId label);
         
-        void jumpIfZero(const std::string &label);
+        void jumpIfZero(LabelId label);
         
-        void jumpIfNegative(const std::string &label);
+        void jumpIfNegative(LabelId label);
         
-        void call(const std::string &label);
+        void call(LabelId label);
         
         void returnFromCall();
         
+        // 正常结束程序
         void exit();
+
+        // 立即结束当前 run()，用于块入口检查失败等无法继续执行的情况
+        void halt();
         
     private:
-        Memory *memory_;
-        std::map<std::string, size_t> labels_;
-        std::stack<size_t> callStack_;
+        template <typename Tracer>
+        void execute(const ExpressionVector &expressions, Tracer &tracer, const uint16_t *ops, size_t from = 0);
+
+        // 标签对应的表达式下标；未定义时报错（增量执行时改为等待）并返回程序末尾
+        size_t resolve(LabelId label);
+
+        // 标签对应的表达式下标，未定义为 -1
+        [[nodiscard]] size_t lookup(LabelId label) const;
+
+        std::unique_ptr<Memory> memory_;
+        std::vector<size_t> labels_; // LabelId -> 指令下标，未定义为 -1
+        CallStack callStack_;
+        size_t pc_ = 0;
         size_t jumpTo_ = static_cast<size_t>(-1);
+        size_t programEnd_ = 0;
+        bool incremental_ = false;
+        LabelId waitingFor_ = -1;
+        const LabelTable *labelNames_ = nullptr;
+        utils::BufferedInput *input_ = &utils::BufferedInput::standardInput();
+        utils::BufferedOutput *output_ = &utils::BufferedOutput::standardOutput();
     };
 } // namespace Rikkyu::Whitespace
 
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef RIK_WHITESPACE_RUNTIME_IO
+#define RIK_WHITESPACE_RUNTIME_IO
+
+#include <cstdint>
+#include <string>
+
+#include "Value.h"
+#include "../utils/BufferedIO/BufferedIO.h"
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::Whitespace {
+    // Runner 与 Engine 共用的 IO 指令实现，读写都经过 utils::BufferedInput / BufferedOutput
+    namespace RuntimeIO {
+        RIK_INLINE void writeChar(utils::BufferedOutput &output, Value value) {
+            output.put(static_cast<char>(value.isSmall() ? value.smallValue() : 0));
+        }
+
+        RIK_INLINE void writeNumber(utils::BufferedOutput &output, Value value) {
+            if (value.isSmall()) {
+                output.writeInteger(value.smallValue());
+            } else {
+                output.write(value.bigValue().toString());
+            }
+        }
+
+        // 读取一个字节，不跳过空白；输入结束时为 -1
+        RIK_INLINE Value readChar(utils::BufferedInput &input) {
+            return Value::small(input.get());
+        }
+
+        // 读取一个十进制整数，机器字宽以内直接用 from_chars 的结果，更大的才构造 BigInt
+        inline bool readNumber(utils::BufferedInput &input, BigIntArena &arena, Value &out) {
+            std::string text;
+            int64_t     value = 0;
+            switch (input.readInteger(value, text)) {
+                case utils::BufferedInput::NumberStatus::Ok:
+                    out = Value::fromInt64(value, arena);
+                    return true;
+                case utils::BufferedInput::NumberStatus::Overflow:
+                    out = Value::fromBig(BigInt::fromDecimal(text), arena);
+                    return true;
+                case utils::BufferedInput::NumberStatus::EndOfFile:
+                    text = "<EOF>";
+                    break;
+                default:
+                    break;
+            }
+            utils::ErrorHandler::getInstance().makeError(utils::StringBuilder::concatenate("[WSE14]: Invalid number input - 无效的数字输入: ", text), 0);
+            return false;
+        }
+    } // namespace RuntimeIO
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_RUNTIME_IO
@@ -0,0 +1,408 @@
+#include "StackAnalysis.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace Rikkyu::Whitespace {
+    namespace {
+        constexpr size_t kUnknown = static_cast<size_t>(-1);
+        // 同一个块的入口深度被下调超过这么多次就直接放宽到 0，保证迭代很快收敛
+        constexpr int kWidenAfter = 8;
+
+        bool isTerminator(Opcode op) {
+            return Program::isBranch(op) || op == Opcode::Return || op == Opcode::Exit || op == Opcode::Halt || op == Opcode::Trap;
+        }
+
+        // 块出口的深度下界：通过了入口检查，深度至少是 max(入口下界, 所需深度)
+        size_t exitDepth(const BasicBlock &block, size_t entry) {
+            if (entry == kUnknown || block.required == kUnknown) {
+                return kUnknown;
+            }
+            return static_cast<size_t>(static_cast<std::ptrdiff_t>(std::max(entry, block.required)) + block.delta);
+        }
+    } // namespace
+
+    StackEffect stackEffect(const Instruction &instruction) {
+        const size_t n = instruction.operand < 0 ? kUnknown : static_cast<size_t>(instruction.operand);
+        switch (instruction.op) {
+        case Opcode::Push:
+        case Opcode::LoadImmediate:
+            return {0, 1};
+        case Opcode::Dup:
+            return {1, 1};
+        case Opcode::Copy:
+            return {n == kUnknown ? kUnknown : n + 1, 1};
+        case Opcode::Swap:
+            return {2, 0};
+        case Opcode::Drop:
+        case Opcode::StoreImmediate:
+        case Opcode::JumpZero:
+        case Opcode::JumpNegative:
+        case Opcode::OutChar:
+        case Opcode::OutNum:
+        case Opcode::InChar:
+        case Opcode::InNum:
+            return {1, -1};
+        case Opcode::Slide:
+            return {n == kUnknown ? kUnknown : n + 1, n == kUnknown ? 0 : -static_cast<std::ptrdiff_t>(n)};
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Mod:
+            return {2, -1};
+        case Opcode::Store:
+            return {2, -2};
+        case Opcode::Retrieve:
+        case Opcode::AddImmediate:
+        case Opcode::MulImmediate:
+        case Opcode::DupJumpZero:
+        case Opcode::DupJumpNegative:
+            return {1, 0};
+        default:
+            return {0, 0};
+        }
+    }
+
+    std::string TacOperand::toString() const {
+        switch (kind) {
+        case Kind::Entry:
+            return "s" + std::to_string(index);
+        case Kind::Temp:
+            return "t" + std::to_string(index);
+        default:
+            return value.toString();
+        }
+    }
+
+    std::string TacInstruction::toString() const {
+        switch (op) {
+        case Opcode::Guard:
+            return "require " + a.toString();
+        case Opcode::Retrieve:
+            return "t" + std::to_string(dst) + " = heap[" + a.toString() + "]";
+        case Opcode::Store:
+            return "heap[" + a.toString() + "] = " + b.toString();
+        case Opcode::OutChar:
+        case Opcode::OutNum:
+        case Opcode::InChar:
+        case Opcode::InNum:
+            return std::string(opcodeName(op)) + " " + a.toString();
+        default:
+            return "t" + std::to_string(dst) + " = " + opcodeName(op) + " " + a.toString() + ", " + b.toString();
+        }
+    }
+
+    std::string LoweredBlock::toString() const {
+        std::ostringstream out;
+        for (const auto &instruction : code) {
+            out << "    " << instruction.toString() << "\n";
+        }
+        out << "    writeback: drop " << consumed << ", push [";
+        for (size_t i = 0; i < pushed.size(); ++i) {
+            out << (i ? ", " : "") << pushed[i].toString();
+        }
+        out << "]\n";
+        if (terminator != Opcode::Guard) {
+            out << "    " << opcodeName(terminator);
+            if (terminator == Opcode::Trap) {
+                out << " " << target;
+            } else if (terminator != Opcode::Return && terminator != Opcode::Exit && terminator != Opcode::Halt) {
+                if (terminator != Opcode::Jump && terminator != Opcode::Call) {
+                    out << " " << condition.toString() << ",";
+                }
+                out << " @" << target;
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    ControlFlowGraph::ControlFlowGraph(const Program &program) {
+        build(program);
+        inferDepths(program);
+    }
+
+    void ControlFlowGraph::build(const Program &program) {
+        const auto  &code = program.code();
+        const size_t size = code.size();
+
+        leader_.assign(size + 1, false);
+        if (size) {
+            leader_[0] = true;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (Program::isBranch(code[i].op)) {
+                leader_[static_cast<size_t>(code[i].operand)] = true;
+            }
+            if (isTerminator(code[i].op)) {
+                leader_[i + 1] = true;
+            }
+        }
+
+        blockOf_.assign(size + 1, kUnknown);
+        for (size_t i = 0; i < size; ++i) {
+            if (!leader_[i]) {
+                continue;
+            }
+            BasicBlock block;
+            block.begin = i;
+            block.end = i + 1;
+            while (block.end < size && !leader_[block.end]) {
+                ++block.end;
+            }
+
+            std::ptrdiff_t depth = 0;
+            for (size_t k = block.begin; k < block.end; ++k) {
+                const StackEffect effect = stackEffect(code[k]);
+                if (effect.required == kUnknown) {
+                    block.required = kUnknown;
+                    break;
+                }
+                block.required = std::max(block.required, static_cast<size_t>(std::max<std::ptrdiff_t>(0, static_cast<std::ptrdiff_t>(effect.required) - depth)));
+                depth += effect.delta;
+            }
+            block.delta = depth;
+
+            blockOf_[i] = blocks_.size();
+            blocks_.push_back(block);
+        }
+
+        for (auto &block : blocks_) {
+            const Instruction &last = code[block.end - 1];
+            if (Program::isBranch(last.op)) {
+                block.successors.push_back(blockOf_[static_cast<size_t>(last.operand)]);
+            }
+            const bool fallsThrough = !isTerminator(last.op) ||
+                                      (last.op != Opcode::Jump && last.op != Opcode::Call && Program::isBranch(last.op));
+            if (fallsThrough && block.end < size) {
+                block.successors.push_back(blockOf_[block.end]);
+            }
+        }
+    }
+
+    void ControlFlowGraph::inferDepths(const Program &program) {
+        const auto &code = program.code();
+        if (blocks_.empty()) {
+            return;
+        }
+
+        std::vector<size_t> entry(blocks_.size(), kUnknown);
+        std::vector<int>    lowered(blocks_.size(), 0);
+        entry[0] = 0;
+
+        bool changed = true;
+        auto update = [&](size_t block, size_t depth) {
+            if (block == kUnknown || depth >= entry[block]) {
+                return;
+            }
+            entry[block] = ++lowered[block] > kWidenAfter ? 0 : depth;
+            changed = true;
+        };
+
+        while (changed) {
+            changed = false;
+
+            // 所有 RETURN 出口深度的最小值，作为每个返回点的入口下界
+            size_t returnDepth = kUnknown;
+            for (size_t b = 0; b < blocks_.size(); ++b) {
+                if (code[blocks_[b].end - 1].op == Opcode::Return) {
+                    returnDepth = std::min(returnDepth, exitDepth(blocks_[b], entry[b]));
+                }
+            }
+
+            for (size_t b = 0; b < blocks_.size(); ++b) {
+                if (entry[b] == kUnknown) {
+                    continue;
+                }
+                const size_t out = exitDepth(blocks_[b], entry[b]);
+                if (out == kUnknown) {
+                    continue;
+                }
+                for (size_t successor : blocks_[b].successors) {
+                    update(successor, out);
+                }
+                if (code[blocks_[b].end - 1].op == Opcode::Call && returnDepth != kUnknown) {
+                    update(blockOf_[blocks_[b].end], returnDepth);
+                }
+            }
+        }
+
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            blocks_[b].reachable = entry[b] != kUnknown;
+            blocks_[b].entryDepth = blocks_[b].reachable ? entry[b] : 0;
+        }
+    }
+
+    size_t ControlFlowGraph::eliminateGuards(Program &program) const {
+        auto  &code = program.code();
+        size_t eliminated = 0;
+        for (const auto &block : blocks_) {
+            if (!block.reachable) {
+                continue;
+            }
+            // 沿块内逐条推进深度下界，GUARD 不一定恰好在块开头
+            size_t depth = block.entryDepth;
+            for (size_t i = block.begin; i < block.end; ++i) {
+                const StackEffect effect = stackEffect(code[i]);
+                if (effect.required == kUnknown) {
+                    break;
+                }
+                if (code[i].op == Opcode::Guard && code[i].operand > 0 && depth >= static_cast<size_t>(code[i].operand)) {
+                    code[i].operand = 0;
+                    ++eliminated;
+                }
+                depth = static_cast<size_t>(static_cast<std::ptrdiff_t>(std::max(depth, effect.required)) + effect.delta);
+            }
+        }
+        return eliminated;
+    }
+
+    LoweredBlock ControlFlowGraph::lower(const Program &program, const BasicBlock &block) const {
+        const auto             &code = program.code();
+        LoweredBlock            lowered;
+        std::vector<TacOperand> stack; // 块内新产生的值，栈顶在末尾
+
+        auto pop = [&]() {
+            if (!stack.empty()) {
+                TacOperand top = stack.back();
+                stack.pop_back();
+                return top;
+            }
+            return TacOperand::entry(static_cast<int32_t>(lowered.consumed++));
+        };
+        auto peek = [&](size_t n) {
+            if (n < stack.size()) {
+                return stack[stack.size() - 1 - n];
+            }
+            return TacOperand::entry(static_cast<int32_t>(lowered.consumed + n - stack.size()));
+        };
+        auto emit = [&](Opcode op, TacOperand a, TacOperand b, bool result) {
+            TacInstruction instruction{op, result ? lowered.temps++ : -1, a, b};
+            lowered.code.push_back(instruction);
+            if (result) {
+                stack.push_back(TacOperand::temp(instruction.dst));
+            }
+        };
+
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const Instruction &instruction = code[i];
+            switch (instruction.op) {
+            case Opcode::Guard: {
+                // 内联之后 GUARD 可能在块中间，检查必须留在原位置，不能提前到块开头。
+                // 块内运行时栈不动，所以把对当前深度的要求换算成对运行时栈深度的要求
+                if (instruction.operand < 0) {
+                    emit(Opcode::Guard, TacOperand::immediate(Value::small(Value::kSmallMax)), TacOperand(), false);
+                    break;
+                }
+                const std::ptrdiff_t depth = static_cast<std::ptrdiff_t>(instruction.operand) + static_cast<std::ptrdiff_t>(lowered.consumed) -
+                                             static_cast<std::ptrdiff_t>(stack.size());
+                if (depth > 0) {
+                    emit(Opcode::Guard, TacOperand::immediate(Value::small(depth)), TacOperand(), false);
+                }
+                break;
+            }
+            case Opcode::Push:
+                stack.push_back(TacOperand::immediate(instruction.value));
+                break;
+            case Opcode::Dup:
+                stack.push_back(peek(0));
+                break;
+            case Opcode::Copy:
+                stack.push_back(peek(static_cast<size_t>(instruction.operand)));
+                break;
+            case Opcode::Swap: {
+                TacOperand a = pop();
+                TacOperand b = pop();
+                stack.push_back(a);
+                stack.push_back(b);
+                break;
+            }
+            case Opcode::Drop:
+                pop();
+                break;
+            case Opcode::Slide: {
+                TacOperand top = pop();
+                for (int32_t k = 0; k < instruction.operand; ++k) {
+                    pop();
+                }
+                stack.push_back(top);
+                break;
+            }
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Mod: {
+                TacOperand b = pop();
+                TacOperand a = pop();
+                emit(instruction.op, a, b, true);
+                break;
+            }
+            case Opcode::AddImmediate:
+            case Opcode::MulImmediate: {
+                TacOperand a = pop();
+                emit(instruction.op == Opcode::AddImmediate ? Opcode::Add : Opcode::Mul, a, TacOperand::immediate(instruction.value), true);
+                break;
+            }
+            case Opcode::Retrieve: {
+                TacOperand address = pop();
+                emit(Opcode::Retrieve, address, TacOperand(), true);
+                break;
+            }
+            case Opcode::LoadImmediate:
+                emit(Opcode::Retrieve, TacOperand::immediate(instruction.value), TacOperand(), true);
+                break;
+            case Opcode::Store: {
+                TacOperand value = pop();
+                TacOperand address = pop();
+                emit(Opcode::Store, address, value, false);
+                break;
+            }
+            case Opcode::StoreImmediate: {
+                TacOperand value = pop();
+                emit(Opcode::Store, TacOperand::immediate(instruction.value), value, false);
+                break;
+            }
+            case Opcode::OutChar:
+            case Opcode::OutNum:
+            case Opcode::InChar:
+            case Opcode::InNum:
+                emit(instruction.op, pop(), TacOperand(), false);
+                break;
+            case Opcode::JumpZero:
+            case Opcode::JumpNegative:
+                lowered.terminator = instruction.op;
+                lowered.condition = pop();
+                lowered.target = instruction.operand;
+                break;
+            case Opcode::DupJumpZero:
+            case Opcode::DupJumpNegative:
+                lowered.terminator = instruction.op;
+                lowered.condition = peek(0);
+                lowered.target = instruction.operand;
+                break;
+            case Opcode::Call:
+            case Opcode::Jump:
+            case Opcode::Return:
+            case Opcode::Exit:
+            case Opcode::Halt:
+            case Opcode::Trap:
+                lowered.terminator = instruction.op;
+                lowered.target = instruction.operand;
+                break;
+            }
+        }
+
+        // 写回时，压入值中最底下那些本来就在原位的入口值不需要搬动
+        size_t keep = 0;
+        while (keep < stack.size() && lowered.consumed > 0 &&
+               stack[keep].kind == TacOperand::Kind::Entry &&
+               static_cast<size_t>(stack[keep].index) == lowered.consumed - 1) {
+            --lowered.consumed;
+            ++keep;
+        }
+        lowered.pushed.assign(stack.begin() + static_cast<std::ptrdiff_t>(keep), stack.end());
+        return lowered;
+    }
+} // namespace Rikkyu::Whitespace
@@ -0,0 +1,120 @@
+#pragma once
+#ifndef RIK_WHITESPACE_STACK_ANALYSIS
+#define RIK_WHITESPACE_STACK_ANALYSIS
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bytecode.h"
+
+namespace Rikkyu::Whitespace {
+    // 基本块：字节码下标范围 [begin, end)
+    struct BasicBlock {
+        size_t              begin = 0;
+        size_t              end = 0;
+        size_t              required = 0;   // 入口处至少需要的栈深度
+        std::ptrdiff_t      delta = 0;      // 执行完整个块后栈深度的变化
+        size_t              entryDepth = 0; // 静态推断出的入口栈深度下界
+        bool                reachable = false;
+        std::vector<size_t> successors; // 后继块的编号（不含 CALL 的返回点）
+    };
+
+    // 三地址指令的操作数：块入口时栈上的值（index 为距栈顶的距离）、临时寄存器或立即数
+    struct TacOperand {
+        enum class Kind : uint8_t {
+            Entry,
+            Temp,
+            Immediate
+        };
+
+        Kind    kind = Kind::Immediate;
+        int32_t index = 0;
+        Value   value;
+
+        static TacOperand entry(int32_t index) { return {Kind::Entry, index, Value()}; }
+        static TacOperand temp(int32_t index) { return {Kind::Temp, index, Value()}; }
+        static TacOperand immediate(Value value) { return {Kind::Immediate, 0, value}; }
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    // 块内的三地址指令。op 复用字节码操作码：
+    //   Guard                        运行时栈深度至少为 a（块内运行时栈不动，深度已换算好）
+    //   Add / Sub / Mul / Div / Mod  dst = a op b
+    //   Retrieve                     dst = heap[a]
+    //   Store                        heap[a] = b
+    //   OutChar / OutNum             输出 a
+    //   InChar / InNum               heap[a] = 输入
+    struct TacInstruction {
+        Opcode     op = Opcode::Halt;
+        int32_t    dst = -1;
+        TacOperand a;
+        TacOperand b;
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    // 一个基本块降低为寄存器形式后的结果。
+    // 块执行期间运行时栈保持不变，结束时统一写回：先弹掉 consumed 个入口值，再依次压入 pushed。
+    struct LoweredBlock {
+        std::vector<TacInstruction> code;
+        size_t                      consumed = 0;
+        std::vector<TacOperand>     pushed;
+        int32_t                     temps = 0;
+
+        // 块的出口：Jump / JumpZero / JumpNegative / Call / Return / Exit / Halt / Trap（target 是错误信息下标），
+        // 或 Guard 表示直接落入下一个块。DUPJZ / DUPJN 的条件值仍留在 pushed 里。
+        Opcode     terminator = Opcode::Guard;
+        TacOperand condition;
+        int32_t    target = 0;
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    // 每条指令执行前需要的栈深度，以及执行后栈深度的变化
+    struct StackEffect {
+        size_t         required;
+        std::ptrdiff_t delta;
+    };
+
+    StackEffect stackEffect(const Instruction &instruction);
+
+    // 字节码上的控制流图，并推断每个块入口的静态栈深度下界。
+    // 入口深度下界不小于块所需深度的块，其入口检查可以直接去掉。
+    class ControlFlowGraph {
+    public:
+        explicit ControlFlowGraph(const Program &program);
+        ~ControlFlowGraph() = default;
+
+        [[nodiscard]] const std::vector<BasicBlock> &blocks() const {
+            return blocks_;
+        }
+
+        // 下标为 index 的指令是否是块的开头（跳转目标、返回点或分支之后）
+        [[nodiscard]] bool isLeader(size_t index) const {
+            return leader_[index];
+        }
+
+        [[nodiscard]] bool proven(const BasicBlock &block) const {
+            return block.reachable && block.entryDepth >= block.required;
+        }
+
+        // 把已证明安全的 GUARD 的深度改为 0（随后由窥孔优化删除），返回改动的个数
+        size_t eliminateGuards(Program &program) const;
+
+        // 把一个块降低为三地址形式，栈的搬运指令在这里全部变成寄存器重命名
+        [[nodiscard]] LoweredBlock lower(const Program &program, const BasicBlock &block) const;
+
+    private:
+        void build(const Program &program);
+        void inferDepths(const Program &program);
+
+        std::vector<BasicBlock> blocks_;
+        std::vector<bool>       leader_;
+        std::vector<size_t>     blockOf_; // 块开头的指令下标 -> 块编号
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_STACK_ANALYSIS
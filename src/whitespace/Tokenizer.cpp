@@ -0,0 +1,322 @@
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "../utils/ErrorHandler/ErrorHandler.h"
+#include "../utils/SourceFilter/SourceFilter.h"
+#include "../utils/StringBuilder/StringBuilder.h"
+
+namespace Rikkyu::Whitespace {
+    namespace {
+        // 字符分类：0 空格，1 制表符，2 换行，3 其他（注释，已由 SourceFilter 滤掉）
+        constexpr uint8_t kSpace = 0;
+        constexpr uint8_t kTab = 1;
+        constexpr uint8_t kLineFeed = 2;
+        constexpr uint8_t kComment = 3;
+
+        constexpr std::array<uint8_t, 256> makeClassTable() {
+            std::array<uint8_t, 256> table{};
+            for (auto &c : table) {
+                c = kComment;
+            }
+            table[static_cast<uint8_t>(' ')] = kSpace;
+            table[static_cast<uint8_t>('\t')] = kTab;
+            table[static_cast<uint8_t>('\n')] = kLineFeed;
+            return table;
+        }
+
+        constexpr std::array<uint8_t, 256> kClass = makeClassTable();
+
+        enum class Argument : uint8_t {
+            None,
+            Number,
+            Label
+        };
+
+        struct Rule {
+            const char *pattern; // S 空格，T 制表符，L 换行
+            Token::Kind kind;
+            Argument    argument;
+        };
+
+        // 标准 Whitespace 指令集
+        constexpr Rule kRules[] = {
+            {"SS", Token::Kind::Push, Argument::Number},
+            {"SLS", Token::Kind::Duplicate, Argument::None},
+            {"STS", Token::Kind::Copy, Argument::Number},
+            {"SLT", Token::Kind::Swap, Argument::None},
+            {"SLL", Token::Kind::Discard, Argument::None},
+            {"STL", Token::Kind::Slide, Argument::Number},
+            {"TSSS", Token::Kind::Add, Argument::None},
+            {"TSST", Token::Kind::Sub, Argument::None},
+            {"TSSL", Token::Kind::Mul, Argument::None},
+            {"TSTS", Token::Kind::Div, Argument::None},
+            {"TSTT", Token::Kind::Mod, Argument::None},
+            {"TTS", Token::Kind::Store, Argument::None},
+            {"TTT", Token::Kind::Retrieve, Argument::None},
+            {"LSS", Token::Kind::Mark, Argument::Label},
+            {"LST", Token::Kind::Call, Argument::Label},
+            {"LSL", Token::Kind::Jump, Argument::Label},
+            {"LTS", Token::Kind::JumpZero, Argument::Label},
+            {"LTT", Token::Kind::JumpNegative, Argument::Label},
+            {"LTL", Token::Kind::Return, Argument::None},
+            {"LLL", Token::Kind::Exit, Argument::None},
+            {"TLSS", Token::Kind::OutChar, Argument::None},
+            {"TLST", Token::Kind::OutNum, Argument::None},
+            {"TLTS", Token::Kind::InChar, Argument::None},
+            {"TLTT", Token::Kind::InNum, Argument::None},
+        };
+
+        constexpr size_t kRuleCount = sizeof(kRules) / sizeof(kRules[0]);
+        constexpr size_t kMaxStates = 32;
+
+        // 指令前缀状态机：transitions[state][class]
+        //   > 0 转移到该状态，< 0 识别出第 -(v + 1) 条规则，0 非法序列
+        using TransitionTable = std::array<std::array<int8_t, 3>, kMaxStates>;
+
+        constexpr uint8_t classOf(char c) {
+            return c == 'S' ? kSpace : (c == 'T' ? kTab : kLineFeed);
+        }
+
+        constexpr TransitionTable makeTransitionTable() {
+            TransitionTable table{};
+            int8_t          states = 1;
+            for (size_t rule = 0; rule < kRuleCount; ++rule) {
+                int8_t      state = 0;
+                const char *p = kRules[rule].pattern;
+                for (; p[1]; ++p) {
+                    auto &slot = table[static_cast<size_t>(state)][classOf(*p)];
+                    if (slot == 0) {
+                        slot = states++;
+                    }
+                    state = slot;
+                }
+                table[static_cast<size_t>(state)][classOf(*p)] = static_cast<int8_t>(-static_cast<int>(rule) - 1);
+            }
+            return table;
+        }
+
+        constexpr TransitionTable kTransitions = makeTransitionTable();
+    } // namespace
+
+    LineIndex::LineIndex(const char *data, size_t size) {
+        lineStarts_.push_back(0);
+        const char *end = data + size;
+        for (const char *p = data; (p = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)))); ++p) {
+            lineStarts_.push_back(static_cast<size_t>(p - data) + 1);
+        }
+    }
+
+    std::pair<size_t, size_t> LineIndex::locate(size_t pos) const {
+        auto it = std::upper_bound(lineStarts_.begin(), lineStarts_.end(), pos);
+        const size_t line = static_cast<size_t>(it - lineStarts_.begin());
+        return {line, pos - lineStarts_[line - 1] + 1};
+    }
+
+    std::string LabelTable::unpack(uint64_t packed) {
+        std::string name;
+        for (int bit = 63 - __builtin_clzll(packed) - 1; bit >= 0; --bit) {
+            name.push_back((packed >> bit) & 1 ? '1' : '0');
+        }
+        return name;
+    }
+
+    LabelId LabelTable::intern(uint64_t packed) {
+        auto [it, inserted] = packed_.emplace(packed, static_cast<LabelId>(names_.size()));
+        if (inserted) {
+            names_.push_back(unpack(packed));
+        }
+        return it->second;
+    }
+
+    LabelId LabelTable::intern(const std::string &bits) {
+        auto it = long_.find(bits);
+        if (it != long_.end()) {
+            return it->second;
+        }
+        const LabelId id = add(bits);
+        long_.emplace(bits, id);
+        return id;
+    }
+
+    LabelId LabelTable::add(std::string name) {
+        names_.push_back(std::move(name));
+        return static_cast<LabelId>(names_.size() - 1);
+    }
+
+    void LabelTable::clear() {
+        packed_.clear();
+        long_.clear();
+        names_.clear();
+    }
+
+    Tokenizer::Tokenizer(const char *data, size_t size, LabelTable &labels)
+        : data_(data), size_(size), labels_(labels),
+          dense_(new char[std::min(size, kBlock) + utils::SourceFilter::kSlack]),
+          offsets_(new uint32_t[std::min(size, kBlock) + utils::SourceFilter::kSlack]), pending_(size) {}
+
+    bool Tokenizer::refill() {
+        while (pos_ == count_) {
+            if (next_ >= size_) {
+                return false;
+            }
+            base_ = next_;
+            count_ = utils::SourceFilter::compact(data_ + base_, std::min(kBlock, size_ - base_), utils::SourceFilter::Alphabet::Whitespace,
+                                                  dense_.get(), offsets_.get());
+            next_ += kBlock;
+            pos_ = 0;
+        }
+        return true;
+    }
+
+    std::pair<size_t, size_t> Tokenizer::locate(size_t pos) {
+        if (!lines_) {
+            lines_ = std::make_unique<LineIndex>(data_, size_);
+        }
+        return lines_->locate(pos);
+    }
+
+    void Tokenizer::reportError(const char *code, const char *message, size_t pos) {
+        auto [line, col] = locate(pos);
+        utils::ErrorHandler::getInstance().makeError(
+            utils::StringBuilder::concatenate("[", code, "]: ", message, " at line ", std::to_string(line), ", column ", std::to_string(col)),
+            pos);
+    }
+
+    bool Tokenizer::next(Token &token) {
+        int8_t state = 0;
+        size_t start = 0;
+
+        while (refill()) {
+            const uint8_t cls = kClass[static_cast<uint8_t>(dense_[pos_])];
+            const size_t  at = position();
+            if (state == 0) {
+                start = at;
+            }
+            ++pos_;
+
+            const int8_t transition = kTransitions[static_cast<size_t>(state)][cls];
+            if (transition > 0) {
+                state = transition;
+                continue;
+            }
+            if (transition == 0) {
+                // 非法序列：报错后从下一个字符重新开始识别
+                reportError("WSE09", "Unknown instruction", start);
+                state = 0;
+                continue;
+            }
+
+            const Rule &rule = kRules[-transition - 1];
+            token.kind = rule.kind;
+            token.position = start;
+            token.argument = at + 1;
+            truncated_ = false;
+            switch (rule.argument) {
+                case Argument::Number:
+                    token.number = readNumber(start);
+                    break;
+                case Argument::Label:
+                    token.label = readLabel(start);
+                    break;
+                case Argument::None:
+                    break;
+            }
+            if (truncated_ && streaming_) {
+                pending_ = start;
+                return false;
+            }
+            return true;
+        }
+
+        // 文件末尾不完整的指令直接忽略，与原来的解析器一致；流式输入则等后续数据补全
+        if (state != 0 && streaming_) {
+            pending_ = start;
+        }
+        return false;
+    }
+
+    Literal Tokenizer::readNumber(size_t start) {
+        // 符号位
+        truncated_ = !refill();
+        if (truncated_) {
+            if (!streaming_) {
+                reportError("WSE10", "Expected number", start);
+            }
+            return Literal();
+        }
+        const uint8_t sign = kClass[static_cast<uint8_t>(dense_[pos_])];
+        if (sign == kLineFeed) {
+            // 缺少符号位，按 0 处理
+            reportError("WSE11", "Invalid number sign", position());
+            ++pos_;
+            return Literal(0);
+        }
+        ++pos_;
+
+        // 位数不多时直接在机器字里累加，快要超出小整数范围时才转成大整数
+        intptr_t value = 0;
+        BigInt   big;
+        bool     isBig = false;
+        truncated_ = true;
+        while (refill()) {
+            const uint8_t cls = kClass[static_cast<uint8_t>(dense_[pos_++])];
+            if (cls == kLineFeed) {
+                truncated_ = false;
+                break;
+            }
+            const bool bit = cls == kTab;
+            if (isBig) {
+                big.appendBit(bit);
+            } else if (value > (Value::kSmallMax >> 1)) {
+                big = BigInt(static_cast<int64_t>(value));
+                big.appendBit(bit);
+                isBig = true;
+            } else {
+                value = (value << 1) | (bit ? 1 : 0);
+            }
+        }
+
+        if (isBig) {
+            if (sign == kTab) {
+                big.negate();
+            }
+            return Literal(std::move(big));
+        }
+        return Literal(sign == kTab ? -value : value);
+    }
+
+    LabelId Tokenizer::readLabel(size_t start) {
+        // 短标签在 64 位整数里按位累加，最高位的哨兵 1 保留前导零
+        uint64_t    packed = 1;
+        size_t      length = 0;
+        std::string bits;
+        truncated_ = true;
+        while (refill()) {
+            const uint8_t cls = kClass[static_cast<uint8_t>(dense_[pos_++])];
+            if (cls == kLineFeed) {
+                truncated_ = false;
+                break;
+            }
+            if (length < LabelTable::kMaxPackedBits) {
+                packed = (packed << 1) | cls;
+            } else {
+                if (length == LabelTable::kMaxPackedBits) {
+                    bits = LabelTable::unpack(packed);
+                }
+                bits.push_back(cls == kTab ? '1' : '0');
+            }
+            ++length;
+        }
+
+        if (truncated_ && streaming_) {
+            return -1;
+        }
+        if (length == 0) {
+            reportError("WSE12", "Empty label", start);
+        }
+        return length > LabelTable::kMaxPackedBits ? labels_.intern(bits) : labels_.intern(packed);
+    }
+} // namespace Rikkyu::Whitespace
@@ -0,0 +1,156 @@
+#pragma once
+#ifndef RIK_WHITESPACE_TOKENIZER
+#define RIK_WHITESPACE_TOKENIZER
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AbstractExpression.h"
+#include "Value.h"
+
+namespace Rikkyu::Whitespace {
+    // 源码中所有换行符的位置，只建立一次，之后每次查询行列号都是二分查找
+    class LineIndex {
+    public:
+        LineIndex(const char *data, size_t size);
+        ~LineIndex() = default;
+
+        // 1 起始的行号和列号
+        [[nodiscard]] std::pair<size_t, size_t> locate(size_t pos) const;
+
+    private:
+        std::vector<size_t> lineStarts_;
+    };
+
+    // 标签驻留表：相同的空格 / 制表符序列总是得到同一个从 0 开始的整数编号。
+    // 不超过 62 位的标签直接以位串作为键（最高位放一个哨兵 1 区分前导零），不构造字符串。
+    class LabelTable {
+    public:
+        static constexpr size_t kMaxPackedBits = 62;
+
+        LabelTable() = default;
+        ~LabelTable() = default;
+
+        // packed 去掉哨兵位后的 0/1 形式
+        static std::string unpack(uint64_t packed);
+
+        LabelId intern(uint64_t packed);
+        LabelId intern(const std::string &bits);
+
+        [[nodiscard]] size_t size() const {
+            return names_.size();
+        }
+
+        // 标签的 0/1 形式，用于错误信息和调试输出
+        [[nodiscard]] const std::string &name(LabelId id) const {
+            return names_[static_cast<size_t>(id)];
+        }
+
+        void clear();
+
+    private:
+        LabelId add(std::string name);
+
+        std::unordered_map<uint64_t, LabelId>    packed_;
+        std::unordered_map<std::string, LabelId> long_;
+        std::vector<std::string>                 names_;
+    };
+
+    // 一条完整的指令。number / label 只在指令带参数时有效
+    struct Token {
+        enum class Kind : uint8_t {
+            Push,
+            Duplicate,
+            Copy,
+            Swap,
+            Discard,
+            Slide,
+            Add,
+            Sub,
+            Mul,
+            Div,
+            Mod,
+            Store,
+            Retrieve,
+            Mark,
+            Call,
+            Jump,
+            JumpZero,
+            JumpNegative,
+            Return,
+            Exit,
+            OutChar,
+            OutNum,
+            InChar,
+            InNum
+        };
+
+        Kind    kind = Kind::Exit;
+        size_t  position = 0; // 指令第一个字符在源码中的下标
+        size_t  argument = 0; // 参数第一个字符在源码中的下标
+        Literal number;
+        LabelId label = -1;
+    };
+
+    // 单遍、查表驱动的 Whitespace 词法分析器（标准编码）。
+    // 源码按块经 SourceFilter 去掉注释后再逐个读入，每个字符只做两次查表：字符分类，以及指令前缀状态机的转移。
+    class Tokenizer {
+    public:
+        static constexpr size_t kBlock = size_t(1) << 16;
+
+        Tokenizer(const char *data, size_t size, LabelTable &labels);
+        ~Tokenizer() = default;
+
+        // 读取下一条指令，到达源码末尾时返回 false。无法识别的指令报错后跳过
+        bool next(Token &token);
+
+        // 给定位置的行号和列号。行索引在第一次需要时才建立
+        std::pair<size_t, size_t> locate(size_t pos);
+
+        // 流式模式（REPL）：被源码末尾截断的指令（包括参数缺少结尾换行的）不报错，next() 直接返回 false，
+        // pending() 为这条指令开头的位置，调用者补上后续源码后从这里重新识别
+        void setStreaming(bool streaming) {
+            streaming_ = streaming;
+        }
+
+        // 被截断的指令的开头，没有时为源码长度
+        [[nodiscard]] size_t pending() const {
+            return pending_;
+        }
+
+    private:
+        void reportError(const char *code, const char *message, size_t pos);
+
+        // 当前块读完时过滤下一块，源码结束时返回 false
+        bool refill();
+
+        // dense_[pos_] 在源码中的下标
+        [[nodiscard]] size_t position() const {
+            return base_ + offsets_[pos_];
+        }
+
+        Literal readNumber(size_t start);
+        LabelId readLabel(size_t start);
+
+        const char                 *data_;
+        size_t                      size_;
+        LabelTable                 &labels_;
+        std::unique_ptr<LineIndex>  lines_;
+        std::unique_ptr<char[]>     dense_;   // 当前块中的空格、制表符和换行
+        std::unique_ptr<uint32_t[]> offsets_; // dense_ 中每个字符相对块开头的下标
+        size_t                      base_ = 0;  // 当前块在源码中的起点
+        size_t                      next_ = 0;  // 下一块的起点
+        size_t                      count_ = 0; // dense_ 中的字符数
+        size_t                      pos_ = 0;   // dense_ 中下一个要读的字符
+        size_t                      pending_;
+        bool                        streaming_ = false;
+        bool                        truncated_ = false; // 刚读的参数没有结尾换行就到了源码末尾
+    };
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_TOKENIZER
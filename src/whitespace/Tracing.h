@@ -0,0 +1,51 @@
+#pragma once
+#ifndef RIK_WHITESPACE_TRACING
+#define RIK_WHITESPACE_TRACING
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Memory.h"
+#include "../utils/Trace/Trace.h"
+
+namespace Rikkyu::Whitespace {
+    // 跟踪事件的 op 就是 Opcode；Runner 执行 LABEL 表达式时使用紧随其后的这个编号
+    constexpr uint16_t kTraceLabel = 0
+#define RIK_WS_OPCODE_COUNT(name, mnemonic) +1
+        RIK_WS_OPCODES(RIK_WS_OPCODE_COUNT)
+#undef RIK_WS_OPCODE_COUNT
+        ;
+
+    // 写进转储文件头的操作码名称表
+    inline std::vector<std::string> traceOpcodeNames() {
+        std::vector<std::string> names = {
+#define RIK_WS_OPCODE_NAME(name, mnemonic) mnemonic,
+            RIK_WS_OPCODES(RIK_WS_OPCODE_NAME)
+#undef RIK_WS_OPCODE_NAME
+        };
+        names.emplace_back("LABEL");
+        return names;
+    }
+
+    // 记录一步执行：指令位置、操作码和执行前的栈顶
+    template <typename Tracer>
+    RIK_INLINE void traceStep(Tracer &tracer, size_t pc, uint16_t op, Memory &memory) {
+        if constexpr (Tracer::enabled) {
+            if (memory.stackEmpty()) {
+                tracer.record(static_cast<uint32_t>(pc), op, 0, 0);
+                return;
+            }
+            const Value top = memory.stackTopUnchecked();
+            if (top.isSmall()) {
+                tracer.record(static_cast<uint32_t>(pc), op, utils::TF_HasValue, top.smallValue());
+            } else {
+                tracer.record(static_cast<uint32_t>(pc), op, utils::TF_HasValue | utils::TF_Truncated, 0);
+            }
+        }
+    }
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_TRACING
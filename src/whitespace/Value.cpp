@@ -0,0 +1,385 @@
+#include "Value.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace Rikkyu::Whitespace {
+    BigInt::BigInt(int64_t value) {
+        negative_ = value < 0;
+        // 先转成无符号再取负，避免 INT64_MIN 取负溢出
+        uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        while (magnitude != 0) {
+            magnitude_.push_back(static_cast<uint32_t>(magnitude));
+            magnitude >>= 32;
+        }
+    }
+
+    BigInt BigInt::fromDecimal(const std::string &text, bool *ok) {
+        BigInt result;
+        size_t pos = 0;
+        bool   negative = false;
+        if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+            negative = text[pos] == '-';
+            ++pos;
+        }
+
+        bool valid = pos < text.size();
+        for (; pos < text.size(); ++pos) {
+            if (text[pos] < '0' || text[pos] > '9') {
+                valid = false;
+                break;
+            }
+            // result = result * 10 + digit
+            uint64_t carry = static_cast<uint64_t>(text[pos] - '0');
+            for (auto &limb : result.magnitude_) {
+                uint64_t t = static_cast<uint64_t>(limb) * 10 + carry;
+                limb = static_cast<uint32_t>(t);
+                carry = t >> 32;
+            }
+            if (carry) {
+                result.magnitude_.push_back(static_cast<uint32_t>(carry));
+            }
+        }
+
+        trim(result.magnitude_);
+        result.negative_ = negative && !result.isZero();
+        if (ok) {
+            *ok = valid;
+        }
+        return result;
+    }
+
+    bool BigInt::toInt64(int64_t &out) const {
+        if (magnitude_.size() > 2) {
+            return false;
+        }
+        uint64_t magnitude = 0;
+        for (size_t i = magnitude_.size(); i-- > 0;) {
+            magnitude = (magnitude << 32) | magnitude_[i];
+        }
+        if (negative_) {
+            if (magnitude > static_cast<uint64_t>(INT64_MAX) + 1) {
+                return false;
+            }
+            out = static_cast<int64_t>(0 - magnitude);
+        } else {
+            if (magnitude > static_cast<uint64_t>(INT64_MAX)) {
+                return false;
+            }
+            out = static_cast<int64_t>(magnitude);
+        }
+        return true;
+    }
+
+    void BigInt::appendBit(bool bit) {
+        uint32_t carry = bit ? 1 : 0;
+        for (auto &limb : magnitude_) {
+            uint32_t next = limb >> 31;
+            limb = (limb << 1) | carry;
+            carry = next;
+        }
+        if (carry) {
+            magnitude_.push_back(carry);
+        }
+    }
+
+    void BigInt::negate() {
+        if (!isZero()) {
+            negative_ = !negative_;
+        }
+    }
+
+    std::string BigInt::toString() const {
+        if (isZero()) {
+            return "0";
+        }
+
+        // 每次整体除以 1e9，从低到高得到十进制的 9 位一组
+        Magnitude             rest = magnitude_;
+        std::vector<uint32_t> chunks;
+        while (!rest.empty()) {
+            uint64_t remainder = 0;
+            for (size_t i = rest.size(); i-- > 0;) {
+                uint64_t t = (remainder << 32) | rest[i];
+                rest[i] = static_cast<uint32_t>(t / 1000000000u);
+                remainder = t % 1000000000u;
+            }
+            trim(rest);
+            chunks.push_back(static_cast<uint32_t>(remainder));
+        }
+
+        std::string result = negative_ ? "-" : "";
+        result += std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            std::string part = std::to_string(chunks[i]);
+            result.append(9 - part.size(), '0');
+            result += part;
+        }
+        return result;
+    }
+
+    int BigInt::compareMagnitude(const Magnitude &a, const Magnitude &b) {
+        if (a.size() != b.size()) {
+            return a.size() < b.size() ? -1 : 1;
+        }
+        for (size_t i = a.size(); i-- > 0;) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    void BigInt::addMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &out) {
+        const Magnitude &longer = a.size() >= b.size() ? a : b;
+        const Magnitude &shorter = a.size() >= b.size() ? b : a;
+        out.resize(longer.size());
+        uint64_t carry = 0;
+        for (size_t i = 0; i < longer.size(); ++i) {
+            uint64_t t = static_cast<uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+            out[i] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        if (carry) {
+            out.push_back(static_cast<uint32_t>(carry));
+        }
+    }
+
+    void BigInt::subMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &out) {
+        out.resize(a.size());
+        int64_t borrow = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            int64_t t = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = t < 0 ? 1 : 0;
+            out[i] = static_cast<uint32_t>(t + (borrow << 32));
+        }
+        trim(out);
+    }
+
+    void BigInt::trim(Magnitude &m) {
+        while (!m.empty() && m.back() == 0) {
+            m.pop_back();
+        }
+    }
+
+    BigInt BigInt::add(const BigInt &a, const BigInt &b) {
+        BigInt result;
+        if (a.negative_ == b.negative_) {
+            addMagnitude(a.magnitude_, b.magnitude_, result.magnitude_);
+            result.negative_ = a.negative_;
+        } else if (compareMagnitude(a.magnitude_, b.magnitude_) >= 0) {
+            subMagnitude(a.magnitude_, b.magnitude_, result.magnitude_);
+            result.negative_ = a.negative_;
+        } else {
+            subMagnitude(b.magnitude_, a.magnitude_, result.magnitude_);
+            result.negative_ = b.negative_;
+        }
+        if (result.isZero()) {
+            result.negative_ = false;
+        }
+        return result;
+    }
+
+    BigInt BigInt::sub(const BigInt &a, const BigInt &b) {
+        BigInt negated = b;
+        negated.negate();
+        return add(a, negated);
+    }
+
+    BigInt BigInt::mul(const BigInt &a, const BigInt &b) {
+        BigInt result;
+        if (a.isZero() || b.isZero()) {
+            return result;
+        }
+        result.magnitude_.assign(a.magnitude_.size() + b.magnitude_.size(), 0);
+        for (size_t i = 0; i < a.magnitude_.size(); ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < b.magnitude_.size(); ++j) {
+                uint64_t t = static_cast<uint64_t>(a.magnitude_[i]) * b.magnitude_[j] + result.magnitude_[i + j] + carry;
+                result.magnitude_[i + j] = static_cast<uint32_t>(t);
+                carry = t >> 32;
+            }
+            result.magnitude_[i + b.magnitude_.size()] = static_cast<uint32_t>(carry);
+        }
+        trim(result.magnitude_);
+        result.negative_ = a.negative_ != b.negative_;
+        return result;
+    }
+
+    void BigInt::divModMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &q, Magnitude &r) {
+        if (compareMagnitude(a, b) < 0) {
+            q.clear();
+            r = a;
+            return;
+        }
+
+        // 单段除数：直接做短除法
+        if (b.size() == 1) {
+            q.assign(a.size(), 0);
+            uint64_t remainder = 0;
+            for (size_t i = a.size(); i-- > 0;) {
+                uint64_t t = (remainder << 32) | a[i];
+                q[i] = static_cast<uint32_t>(t / b[0]);
+                remainder = t % b[0];
+            }
+            trim(q);
+            r.clear();
+            if (remainder) {
+                r.push_back(static_cast<uint32_t>(remainder));
+            }
+            return;
+        }
+
+        // Knuth 算法 D：先把除数规格化到最高位为 1，再逐段估商
+        const size_t n = b.size();
+        const size_t m = a.size() - n;
+        int          shift = 0;
+        for (uint32_t top = b.back(); !(top & 0x80000000u); top <<= 1) {
+            ++shift;
+        }
+
+        Magnitude bn(n), an(a.size() + 1);
+        for (size_t i = n; i-- > 0;) {
+            bn[i] = (b[i] << shift) | (shift && i > 0 ? b[i - 1] >> (32 - shift) : 0);
+        }
+        an[a.size()] = shift ? a.back() >> (32 - shift) : 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            an[i] = (a[i] << shift) | (shift && i > 0 ? a[i - 1] >> (32 - shift) : 0);
+        }
+
+        constexpr uint64_t base = uint64_t(1) << 32;
+        q.assign(m + 1, 0);
+        for (size_t j = m + 1; j-- > 0;) {
+            uint64_t numerator = (static_cast<uint64_t>(an[j + n]) << 32) | an[j + n - 1];
+            uint64_t qhat = numerator / bn[n - 1];
+            uint64_t rhat = numerator % bn[n - 1];
+            while (qhat >= base || qhat * bn[n - 2] > ((rhat << 32) | an[j + n - 2])) {
+                --qhat;
+                rhat += bn[n - 1];
+                if (rhat >= base) {
+                    break;
+                }
+            }
+
+            // an[j..j+n] -= qhat * bn
+            int64_t  borrow = 0;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t p = qhat * bn[i] + carry;
+                carry = p >> 32;
+                int64_t t = static_cast<int64_t>(an[i + j]) - borrow - static_cast<int64_t>(p & 0xffffffffu);
+                an[i + j] = static_cast<uint32_t>(t);
+                borrow = t < 0 ? 1 : 0;
+            }
+            int64_t t = static_cast<int64_t>(an[j + n]) - borrow - static_cast<int64_t>(carry);
+            an[j + n] = static_cast<uint32_t>(t);
+
+            // 估商大了一，加回一次除数
+            if (t < 0) {
+                --qhat;
+                uint64_t c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t s = static_cast<uint64_t>(an[i + j]) + bn[i] + c;
+                    an[i + j] = static_cast<uint32_t>(s);
+                    c = s >> 32;
+                }
+                an[j + n] += static_cast<uint32_t>(c);
+            }
+            q[j] = static_cast<uint32_t>(qhat);
+        }
+        trim(q);
+
+        r.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = (an[i] >> shift) | (shift ? an[i + 1] << (32 - shift) : 0);
+        }
+        trim(r);
+    }
+
+    void BigInt::divMod(const BigInt &a, const BigInt &b, BigInt *quotient, BigInt *remainder) {
+        Magnitude q, r;
+        divModMagnitude(a.magnitude_, b.magnitude_, q, r);
+        if (quotient) {
+            quotient->magnitude_ = std::move(q);
+            quotient->negative_ = !quotient->isZero() && a.negative_ != b.negative_;
+        }
+        if (remainder) {
+            remainder->magnitude_ = std::move(r);
+            remainder->negative_ = !remainder->isZero() && a.negative_;
+        }
+    }
+
+    Value Value::fromInt64(int64_t value, BigIntArena &arena) {
+        if (fitsSmall(value)) {
+            return small(static_cast<intptr_t>(value));
+        }
+        return big(arena.make(BigInt(value)));
+    }
+
+    Value Value::fromBig(BigInt &&value, BigIntArena &arena) {
+        int64_t v;
+        if (value.toInt64(v) && fitsSmall(v)) {
+            return small(static_cast<intptr_t>(v));
+        }
+        return big(arena.make(std::move(value)));
+    }
+
+    BigInt Value::toBig() const {
+        return isSmall() ? BigInt(static_cast<int64_t>(smallValue())) : bigValue();
+    }
+
+    std::string Value::toString() const {
+        return isSmall() ? std::to_string(smallValue()) : bigValue().toString();
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Value &value) {
+        if (value.isSmall()) {
+            return os << value.smallValue();
+        }
+        return os << value.bigValue().toString();
+    }
+
+    Literal::Literal(BigInt &&big) {
+        int64_t v;
+        if (big.toInt64(v) && Value::fitsSmall(v)) {
+            value = Value::small(static_cast<intptr_t>(v));
+        } else {
+            storage = std::make_shared<const BigInt>(std::move(big));
+            value = Value::big(storage.get());
+        }
+    }
+
+    bool Literal::toInt(int &out) const {
+        if (!value.isSmall() || value.smallValue() < INT_MIN || value.smallValue() > INT_MAX) {
+            return false;
+        }
+        out = static_cast<int>(value.smallValue());
+        return true;
+    }
+
+    namespace Arithmetic {
+        Value addSlow(Value a, Value b, BigIntArena &arena) {
+            return Value::fromBig(BigInt::add(a.toBig(), b.toBig()), arena);
+        }
+
+        Value subSlow(Value a, Value b, BigIntArena &arena) {
+            return Value::fromBig(BigInt::sub(a.toBig(), b.toBig()), arena);
+        }
+
+        Value mulSlow(Value a, Value b, BigIntArena &arena) {
+            return Value::fromBig(BigInt::mul(a.toBig(), b.toBig()), arena);
+        }
+
+        Value divSlow(Value a, Value b, BigIntArena &arena) {
+            BigInt quotient;
+            BigInt::divMod(a.toBig(), b.toBig(), &quotient, nullptr);
+            return Value::fromBig(std::move(quotient), arena);
+        }
+
+        Value modSlow(Value a, Value b, BigIntArena &arena) {
+            BigInt remainder;
+            BigInt::divMod(a.toBig(), b.toBig(), nullptr, &remainder);
+            return Value::fromBig(std::move(remainder), arena);
+        }
+    } // namespace Arithmetic
+} // namespace Rikkyu::Whitespace
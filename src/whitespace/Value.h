@@ -0,0 +1,238 @@
+#pragma once
+#ifndef RIK_WHITESPACE_VALUE
+#define RIK_WHITESPACE_VALUE
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "defs/defs.hpp"
+
+namespace Rikkyu::Whitespace {
+    // 任意精度整数，符号 + 32 位分段的绝对值（低位在前，无前导零，零的绝对值为空）。
+    // 对象创建之后不再修改，可以被多个 Value 共享引用。
+    class BigInt {
+    public:
+        BigInt() = default;
+        explicit BigInt(int64_t value);
+
+        static BigInt fromDecimal(const std::string &text, bool *ok = nullptr);
+
+        [[nodiscard]] bool isZero() const { return magnitude_.empty(); }
+        [[nodiscard]] bool isNegative() const { return negative_; }
+
+        // 能否放进 int64_t，能的话写入 out
+        bool toInt64(int64_t &out) const;
+
+        // 解析源码中的二进制字面量时使用：整体左移一位，再把 bit 放到最低位
+        void appendBit(bool bit);
+        void negate();
+
+        [[nodiscard]] std::string toString() const;
+
+        static BigInt add(const BigInt &a, const BigInt &b);
+        static BigInt sub(const BigInt &a, const BigInt &b);
+        static BigInt mul(const BigInt &a, const BigInt &b);
+        // 截断除法，与 C++ 的 / 和 % 语义一致；调用者保证 b 不为零
+        static void divMod(const BigInt &a, const BigInt &b, BigInt *quotient, BigInt *remainder);
+
+    private:
+        using Magnitude = std::vector<uint32_t>;
+
+        static int  compareMagnitude(const Magnitude &a, const Magnitude &b);
+        static void addMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &out);
+        static void subMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &out); // |a| >= |b|
+        static void divModMagnitude(const Magnitude &a, const Magnitude &b, Magnitude &q, Magnitude &r);
+        static void trim(Magnitude &m);
+
+        bool      negative_ = false;
+        Magnitude magnitude_;
+    };
+
+    // 大整数的分配区。运行期间产生的大整数都放在这里，地址稳定，随 Memory 一起释放。
+    // 分配数超过阈值后由 Memory::collect 在安全点把仍被引用的大整数复制出来，丢掉其余的。
+    class BigIntArena {
+    public:
+        static constexpr size_t kCollectThreshold = 4096;
+
+        BigIntArena() = default;
+        ~BigIntArena() = default;
+
+        BigIntArena(const BigIntArena &) = delete;
+        BigIntArena &operator=(const BigIntArena &) = delete;
+
+        const BigInt *make(BigInt &&value) {
+            storage_.push_back(std::move(value));
+            return &storage_.back();
+        }
+
+        [[nodiscard]] size_t size() const { return storage_.size(); }
+        [[nodiscard]] RIK_INLINE bool full() const { return storage_.size() >= limit_; }
+
+        void clear() {
+            storage_.clear();
+            limit_ = kCollectThreshold;
+        }
+
+        // roots(relocate) 对每个存活的 Value 调用一次 relocate，把它指向的大整数搬进新的分配区；
+        // 被多个 Value 共享的大整数只复制一份。下一次回收的阈值随存活数和根的数量增长，
+        // 保证回收的开销均摊到每次分配上是常数
+        template <typename Roots>
+        void collect(Roots &&roots);
+
+    private:
+        std::deque<BigInt> storage_;
+        size_t             limit_ = kCollectThreshold;
+    };
+
+    // Whitespace 的整数值。
+    // 最低位为 1 时表示一个机器字宽的小整数（其余位为值），为 0 时是指向 BigInt 的指针。
+    // 小整数始终是规范形式：能用小整数表示的结果绝不会以 BigInt 的形式出现。
+    class Value {
+    public:
+        static constexpr intptr_t kSmallMax = INTPTR_MAX >> 1;
+        static constexpr intptr_t kSmallMin = INTPTR_MIN >> 1;
+
+        Value() : bits_(1) {}
+
+        static RIK_INLINE bool fitsSmall(int64_t value) {
+            return value >= kSmallMin && value <= kSmallMax;
+        }
+
+        // 调用者保证 fitsSmall(value)
+        static RIK_INLINE Value small(intptr_t value) {
+            Value v;
+            v.bits_ = static_cast<intptr_t>(static_cast<uintptr_t>(value) << 1) | 1;
+            return v;
+        }
+
+        static RIK_INLINE Value big(const BigInt *value) {
+            Value v;
+            v.bits_ = reinterpret_cast<intptr_t>(value);
+            return v;
+        }
+
+        static Value fromInt64(int64_t value, BigIntArena &arena);
+        // 把运算结果规范化：能放进小整数的就不占用 arena
+        static Value fromBig(BigInt &&value, BigIntArena &arena);
+
+        [[nodiscard]] RIK_INLINE bool isSmall() const { return bits_ & 1; }
+        [[nodiscard]] RIK_INLINE intptr_t smallValue() const { return bits_ >> 1; }
+        [[nodiscard]] RIK_INLINE const BigInt &bigValue() const { return *reinterpret_cast<const BigInt *>(bits_); }
+
+        [[nodiscard]] RIK_INLINE bool isZero() const { return bits_ == 1; }
+        [[nodiscard]] RIK_INLINE bool isNegative() const {
+            return isSmall() ? smallValue() < 0 : bigValue().isNegative();
+        }
+
+        // 大整数转换为 BigInt 副本，小整数直接构造
+        [[nodiscard]] BigInt toBig() const;
+        [[nodiscard]] std::string toString() const;
+
+    private:
+        intptr_t bits_;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const Value &value);
+
+    template <typename Roots>
+    void BigIntArena::collect(Roots &&roots) {
+        std::deque<BigInt>                                live;
+        std::unordered_map<const BigInt *, const BigInt *> moved;
+        size_t                                            visited = 0;
+        roots([&](Value &value) {
+            ++visited;
+            if (value.isSmall()) {
+                return;
+            }
+            auto [it, inserted] = moved.try_emplace(&value.bigValue(), nullptr);
+            if (inserted) {
+                live.push_back(value.bigValue());
+                it->second = &live.back();
+            }
+            value = Value::big(it->second);
+        });
+        storage_.swap(live);
+        limit_ = std::max({kCollectThreshold, storage_.size() * 2, visited});
+    }
+
+    // 源码中的整数字面量。超出小整数范围的字面量由 storage 持有，value 指向它。
+    struct Literal {
+        Value                         value;
+        std::shared_ptr<const BigInt> storage;
+
+        Literal() = default;
+        explicit Literal(intptr_t small) : value(Value::small(small)) {}
+        explicit Literal(BigInt &&big);
+
+        // 作为 COPY / SLIDE 参数等需要普通整数的场合
+        [[nodiscard]] bool toInt(int &out) const;
+        [[nodiscard]] std::string toString() const { return value.toString(); }
+    };
+
+    // 整数运算。两边都是小整数时走内联的快速路径，溢出或遇到大整数时才进入慢速路径。
+    namespace Arithmetic {
+        Value addSlow(Value a, Value b, BigIntArena &arena);
+        Value subSlow(Value a, Value b, BigIntArena &arena);
+        Value mulSlow(Value a, Value b, BigIntArena &arena);
+        Value divSlow(Value a, Value b, BigIntArena &arena);
+        Value modSlow(Value a, Value b, BigIntArena &arena);
+
+        RIK_INLINE Value add(Value a, Value b, BigIntArena &arena) {
+            if (a.isSmall() && b.isSmall()) {
+                // 两个小整数都只占 intptr_t 的一半范围，和不会溢出 int64_t
+                const int64_t r = static_cast<int64_t>(a.smallValue()) + b.smallValue();
+                if (Value::fitsSmall(r)) {
+                    return Value::small(static_cast<intptr_t>(r));
+                }
+            }
+            return addSlow(a, b, arena);
+        }
+
+        RIK_INLINE Value sub(Value a, Value b, BigIntArena &arena) {
+            if (a.isSmall() && b.isSmall()) {
+                const int64_t r = static_cast<int64_t>(a.smallValue()) - b.smallValue();
+                if (Value::fitsSmall(r)) {
+                    return Value::small(static_cast<intptr_t>(r));
+                }
+            }
+            return subSlow(a, b, arena);
+        }
+
+        RIK_INLINE Value mul(Value a, Value b, BigIntArena &arena) {
+            if (a.isSmall() && b.isSmall()) {
+                int64_t r;
+                if (!__builtin_mul_overflow(static_cast<int64_t>(a.smallValue()), static_cast<int64_t>(b.smallValue()), &r) && Value::fitsSmall(r)) {
+                    return Value::small(static_cast<intptr_t>(r));
+                }
+            }
+            return mulSlow(a, b, arena);
+        }
+
+        // 除数为零由调用者事先检查
+        RIK_INLINE Value div(Value a, Value b, BigIntArena &arena) {
+            if (a.isSmall() && b.isSmall()) {
+                const int64_t r = static_cast<int64_t>(a.smallValue()) / b.smallValue();
+                if (Value::fitsSmall(r)) {
+                    return Value::small(static_cast<intptr_t>(r));
+                }
+            }
+            return divSlow(a, b, arena);
+        }
+
+        RIK_INLINE Value mod(Value a, Value b, BigIntArena &arena) {
+            if (a.isSmall() && b.isSmall()) {
+                return Value::small(static_cast<intptr_t>(static_cast<int64_t>(a.smallValue()) % b.smallValue()));
+            }
+            return modSlow(a, b, arena);
+        }
+    } // namespace Arithmetic
+} // namespace Rikkyu::Whitespace
+
+#endif // RIK_WHITESPACE_VALUE
@@ -3,7 +3,9 @@
 #define RIK_WS_ARITHMETIC_EXPRESSIONS
 
 #include "../AbstractExpression.h"
+#include "../Memory.h"
 #include "../Runner.h"
+#include "../Value.h"
 #include "../../utils/ErrorHandler/ErrorHandler.h"
 
 namespace Rikkyu::Whitespace {
@@ -11,9 +13,17 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   b = memory.stackPop();
-            int   a = memory.stackPop();
-            memory.stackPush(a + b);
+            Value b = memory.stackPopUnchecked();
+            Value a = memory.stackPopUnchecked();
+            memory.stackPush(Arithmetic::add(a, b, memory.arena()));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -29,9 +39,17 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   b = memory.stackPop();
-            int   a = memory.stackPop();
-            memory.stackPush(a - b);
+            Value b = memory.stackPopUnchecked();
+            Value a = memory.stackPopUnchecked();
+            memory.stackPush(Arithmetic::sub(a, b, memory.arena()));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -47,9 +65,17 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   b = memory.stackPop();
-            int   a = memory.stackPop();
-            memory.stackPush(a * b);
+            Value b = memory.stackPopUnchecked();
+            Value a = memory.stackPopUnchecked();
+            memory.stackPush(Arithmetic::mul(a, b, memory.arena()));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -65,12 +91,22 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   b = memory.stackPop();
-            int   a = memory.stackPop();
-            if (b == 0) {
+            Value b = memory.stackPopUnchecked();
+            Value a = memory.stackPopUnchecked();
+            if (b.isZero()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE07]: Division by Zero.", 0);
+                runner.halt();
+                return;
             }
-            memory.stackPush(a / b);
+            memory.stackPush(Arithmetic::div(a, b, memory.arena()));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -86,12 +122,22 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   b = memory.stackPop();
-            int   a = memory.stackPop();
-            if (b == 0) {
+            Value b = memory.stackPopUnchecked();
+            Value a = memory.stackPopUnchecked();
+            if (b.isZero()) {
                 utils::ErrorHandler::getInstance().makeError("[WSE08]: Mod by Zero.", 0);
+                runner.halt();
+                return;
             }
-            memory.stackPush(a % b);
+            memory.stackPush(Arithmetic::mod(a, b, memory.arena()));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
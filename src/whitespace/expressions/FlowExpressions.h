@@ -10,104 +10,164 @@
 namespace Rikkyu::Whitespace {
     class FlowMarkExpression : public Expression {
     public:
-        explicit FlowMarkExpression(std::string label, size_t position)
-            : label_(std::move(label)), position_(position) {}
+        explicit FlowMarkExpression(LabelId label, size_t position)
+            : label_(label), position_(position) {}
 
         void run(Runner &runner) const override {
             runner.setLabel(label_, position_);
         }
 
+        [[nodiscard]] bool startsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
 
         std::string toIR() const override {
-            return "LABEL " + label_;
+            return "LABEL " + std::to_string(label_);
+        }
+
+        [[nodiscard]] LabelId label() const {
+            return label_;
+        }
+
+        [[nodiscard]] size_t position() const {
+            return position_;
         }
 
     private:
-        std::string label_;
-        size_t      position_;
+        LabelId label_;
+        size_t  position_;
     };
 
     class FlowCallExpression : public Expression {
     public:
-        explicit FlowCallExpression(std::string label) : label_(std::move(label)) {}
+        explicit FlowCallExpression(LabelId label) : label_(label) {}
 
         void run(Runner &runner) const override {
             runner.call(label_);
         }
 
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
 
         std::string toIR() const override {
-            return "CALL " + label_;
+            return "CALL " + std::to_string(label_);
+        }
+
+        [[nodiscard]] LabelId label() const {
+            return label_;
         }
 
     private:
-        std::string label_;
+        LabelId label_;
     };
 
     class FlowJumpExpression : public Expression {
     public:
-        explicit FlowJumpExpression(std::string label) : label_(std::move(label)) {}
+        explicit FlowJumpExpression(LabelId label) : label_(label) {}
 
         void run(Runner &runner) const override {
             runner.jump(label_);
         }
 
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
 
         std::string toIR() const override {
-            return "JUMP " + label_;
+            return "JUMP " + std::to_string(label_);
+        }
+
+        [[nodiscard]] LabelId label() const {
+            return label_;
         }
 
     private:
-        std::string label_;
+        LabelId label_;
     };
 
     class FlowJumpZeroExpression : public Expression {
     public:
-        explicit FlowJumpZeroExpression(std::string label) : label_(std::move(label)) {}
+        explicit FlowJumpZeroExpression(LabelId label) : label_(label) {}
 
         void run(Runner &runner) const override {
             runner.jumpIfZero(label_);
         }
 
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
+        }
+
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
 
         std::string toIR() const override {
-            return "JUMP_ZERO " + label_;
+            return "JUMP_ZERO " + std::to_string(label_);
+        }
+
+        [[nodiscard]] LabelId label() const {
+            return label_;
         }
 
     private:
-        std::string label_;
+        LabelId label_;
     };
 
     class FlowJumpNegativeExpression : public Expression {
     public:
-        explicit FlowJumpNegativeExpression(std::string label) : label_(std::move(label)) {}
+        explicit FlowJumpNegativeExpression(LabelId label) : label_(label) {}
 
         void run(Runner &runner) const override {
             runner.jumpIfNegative(label_);
         }
 
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
+        }
+
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
 
         std::string toIR() const override {
-            return "JUMP_NEG " + label_;
+            return "JUMP_NEG " + std::to_string(label_);
+        }
+
+        [[nodiscard]] LabelId label() const {
+            return label_;
         }
 
     private:
-        std::string label_;
+        LabelId label_;
     };
 
     class FlowReturnExpression : public Expression {
@@ -116,6 +176,10 @@ namespace Rikkyu::Whitespace {
             runner.returnFromCall();
         }
 
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
@@ -131,6 +195,10 @@ namespace Rikkyu::Whitespace {
             runner.exit();
         }
 
+        [[nodiscard]] bool endsBlock() const override {
+            return true;
+        }
+
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
@@ -3,6 +3,7 @@
 #define RIK_WS_HEAP_EXPRESSIONS
 
 #include "../AbstractExpression.h"
+#include "../Memory.h"
 #include "../Runner.h"
 
 namespace Rikkyu::Whitespace {
@@ -10,27 +11,53 @@ namespace Rikkyu::Whitespace {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   value = memory.stackPop();
-            int   address = memory.stackPop();
-            memory.heapStore(address, value);
+            Value value = memory.stackPopUnchecked();
+            Value address = memory.stackPopUnchecked();
+            if (!memory.heapStore(address, value)) {
+                runner.halt();
+            }
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -2;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
+
+        std::string toIR() const override {
+            return "STORE";
+        }
     };
 
     class HeapRetrieveExpression : public Expression {
     public:
         void run(Runner &runner) const override {
             auto &memory = runner.memory();
-            int   address = memory.stackPop();
-            memory.stackPush(memory.heapRetrieve(address));
+            Value value;
+            if (!memory.heapRetrieve(memory.stackPopUnchecked(), value)) {
+                runner.halt();
+                return;
+            }
+            memory.stackPush(value);
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
             visitor.visit(*this);
         }
+
+        std::string toIR() const override {
+            return "RETRIEVE";
+        }
     };
 } // namespace Rikkyu::Whitespace
 
@@ -3,14 +3,24 @@
 #define RIK_WS_IO_EXPRESSIONS
 
 #include "../AbstractExpression.h"
+#include "../Memory.h"
 #include "../Runner.h"
-#include <iostream>
+#include "../RuntimeIO.h"
+#include "../Value.h"
 
 namespace Rikkyu::Whitespace {
     class IOOutputCharExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            std::cout << static_cast<char>(runner.memory().stackPop());
+            RuntimeIO::writeChar(runner.output(), runner.memory().stackPopUnchecked());
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -25,7 +35,15 @@ namespace Rikkyu::Whitespace {
     class IOOutputNumExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            std::cout << runner.memory().stackPop();
+            RuntimeIO::writeNumber(runner.output(), runner.memory().stackPopUnchecked());
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -40,9 +58,17 @@ namespace Rikkyu::Whitespace {
     class IOInputCharExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            char c;
-            std::cin >> c;
-            runner.memory().heapStore(runner.memory().stackPop(), static_cast<int>(c));
+            if (!runner.memory().heapStore(runner.memory().stackPopUnchecked(), RuntimeIO::readChar(runner.input()))) {
+                runner.halt();
+            }
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -57,9 +83,23 @@ namespace Rikkyu::Whitespace {
     class IOInputNumExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            int n;
-            std::cin >> n;
-            runner.memory().heapStore(runner.memory().stackPop(), n);
+            auto &memory = runner.memory();
+            Value value;
+            if (!RuntimeIO::readNumber(runner.input(), memory.arena(), value)) {
+                runner.halt();
+                return;
+            }
+            if (!memory.heapStore(memory.stackPopUnchecked(), value)) {
+                runner.halt();
+            }
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
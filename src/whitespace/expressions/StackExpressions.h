@@ -3,16 +3,22 @@
 #define RIK_WS_STACK_EXPRESSIONS
 
 #include "../AbstractExpression.h"
+#include "../Memory.h"
 #include "../Runner.h"
+#include "../Value.h"
 
 namespace Rikkyu::Whitespace {
     class Runner;
     class StackPushExpression : public Expression {
     public:
-        explicit StackPushExpression(int value) : value_(value) {}
+        explicit StackPushExpression(Literal value) : value_(std::move(value)) {}
 
         void run(Runner &runner) const override {
-            runner.memory().stackPush(value_);
+            runner.memory().stackPush(value_.value);
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return 1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -20,17 +26,29 @@ namespace Rikkyu::Whitespace {
         }
 
         std::string toIR() const override {
-            return "PUSH " + std::to_string(value_);
+            return "PUSH " + value_.toString();
+        }
+
+        [[nodiscard]] const Literal &value() const {
+            return value_;
         }
 
     private:
-        int value_;
+        Literal value_;
     };
 
     class StackDuplicateExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            runner.memory().stackDuplicate();
+            runner.memory().stackDuplicateUnchecked();
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return 1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -47,7 +65,15 @@ namespace Rikkyu::Whitespace {
         explicit StackCopyExpression(int n) : n_(n) {}
 
         void run(Runner &runner) const override {
-            runner.memory().stackCopy(n_);
+            runner.memory().stackCopyUnchecked(static_cast<size_t>(n_));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return n_ < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(n_) + 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return 1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -58,6 +84,10 @@ namespace Rikkyu::Whitespace {
             return "COPY " + std::to_string(n_);
         }
 
+        [[nodiscard]] int n() const {
+            return n_;
+        }
+
     private:
         int n_;
     };
@@ -65,7 +95,11 @@ namespace Rikkyu::Whitespace {
     class StackSwapExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            runner.memory().stackSwap();
+            runner.memory().stackSwapUnchecked();
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 2;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -80,7 +114,15 @@ namespace Rikkyu::Whitespace {
     class StackDiscardExpression : public Expression {
     public:
         void run(Runner &runner) const override {
-            runner.memory().stackDiscard();
+            runner.memory().stackDiscardUnchecked();
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -1;
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -97,7 +139,15 @@ namespace Rikkyu::Whitespace {
         explicit StackSlideExpression(int n) : n_(n) {}
 
         void run(Runner &runner) const override {
-            runner.memory().stackSlide(n_);
+            runner.memory().stackSlideUnchecked(static_cast<size_t>(n_));
+        }
+
+        [[nodiscard]] size_t stackRequired() const override {
+            return n_ < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(n_) + 1;
+        }
+
+        [[nodiscard]] std::ptrdiff_t stackDelta() const override {
+            return -static_cast<std::ptrdiff_t>(n_);
         }
 
         void accept(ExpressionVisitor &visitor) const override {
@@ -108,9 +158,45 @@ namespace Rikkyu::Whitespace {
             return "SLIDE " + std::to_string(n_);
         }
 
+        [[nodiscard]] int n() const {
+            return n_;
+        }
+
     private:
         int n_;
     };
+
+    // 基本块入口的栈深度检查，由 Parser 自动插入。
+    // 块内其余指令都使用不做检查的栈操作，下溢检查只在这里做一次。
+    class StackGuardExpression : public Expression {
+    public:
+        explicit StackGuardExpression(size_t required = 0) : required_(required) {}
+
+        void run(Runner &runner) const override {
+            if (!runner.memory().stackRequire(required_)) {
+                runner.halt();
+            }
+        }
+
+        void accept(ExpressionVisitor &visitor) const override {
+            visitor.visit(*this);
+        }
+
+        std::string toIR() const override {
+            return "GUARD " + std::to_string(required_);
+        }
+
+        [[nodiscard]] size_t required() const {
+            return required_;
+        }
+
+        void require(size_t required) {
+            required_ = required;
+        }
+
+    private:
+        size_t required_;
+    };
 } // namespace Rikkyu::Whitespace
 
 #endif // RIK_WS_STACK_EXPRESSIONS
\ No newline at end of file
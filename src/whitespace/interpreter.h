@@ -2,12 +2,7 @@
 #ifndef RIK_WHITESPACE_INTERPRETER
 #define RIK_WHITESPACE_INTERPRETER
 
-#include <array>
-#include <exception>
-#include <iostream>
-#include <map>
 #include <memory>
-#include <stack>
 #include <string>
 #include <utility>
 #include <vector>
@@ -18,6 +13,8 @@
 #include "defs/defs.hpp"
 #include "Memory.h"
 #include "Runner.h"
+#include "Tokenizer.h"
+#include "Value.h"
 #include "expressions/StackExpressions.h"
 #include "expressions/ArithmeticExpressions.h"
 #include "expressions/HeapExpressions.h"
@@ -30,265 +27,171 @@ namespace Rikkyu::Whitespace {
         Parser() = default;
         ~Parser() = default;
         
-        // 计算给定位置的行号和列号
-        std::pair<size_t, size_t> calculateLineCol(const std::vector<char> &code, size_t pos) {
-            size_t line = 1;
-            size_t col = 1;
-            
-            for (size_t i = 0; i < pos && i < code.size(); ++i) {
-                if (code[i] == '\n') {
-                    line++;
-                    col = 1;
-                } else {
-                    col++;
-                }
-            }
-            
-            return {line, col};
+        // 解析过程中驻留的标签，编号即 FlowXxxExpression 持有的 LabelId
+        [[nodiscard]] const LabelTable &labels() const {
+            return labels_;
         }
 
         ExpressionVector parse(const std::vector<char> &code) {
             ExpressionVector expressions;
-            size_t           pos = 0;
-
-            while (pos < code.size()) {
-                if (code[pos] != ' ' && code[pos] != '\t' && code[pos] != '\n') {
-                    ++pos;
-                    continue;
-                }
-
-                try {
-                    if (code[pos] == ' ') {
-                        ++pos;
-                        if (pos >= code.size())
-                            break;
-
-                        if (code[pos] == ' ') { // Stack manipulation
-                            ++pos;
-                            if (pos >= code.size()) break;
-                            
-                            if (code[pos] == ' ') { // Push number
-                                ++pos;
-                                auto [value, newPos] = parseNumber(code, pos);
-                                expressions.push_back(std::make_unique<StackPushExpression>(value));
-                                pos = newPos;
-                            }
-                        } else if (code[pos] == '\t') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
-
-                            if (code[pos] == ' ') { // Copy
-                                ++pos;
-                                auto [n, newPos] = parseNumber(code, pos);
-                                expressions.push_back(std::make_unique<StackCopyExpression>(n));
-                                pos = newPos;
-                            } else if (code[pos] == '\t') { // Swap
-                                ++pos;
-                                expressions.push_back(std::make_unique<StackSwapExpression>());
-                            } else if (code[pos] == '\n') { // Discarding
-                                ++pos;
-                                expressions.push_back(std::make_unique<StackDiscardExpression>());
-                            }
-                        } else if (code[pos] == '\n') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
-
-                            if (code[pos] == ' ') { // Copy the top element in the stack
-                                ++pos;
-                                expressions.push_back(std::make_unique<StackDuplicateExpression>());
-                            } else if (code[pos] == '\t') { // Slide the stack
-                                ++pos;
-                                auto [n, newPos] = parseNumber(code, pos);
-                                expressions.push_back(std::make_unique<StackSlideExpression>(n));
-                                pos = newPos;
-                            }
-                        }
-                    } else if (code[pos] == '\t') {
-                        ++pos;
-                        if (pos >= code.size())
-                            break;
-
-                        if (code[pos] == ' ') { // Arithmetic
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
-
-                            if (code[pos] == ' ') { // Add
-                                ++pos;
-                                expressions.push_back(std::make_unique<ArithmeticAddExpression>());
-                            } else if (code[pos] == '\t') { // Subtraction
-                                ++pos;
-                                expressions.push_back(std::make_unique<ArithmeticSubExpression>());
-                            } else if (code[pos] == '\n') { // Multiplication
-                                ++pos;
-                                expressions.push_back(std::make_unique<ArithmeticMulExpression>());
-                            }
-                        } else if (code[pos] == '\t') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
-
-                            if (code[pos] == ' ') { // Division
-                                ++pos;
-                                expressions.push_back(std::make_unique<ArithmeticDivExpression>());
-                            } else if (code[pos] == '\t') { // Modulus
-                                ++pos;
-                                expressions.push_back(std::make_unique<ArithmeticModExpression>());
-                            } else if (code[pos] == '\n') { // Heap Store
-                                ++pos;
-                                expressions.push_back(std::make_unique<HeapStoreExpression>());
-                            }
-                        } else if (code[pos] == '\n') { // Heap Reading and IO
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
-
-                            if (code[pos] == ' ') { // Heap Read
-                                ++pos;
-                                expressions.push_back(std::make_unique<HeapRetrieveExpression>());
-                            } else if (code[pos] == '\t') { // Output Character
-                                ++pos;
-                                expressions.push_back(std::make_unique<IOOutputCharExpression>());
-                            } else if (code[pos] == '\n') { // Output Number
-                                ++pos;
-                                expressions.push_back(std::make_unique<IOOutputNumExpression>());
-                            }
-                        }
-                    } else if (code[pos] == '\n') {
-                        ++pos;
-                        if (pos >= code.size())
-                            break;
-
-                        if (code[pos] == ' ') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
+            Tokenizer        tokenizer(code.data(), code.size(), labels_);
+            parse(tokenizer, expressions);
+            return expressions;
+        }
 
-                            if (code[pos] == ' ') {
-                                ++pos;
-                                auto [label, newPos] = parseLabel(code, pos);
-                                expressions.push_back(std::make_unique<FlowMarkExpression>(label, expressions.size()));
-                                pos = newPos;
-                            } else if (code[pos] == '\t') {
-                                ++pos;
-                                auto [label, newPos] = parseLabel(code, pos);
-                                expressions.push_back(std::make_unique<FlowCallExpression>(label));
-                                pos = newPos;
-                            } else if (code[pos] == '\n') {
-                                ++pos;
-                                auto [label, newPos] = parseLabel(code, pos);
-                                expressions.push_back(std::make_unique<FlowJumpExpression>(label));
-                                pos = newPos;
-                            }
-                        } else if (code[pos] == '\t') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
+        // 增量解析（REPL）：把新输入的一段源码解析后追加到 program 末尾，返回追加的第一条指令的下标。
+        // 标签表和 MARK 记录的下标都接着 program 累计；末尾没有写完的指令先留着，和下一段源码一起解析。
+        // 错误位置相对于这一段（连同留下的部分）的开头
+        size_t feed(const char *code, size_t size, ExpressionVector &program) {
+            partial_.insert(partial_.end(), code, code + size);
+            Tokenizer tokenizer(partial_.data(), partial_.size(), labels_);
+            tokenizer.setStreaming(true);
+            const size_t first = program.size();
+            parse(tokenizer, program);
+            partial_.erase(partial_.begin(), partial_.begin() + static_cast<std::ptrdiff_t>(tokenizer.pending()));
+            return first;
+        }
 
-                            if (code[pos] == ' ') {
-                                ++pos;
-                                auto [label, newPos] = parseLabel(code, pos);
-                                expressions.push_back(std::make_unique<FlowJumpZeroExpression>(label));
-                                pos = newPos;
-                            } else if (code[pos] == '\t') {
-                                ++pos;
-                                auto [label, newPos] = parseLabel(code, pos);
-                                expressions.push_back(std::make_unique<FlowJumpNegativeExpression>(label));
-                                pos = newPos;
-                            } else if (code[pos] == '\n') {
-                                ++pos;
-                                expressions.push_back(std::make_unique<FlowReturnExpression>());
-                            }
-                        } else if (code[pos] == '\n') {
-                            ++pos;
-                            if (pos >= code.size())
-                                break;
+        // 是否有一条还没写完的指令在等后续源码
+        [[nodiscard]] bool incomplete() const {
+            return !partial_.empty();
+        }
 
-                            if (code[pos] == ' ') {
-                                ++pos;
-                                expressions.push_back(std::make_unique<FlowExitExpression>());
-                            } else if (code[pos] == '\t') {
-                                ++pos;
-                                expressions.push_back(std::make_unique<IOInputCharExpression>());
-                            } else if (code[pos] == '\n') {
-                                ++pos;
-                                expressions.push_back(std::make_unique<IOInputNumExpression>());
-                            }
-                        }
-                    }
-                } catch (const std::exception &e) {
-                    auto [line, col] = calculateLineCol(code, pos);
-                    utils::ErrorHandler::getInstance().makeError(
-                        utils::StringBuilder::concatenate("[WSE09]: Parse error at line ", std::to_string(line), ", column ", std::to_string(col), ": ", e.what()),
-                        pos);
+    private:
+        LabelTable        labels_;
+        std::vector<char> partial_; // feed() 留下的未完成指令
+
+        // 当前基本块入口处的检查指令，以及块内相对入口的栈深度
+        StackGuardExpression *guard_ = nullptr;
+        std::ptrdiff_t        blockDepth_ = 0;
+
+        // 读完 tokenizer 中的全部指令，追加到 expressions 末尾
+        void parse(Tokenizer &tokenizer, ExpressionVector &expressions) {
+            Token token;
+            guard_ = nullptr;
+
+            while (tokenizer.next(token)) {
+                switch (token.kind) {
+                    case Token::Kind::Push:
+                        emit(expressions, std::make_unique<StackPushExpression>(token.number));
+                        break;
+                    case Token::Kind::Duplicate:
+                        emit(expressions, std::make_unique<StackDuplicateExpression>());
+                        break;
+                    case Token::Kind::Copy:
+                        emit(expressions, std::make_unique<StackCopyExpression>(parseIndex(tokenizer, token)));
+                        break;
+                    case Token::Kind::Swap:
+                        emit(expressions, std::make_unique<StackSwapExpression>());
+                        break;
+                    case Token::Kind::Discard:
+                        emit(expressions, std::make_unique<StackDiscardExpression>());
+                        break;
+                    case Token::Kind::Slide:
+                        emit(expressions, std::make_unique<StackSlideExpression>(parseIndex(tokenizer, token)));
+                        break;
+                    case Token::Kind::Add:
+                        emit(expressions, std::make_unique<ArithmeticAddExpression>());
+                        break;
+                    case Token::Kind::Sub:
+                        emit(expressions, std::make_unique<ArithmeticSubExpression>());
+                        break;
+                    case Token::Kind::Mul:
+                        emit(expressions, std::make_unique<ArithmeticMulExpression>());
+                        break;
+                    case Token::Kind::Div:
+                        emit(expressions, std::make_unique<ArithmeticDivExpression>());
+                        break;
+                    case Token::Kind::Mod:
+                        emit(expressions, std::make_unique<ArithmeticModExpression>());
+                        break;
+                    case Token::Kind::Store:
+                        emit(expressions, std::make_unique<HeapStoreExpression>());
+                        break;
+                    case Token::Kind::Retrieve:
+                        emit(expressions, std::make_unique<HeapRetrieveExpression>());
+                        break;
+                    case Token::Kind::Mark:
+                        emit(expressions, std::make_unique<FlowMarkExpression>(token.label, expressions.size()));
+                        break;
+                    case Token::Kind::Call:
+                        emit(expressions, std::make_unique<FlowCallExpression>(token.label));
+                        break;
+                    case Token::Kind::Jump:
+                        emit(expressions, std::make_unique<FlowJumpExpression>(token.label));
+                        break;
+                    case Token::Kind::JumpZero:
+                        emit(expressions, std::make_unique<FlowJumpZeroExpression>(token.label));
+                        break;
+                    case Token::Kind::JumpNegative:
+                        emit(expressions, std::make_unique<FlowJumpNegativeExpression>(token.label));
+                        break;
+                    case Token::Kind::Return:
+                        emit(expressions, std::make_unique<FlowReturnExpression>());
+                        break;
+                    case Token::Kind::Exit:
+                        emit(expressions, std::make_unique<FlowExitExpression>());
+                        break;
+                    case Token::Kind::OutChar:
+                        emit(expressions, std::make_unique<IOOutputCharExpression>());
+                        break;
+                    case Token::Kind::OutNum:
+                        emit(expressions, std::make_unique<IOOutputNumExpression>());
+                        break;
+                    case Token::Kind::InChar:
+                        emit(expressions, std::make_unique<IOInputCharExpression>());
+                        break;
+                    case Token::Kind::InNum:
+                        emit(expressions, std::make_unique<IOInputNumExpression>());
+                        break;
                 }
             }
-
-            return expressions;
         }
 
-    private:
-        std::pair<int, size_t> parseNumber(const std::vector<char> &code, size_t pos) {
-            if (pos >= code.size()) {
-                auto [line, col] = calculateLineCol(code, pos);
-                utils::ErrorHandler::getInstance().makeError(
-                    utils::StringBuilder::concatenate("[WSE10]: Expected number at line ", std::to_string(line), ", column ", std::to_string(col)),
-                    pos);
+        // 追加一条指令，同时维护基本块的入口栈深度检查：
+        // 每个块开头放一条 GUARD，块内指令的栈需求都累计到这条 GUARD 上
+        void emit(ExpressionVector &expressions, ExpressionPtr expression) {
+            if (expression->startsBlock()) {
+                guard_ = nullptr;
+                expressions.push_back(std::move(expression));
+                return;
             }
 
-            bool isNegative = false;
-            if (code[pos] == '\t') {
-                isNegative = true;
-            } else if (code[pos] != ' ') {
-                auto [line, col] = calculateLineCol(code, pos);
-                utils::ErrorHandler::getInstance().makeError(
-                    utils::StringBuilder::concatenate("[WSE11]: Invalid number sign at line ", std::to_string(line), ", column ", std::to_string(col)),
-                    pos);
+            if (!guard_) {
+                auto guard = std::make_unique<StackGuardExpression>();
+                guard_ = guard.get();
+                blockDepth_ = 0;
+                expressions.push_back(std::move(guard));
             }
 
-            ++pos;
-            int value = 0;
-            while (pos < code.size() && code[pos] != '\n') {
-                if (code[pos] == ' ' || code[pos] == '\t') {
-                    value <<= 1;
-                    if (code[pos] == '\t') {
-                        value |= 1;
-                    }
-                }
-                ++pos;
+            // 块入口至少需要 required - blockDepth_ 个元素才能让这条指令安全执行
+            const size_t required = expression->stackRequired();
+            if (required == static_cast<size_t>(-1) || guard_->required() == static_cast<size_t>(-1)) {
+                // 负数的 COPY / SLIDE 参数永远无法满足，整个块在入口处报错
+                guard_->require(static_cast<size_t>(-1));
+            } else if (static_cast<std::ptrdiff_t>(required) - blockDepth_ > static_cast<std::ptrdiff_t>(guard_->required())) {
+                guard_->require(static_cast<size_t>(static_cast<std::ptrdiff_t>(required) - blockDepth_));
             }
+            blockDepth_ += expression->stackDelta();
 
-            if (pos < code.size() && code[pos] == '\n') {
-                ++pos;
+            const bool endsBlock = expression->endsBlock();
+            expressions.push_back(std::move(expression));
+            if (endsBlock) {
+                guard_ = nullptr;
             }
-
-            return {isNegative ? -value : value, pos};
         }
 
-        std::pair<std::string, size_t> parseLabel(const std::vector<char> &code, size_t pos) {
-            std::string label;
-
-            while (pos < code.size() && code[pos] != '\n') {
-                if (code[pos] == ' ' || code[pos] == '\t') {
-                    label += (code[pos] == ' ' ? '0' : '1');
-                }
-                ++pos;
-            }
-
-            if (pos < code.size() && code[pos] == '\n') {
-                ++pos;
-            }
-
-            if (label.empty()) {
-                auto [line, col] = calculateLineCol(code, pos);
+        // COPY / SLIDE 的参数必须是普通整数；过大时报错，并以 -1 代替，使该基本块在运行时被检查拦下
+        static int parseIndex(Tokenizer &tokenizer, const Token &token) {
+            int n;
+            if (!token.number.toInt(n)) {
+                auto [line, col] = tokenizer.locate(token.argument);
                 utils::ErrorHandler::getInstance().makeError(
-                    utils::StringBuilder::concatenate("[WSE12]: Empty label at line ", std::to_string(line), ", column ", std::to_string(col)),
-                    pos);
+                    utils::StringBuilder::concatenate("[WSE15]: Stack index too large at line ", std::to_string(line), ", column ", std::to_string(col)),
+                    token.argument);
+                return -1;
             }
-
-            return {label, pos};
+            return n;
         }
     };
 } // namespace Rikkyu::Whitespace
@@ -0,0 +1,50 @@
+// 常驻解释器服务：在 Unix 域套接字上接受 Brainfuck / Whitespace / Befunge 程序并流式返回输出
+//   用法: RikkyuDaemon [socket-path] [workers] [cache-entries]
+// 收到 SIGINT / SIGTERM 后停止接受连接，等待正在执行的请求结束后退出。
+
+#include "server/Daemon.h"
+#include "utils/ErrorHandler/ErrorHandler.h"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <pthread.h>
+#include <thread>
+
+int main(int argc, char **argv) {
+    Rikkyu::Server::DaemonOptions options;
+    if (argc > 1) {
+        options.socketPath = argv[1];
+    }
+    if (argc > 2) {
+        options.workers = std::strtoul(argv[2], nullptr, 10);
+    }
+    if (argc > 3) {
+        options.cacheEntries = std::strtoul(argv[3], nullptr, 10);
+    }
+
+    // 信号只由下面的线程用 sigwait 接收，这样 stop() 不会在信号处理函数里执行。
+    // 必须在创建任何线程之前屏蔽，工作线程会继承这个屏蔽字
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Rikkyu::Server::Daemon daemon(options);
+    std::thread            waiter([&daemon, signals] {
+        int signal = 0;
+        sigwait(&signals, &signal);
+        daemon.stop();
+    });
+    waiter.detach();
+
+    std::cerr << "Listening on " << options.socketPath << " with " << options.workers << " workers" << std::endl;
+    if (!daemon.serve()) {
+        Rikkyu::utils::ErrorHandler::getInstance().printErrors();
+        return 1;
+    }
+
+    const auto statistics = daemon.cacheStatistics();
+    std::cerr << "Cache: " << statistics.hits << " hits, " << statistics.misses << " misses, " << statistics.evictions << " evictions" << std::endl;
+    return 0;
+}
@@ -0,0 +1,443 @@
+// 命令行运行器：执行一个 Brainfuck / Whitespace 程序，可选按阶段报告硬件性能计数器
+//   用法: RikkyuRun [--perf-counters] [--engine=vm|tree] [--loop-cache] [--language=bf|ws] [--threads=N] <source>
+//         RikkyuRun --batch [--language=bf|ws] [--threads=N] <source> <input>...
+//         RikkyuRun --repl --language=bf|ws
+// 语言默认按扩展名判断（.bf / .b 为 Brainfuck，.ws / .whs 为 Whitespace）。
+// --engine 只对 Brainfuck 有效：vm 为降低到 IR 并优化后在 IR::VM 上执行（默认），tree 为直接执行语法树。
+// --threads 是解析和优化 Brainfuck 源码的线程数，默认为 CPU 核数。
+// --loop-cache 用树解释器执行 Brainfuck，并开启纯循环的结果记忆（见 Brainfuck::LoopCache），
+// 结束时在标准错误上输出命中统计。
+//
+// --perf-counters 把运行分成解析 / 优化 / 执行三个阶段，在标准错误上输出每个阶段的
+// 周期数、指令数、IPC、分支预测失败和 L1d / LLC 读缺失。执行阶段之后会用同一份输入
+// 再跑一遍不计时的计数版本，得到执行的程序指令条数，换算成每条程序指令的开销。
+// 计数器不可用时（权限、虚拟机、非 Linux）仍然输出各阶段的墙上时间。
+//
+// --batch 用同一个程序处理多个输入文件，每个的输出写到 <input>.out。第一次读输入之前的执行
+// 只进行一次，之后每个输入从这个快照在 --threads 个线程上继续（见 IR::BatchRunner）。
+//
+// --repl 是交互式会话：每输入一行就追加到程序末尾，只解析新的部分，在树解释器上接着上一行结束时的
+// 纸带 / 栈 / 堆继续执行。跨行的 '['（Whitespace 为没写完的指令）会显示续行提示，等后面的行补全。
+
+#include "brainfuck/LoopCache.h"
+#include "brainfuck/ParallelLoader.h"
+#include "ir/BatchRunner.h"
+#include "ir/PassManager.h"
+#include "ir/VM.h"
+#include "utils/BufferedIO/BufferedIO.h"
+#include "utils/ErrorHandler/ErrorHandler.h"
+#include "utils/PerfCounters/PerfCounters.h"
+#include "whitespace/Compiler.h"
+#include "whitespace/Engine.h"
+#include "whitespace/IRLowering.h"
+#include "whitespace/interpreter.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace Rikkyu;
+
+namespace {
+    enum class Language { Unknown, Brainfuck, Whitespace };
+
+    struct Phase {
+        const char                  *name;
+        utils::PerfCounters::Sample  sample{};
+        bool                         ran = false;
+    };
+
+    Language languageOf(const std::string &path) {
+        const auto dot = path.find_last_of('.');
+        const std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+        if (extension == "bf" || extension == "b") {
+            return Language::Brainfuck;
+        }
+        if (extension == "ws" || extension == "whs") {
+            return Language::Whitespace;
+        }
+        return Language::Unknown;
+    }
+
+    // 只在需要重放输入时才把标准输入整个读进内存
+    std::string readAll(FILE *file) {
+        std::string data;
+        char        buffer[1 << 16];
+        size_t      count;
+        while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.append(buffer, count);
+        }
+        return data;
+    }
+
+    void discard(void *, const char *, size_t) {}
+
+    bool failed() {
+        for (const auto &error : utils::ErrorHandler::getInstance().getErrors()) {
+            if (error.type == utils::ErrorType::ET_CriticalError) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int runBatch(Language language, std::vector<char> &code, const std::vector<std::string> &paths, size_t threads) {
+        auto      &handler = utils::ErrorHandler::getInstance();
+        IR::Module module;
+        if (language == Language::Brainfuck) {
+            const Brainfuck::ParallelLoader loader(threads);
+            auto                            expressions = loader.parse(code);
+            if (failed()) {
+                handler.printErrors();
+                return 1;
+            }
+            module = loader.lower(expressions);
+        } else {
+            Whitespace::Parser parser;
+            auto               expressions = parser.parse(code);
+            if (failed() || !Whitespace::IRLowering().lower(Whitespace::Compiler().compile(expressions, parser.labels()), module)) {
+                handler.printErrors();
+                return 1;
+            }
+            IR::PassManager::standard().run(module);
+        }
+        handler.clearErrors();
+
+        std::vector<std::string> inputs;
+        inputs.reserve(paths.size());
+        for (const auto &path : paths) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "错误: 无法打开文件 " << path << std::endl;
+                return 1;
+            }
+            inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        IR::BatchRunner runner(threads);
+        const auto      results = runner.run(module, inputs);
+        size_t          failures = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            std::ofstream out(paths[i] + ".out", std::ios::binary);
+            out.write(results[i].output.data(), static_cast<std::streamsize>(results[i].output.size()));
+            if (!out) {
+                std::cerr << "错误: 无法写入文件 " << paths[i] << ".out" << std::endl;
+                return 1;
+            }
+            for (const auto &diagnostic : results[i].diagnostics) {
+                std::cerr << paths[i] << ": " << diagnostic.text << std::endl;
+            }
+            failures += results[i].ok ? 0 : 1;
+        }
+        std::cerr << results.size() << " inputs, " << failures << " failed; shared prefix " << runner.prefixSeconds() * 1e3 << " ms"
+                  << (runner.prefixReachedInput() ? "" : " (program finished without reading input)") << std::endl;
+        return failures ? 1 : 0;
+    }
+
+    // 程序的输入与会话共用标准输入：一行里的 ',' 读到的是这一行之后的内容。提示符写到标准错误
+    int runRepl(Language language) {
+        auto                  &handler = utils::ErrorHandler::getInstance();
+        utils::BufferedInput  &input = utils::BufferedInput::standardInput();
+        utils::BufferedOutput &output = utils::BufferedOutput::standardOutput();
+        std::string            line;
+        auto                   readLine = [&](bool continued) {
+            output.flush();
+            std::cerr << (continued ? "...> " : language == Language::Brainfuck ? "bf> " : "ws> ") << std::flush;
+            line.clear();
+            for (int c; (c = input.get()) != EOF;) {
+                line.push_back(static_cast<char>(c));
+                if (c == '\n') {
+                    return true;
+                }
+            }
+            return !line.empty();
+        };
+        auto report = [&] {
+            handler.printErrors();
+            handler.clearErrors();
+        };
+
+        bool incomplete = false;
+        if (language == Language::Brainfuck) {
+            Brainfuck::Parser parser;
+            Brainfuck::Runner runner;
+            runner.setIO(input, output);
+            while (readLine(parser.openLoops() != 0)) {
+                runner.run(parser.feed(line.data(), line.size()));
+                report();
+            }
+            incomplete = parser.openLoops() != 0;
+        } else {
+            // 程序只增不减，之前的行仍然可以作为跳转和调用的目标；跳向之后才输入的标签时执行会停下来等它
+            Whitespace::Parser           parser;
+            Whitespace::ExpressionVector program;
+            Whitespace::Runner           runner;
+            runner.setIO(input, output);
+            runner.setLabels(parser.labels());
+            while (readLine(parser.incomplete())) {
+                const size_t first = parser.feed(line.data(), line.size(), program);
+                if (failed()) {
+                    // 有语法错误的一行整行作废
+                    program.erase(program.begin() + static_cast<std::ptrdiff_t>(first), program.end());
+                } else if (program.size() > first) {
+                    runner.resume(program, first);
+                }
+                report();
+            }
+            runner.finish();
+            report();
+            incomplete = parser.incomplete();
+        }
+        output.flush();
+        if (incomplete) {
+            std::cerr << "\n错误: 输入结束时还有未完成的代码" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    void printCount(const utils::PerfCounters::Sample &sample, utils::PerfCounters::Event event) {
+        if (sample.has(event)) {
+            std::fprintf(stderr, " %14" PRIu64, sample[event]);
+        } else {
+            std::fprintf(stderr, " %14s", "-");
+        }
+    }
+
+    void printReport(const utils::PerfCounters &counters, const Phase *phases, size_t count, uint64_t executed) {
+        using Event = utils::PerfCounters::Event;
+
+        std::fprintf(stderr, "\n%-9s %10s %14s %14s %6s %14s %14s %14s\n", "phase", "wall(ms)", "cycles", "instructions", "IPC",
+                     "branch-misses", "L1d-misses", "LLC-misses");
+        for (size_t i = 0; i < count; ++i) {
+            const auto &sample = phases[i].sample;
+            if (!phases[i].ran) {
+                std::fprintf(stderr, "%-9s %10s\n", phases[i].name, "skipped");
+                continue;
+            }
+            std::fprintf(stderr, "%-9s %10.3f", phases[i].name, sample.wallSeconds * 1e3);
+            printCount(sample, Event::Cycles);
+            printCount(sample, Event::Instructions);
+            if (sample.has(Event::Cycles) && sample.has(Event::Instructions) && sample[Event::Cycles]) {
+                std::fprintf(stderr, " %6.2f", static_cast<double>(sample[Event::Instructions]) / sample[Event::Cycles]);
+            } else {
+                std::fprintf(stderr, " %6s", "-");
+            }
+            printCount(sample, Event::BranchMisses);
+            printCount(sample, Event::L1DMisses);
+            printCount(sample, Event::LLCMisses);
+            std::fprintf(stderr, "\n");
+        }
+        if (!counters.available()) {
+            std::fprintf(stderr, "hardware counters unavailable (%s), only wall time is reported\n", counters.unavailableReason().c_str());
+        }
+
+        // 执行阶段固定是最后一个
+        const auto &execute = phases[count - 1].sample;
+        if (!phases[count - 1].ran) {
+            return;
+        }
+        std::fprintf(stderr, "\nexecuted program instructions: %" PRIu64 "\n", executed);
+        if (executed) {
+            const double perInstruction = 1.0 / static_cast<double>(executed);
+            std::fprintf(stderr, "  ns / instruction:            %.3f\n", execute.wallSeconds * 1e9 * perInstruction);
+            for (const Event event : {Event::Cycles, Event::Instructions, Event::BranchMisses, Event::L1DMisses, Event::LLCMisses}) {
+                if (execute.has(event)) {
+                    std::fprintf(stderr, "  %-28s %.4f\n", (std::string(utils::PerfCounters::name(event)) + " / instruction:").c_str(),
+                                 static_cast<double>(execute[event]) * perInstruction);
+                }
+            }
+        }
+        // task-clock 明显小于墙上时间说明线程在等 I/O，上面的每条指令开销此时不能代表解释器本身
+        if (execute.has(Event::TaskClock) && execute.wallSeconds > 0) {
+            std::fprintf(stderr, "  CPU utilisation:             %.1f%%\n", static_cast<double>(execute[Event::TaskClock]) / (execute.wallSeconds * 1e7));
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    bool        perf = false;
+    bool        tree = false;
+    bool        batch = false;
+    bool        repl = false;
+    bool        loopCache = false;
+    size_t      threads = 0;
+    Language    language = Language::Unknown;
+    std::string path;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--perf-counters") {
+            perf = true;
+        } else if (argument == "--batch") {
+            batch = true;
+        } else if (argument == "--repl") {
+            repl = true;
+        } else if (argument == "--engine=vm") {
+            tree = false;
+        } else if (argument == "--engine=tree") {
+            tree = true;
+        } else if (argument == "--loop-cache") {
+            loopCache = true;
+            tree = true;
+        } else if (argument.compare(0, 10, "--threads=") == 0) {
+            threads = std::strtoul(argument.c_str() + 10, nullptr, 10);
+        } else if (argument == "--language=bf") {
+            language = Language::Brainfuck;
+        } else if (argument == "--language=ws") {
+            language = Language::Whitespace;
+        } else if (argument.compare(0, 2, "--") != 0) {
+            if (path.empty()) {
+                path = argument;
+            } else {
+                inputs.push_back(argument);
+            }
+        } else {
+            path.clear();
+            repl = false;
+            break;
+        }
+    }
+    const bool replUsage = repl && path.empty() && !batch && !perf && !loopCache && language != Language::Unknown;
+    if (repl ? !replUsage : path.empty() || batch == inputs.empty() || (batch && (perf || tree))) {
+        std::cerr << "用法: " << argv[0] << " [--perf-counters] [--engine=vm|tree] [--loop-cache] [--language=bf|ws] [--threads=N] <source>\n"
+                  << "      " << argv[0] << " --batch [--language=bf|ws] [--threads=N] <source> <input>...\n"
+                  << "      " << argv[0] << " --repl --language=bf|ws" << std::endl;
+        return 1;
+    }
+    if (repl) {
+        return runRepl(language);
+    }
+    if (language == Language::Unknown) {
+        language = languageOf(path);
+    }
+    if (language == Language::Unknown) {
+        std::cerr << "错误: 无法从扩展名判断 " << path << " 的语言，请使用 --language" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "错误: 无法打开文件 " << path << std::endl;
+        return 1;
+    }
+    std::vector<char> code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (batch) {
+        return runBatch(language, code, inputs, threads);
+    }
+
+    // 需要计数的话，输入要能重放第二遍
+    std::string                          stdinData;
+    std::optional<utils::BufferedInput>  replay;
+    utils::BufferedInput                *input = &utils::BufferedInput::standardInput();
+    utils::BufferedOutput               &output = utils::BufferedOutput::standardOutput();
+    if (perf) {
+        stdinData = readAll(stdin);
+        replay.emplace(stdinData.data(), stdinData.size());
+        input = &*replay;
+    }
+
+    auto                &handler = utils::ErrorHandler::getInstance();
+    utils::PerfCounters  counters;
+    Phase                phases[] = {{"parse"}, {"optimize"}, {"execute"}};
+    uint64_t             executed = 0;
+    bool                 ok = true;
+    auto                 measure = [&](Phase &phase, auto &&body) {
+        phase.ran = true;
+        counters.start();
+        body();
+        phase.sample = counters.stop();
+    };
+    // 第一遍结束后用同一份输入再执行一遍，count 返回执行的程序指令条数。
+    // 计数运行丢弃输出，产生的诊断是第一遍的重复
+    auto finish = [&](auto &&count) {
+        ok = !failed();
+        handler.printErrors();
+        handler.clearErrors();
+        if (perf) {
+            utils::BufferedInput  again(stdinData.data(), stdinData.size());
+            utils::BufferedOutput sink(discard, nullptr);
+            executed = count(again, sink);
+            handler.clearErrors();
+        }
+    };
+
+    if (language == Language::Brainfuck) {
+        // 很大的源码按顶层括号切分，多线程解析和优化
+        const Brainfuck::ParallelLoader loader(threads);
+        Brainfuck::ExpressionVector     expressions;
+        measure(phases[0], [&] { expressions = loader.parse(code); });
+        if (failed()) {
+            handler.printErrors();
+            return 1;
+        }
+
+        if (tree) {
+            Brainfuck::LoopCache cache;
+            auto                 runner = std::make_unique<Brainfuck::Runner>();
+            runner->setIO(*input, output);
+            runner->setLoopCache(loopCache ? &cache : nullptr);
+            measure(phases[2], [&] { runner->run(expressions); });
+            if (loopCache) {
+                const auto &stats = cache.stats();
+                std::fprintf(stderr, "loop cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " bypassed, %" PRIu64 " flushes, %zu entries\n",
+                             stats.hits, stats.misses, stats.bypassed, stats.flushes, cache.entries());
+            }
+            finish([&](utils::BufferedInput &again, utils::BufferedOutput &sink) {
+                utils::CountTracer counter;
+                runner = std::make_unique<Brainfuck::Runner>();
+                runner->setIO(again, sink);
+                runner->run(expressions, counter);
+                return counter.count;
+            });
+        } else {
+            IR::Module module;
+            measure(phases[1], [&] {
+                module = loader.lower(expressions);
+            });
+            IR::VM vm;
+            vm.setIO(*input, output);
+            measure(phases[2], [&] { vm.run(module); });
+            finish([&](utils::BufferedInput &again, utils::BufferedOutput &sink) {
+                uint64_t count = 0;
+                vm.reset();
+                vm.setIO(again, sink);
+                vm.run(module, count);
+                return count;
+            });
+        }
+    } else {
+        Whitespace::Parser           parser;
+        Whitespace::ExpressionVector expressions;
+        measure(phases[0], [&] { expressions = parser.parse(code); });
+        if (failed()) {
+            handler.printErrors();
+            return 1;
+        }
+
+        Whitespace::Program program;
+        measure(phases[1], [&] { program = Whitespace::Compiler().compile(expressions, parser.labels()); });
+        Whitespace::Engine engine;
+        engine.setIO(*input, output);
+        measure(phases[2], [&] { engine.run(program); });
+        finish([&](utils::BufferedInput &again, utils::BufferedOutput &sink) {
+            utils::CountTracer counter;
+            engine.reset();
+            engine.setIO(again, sink);
+            engine.run(program, counter);
+            return counter.count;
+        });
+    }
+
+    if (perf) {
+        printReport(counters, phases, std::size(phases), executed);
+    }
+    return ok ? 0 : 1;
+}
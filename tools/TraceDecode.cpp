@@ -0,0 +1,34 @@
+// 离线跟踪解码器：把 Runner / Engine 写出的二进制跟踪转储转换成文本
+//   用法: RikkyuTraceDecode <trace.bin> [output.txt]
+
+#include "utils/Trace/Trace.h"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <trace.bin> [output.txt]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "错误: 无法打开文件 " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2) {
+        file.open(argv[2]);
+        if (!file.is_open()) {
+            std::cerr << "错误: 无法写入文件 " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+
+    if (!Rikkyu::utils::decodeTrace(in, argc > 2 ? static_cast<std::ostream &>(file) : std::cout)) {
+        std::cerr << "错误: " << argv[1] << " 不是有效的跟踪文件" << std::endl;
+        return 1;
+    }
+    return 0;
+}